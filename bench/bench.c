@@ -0,0 +1,299 @@
+/* libtinynotify -- benchmark suite
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "lib/error.h"
+#include "lib/session.h"
+#include "lib/notification.h"
+#include "lib/event.h"
+#include "lib/transport.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Every benchmark is run with a given number of live notifications, i.e.
+ * ones which are tracked by the session (because of a close callback) and
+ * haven't been closed yet. Results are written as JSON, one line per
+ * benchmark run. */
+
+typedef void (*bench_func)(NotifySession s, Notification n, int i);
+
+struct bench {
+	const char* name;
+	bench_func prepare;
+	bench_func run;
+};
+
+static double clock_us(clockid_t clock) {
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+#define now_us() clock_us(CLOCK_MONOTONIC)
+#define cpu_us() clock_us(CLOCK_PROCESS_CPUTIME_ID)
+
+static unsigned long alloc_count;
+
+#ifdef __GLIBC__
+/* count the heap allocations done by libtinynotify and the D-Bus library
+ * (calls made within libc itself, e.g. by strdup(), are not caught) */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+	alloc_count++;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+	alloc_count++;
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+	alloc_count++;
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+static void fail(NotifySession s, const char* what) {
+	fprintf(stderr, "%s failed: %s\n", what,
+			notify_session_get_error_message(s));
+	exit(1);
+}
+
+static void bench_send(NotifySession s, Notification n, int i) {
+	if (notification_send(n, s, i))
+		fail(s, "notification_send()");
+}
+
+static void bench_update(NotifySession s, Notification n, int i) {
+	if (notification_update(n, s, i))
+		fail(s, "notification_update()");
+}
+
+static void bench_close(NotifySession s, Notification n, int i) {
+	if (notification_close(n, s))
+		fail(s, "notification_close()");
+}
+
+/* fake-notify-server invokes this action right after sending the reply */
+#define AUTO_INVOKE_ACTION "invoke"
+
+static int invoked_count;
+
+static void count_invoked(Notification n, const char* key, void* user_data) {
+	invoked_count++;
+}
+
+static void bench_dispatch(NotifySession s, Notification n, int i) {
+	int expected = invoked_count + 1;
+
+	while (invoked_count < expected) {
+		if (notify_session_dispatch(s, NOTIFY_SESSION_NO_TIMEOUT)
+				== NOTIFY_DISPATCH_NOT_CONNECTED)
+			fail(s, "notify_session_dispatch()");
+	}
+}
+
+static const struct bench benches[] = {
+	{ "send", NULL, bench_send },
+	{ "update", bench_send, bench_update },
+	{ "close", bench_send, bench_close },
+	{ "dispatch", bench_send, bench_dispatch },
+	{ NULL }
+};
+
+static int compare_double(const void* a, const void* b) {
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+
+	return (x > y) - (x < y);
+}
+
+static void run_bench(FILE* out, const struct bench* b, NotifySession s,
+		int live, int iterations) {
+	Notification n = notification_new("Benchmark %d", "Benchmark body");
+	NotifyError ret;
+	double *samples;
+	double start, total = 0;
+	double cpu_total = 0;
+	unsigned long allocs = 0;
+	int i;
+
+	notification_bind_close_callback(n, NOTIFICATION_NOOP_ON_CLOSE, NULL);
+	notification_bind_action(n, AUTO_INVOKE_ACTION, count_invoked, NULL,
+			"Invoke");
+	if (!(samples = malloc(iterations * sizeof(*samples)))) {
+		perror("malloc()");
+		exit(1);
+	}
+
+	for (i = 0; i < iterations; i++) {
+		if (b->prepare)
+			b->prepare(s, n, i);
+
+		allocs -= alloc_count;
+		cpu_total -= cpu_us();
+		start = now_us();
+		b->run(s, n, i);
+		samples[i] = now_us() - start;
+		cpu_total += cpu_us();
+		allocs += alloc_count;
+		total += samples[i];
+	}
+
+	/* closing the notification drops it from the session */
+	ret = notification_close(n, s);
+	if (ret && ret != NOTIFY_ERROR_NO_NOTIFICATION_ID)
+		fail(s, "notification_close()");
+	notification_free(n);
+
+	qsort(samples, iterations, sizeof(*samples), compare_double);
+	fprintf(out, "{\"bench\": \"%s\", \"live\": %d, \"ops\": %d, "
+			"\"ops_per_sec\": %.1f, \"mean_us\": %.2f, "
+			"\"p50_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f, "
+			"\"cpu_us\": %.2f, \"allocs\": %.1f}\n",
+			b->name, live, iterations,
+			iterations / total * 1e6, total / iterations,
+			samples[iterations / 2],
+			samples[(int) (iterations * 0.99)],
+			samples[iterations - 1],
+			cpu_total / iterations, (double) allocs / iterations);
+	fflush(out);
+	free(samples);
+}
+
+/* grow the number of live notifications to 'live' */
+static void populate(NotifySession s, Notification** live_ns,
+		int* live_count, int live) {
+	*live_ns = realloc(*live_ns, live * sizeof(**live_ns));
+	if (!*live_ns) {
+		perror("realloc()");
+		exit(1);
+	}
+
+	for (; *live_count < live; (*live_count)++) {
+		Notification n = notification_new("Live %d", NOTIFICATION_NO_BODY);
+
+		notification_bind_close_callback(n, NOTIFICATION_NOOP_ON_CLOSE, NULL);
+		if (notification_send(n, s, *live_count))
+			fail(s, "notification_send()");
+		(*live_ns)[*live_count] = n;
+	}
+}
+
+static void usage(const char* argv0) {
+	fprintf(stderr, "Usage: %s [-b bench,...] [-l live,...] [-n iterations] [-o file]\n"
+			"       [-t transport] [-P]\n"
+			"\n"
+			"  -b  benchmarks to run (default: send,update,close,dispatch)\n"
+			"  -l  live notification counts, ascending (default: 1,100,10000)\n"
+			"  -n  iterations per benchmark (default: 1000)\n"
+			"  -o  write results to file (default: stdout)\n"
+			"  -t  transport to use: dbus or loopback (default: dbus)\n"
+			"  -P  connect directly to the server if it supports that\n",
+			argv0);
+}
+
+int main(int argc, char* argv[]) {
+	const char *bench_list = "send,update,close,dispatch";
+	char *live_list = strdup("1,100,10000");
+	int iterations = 1000;
+	FILE *out = stdout;
+	NotifyTransport transport = NOTIFY_TRANSPORT_DBUS;
+	int peer_to_peer = 0;
+
+	NotifySession s;
+	Notification *live_ns = NULL;
+	int live_count = 0;
+	char *live_str, *saveptr;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "b:l:n:o:t:Ph")) != -1) {
+		switch (opt) {
+			case 'b':
+				bench_list = optarg;
+				break;
+			case 'l':
+				free(live_list);
+				live_list = strdup(optarg);
+				break;
+			case 'n':
+				iterations = atoi(optarg);
+				break;
+			case 'o':
+				out = fopen(optarg, "w");
+				if (!out) {
+					perror("fopen()");
+					return 1;
+				}
+				break;
+			case 't':
+				if (!strcmp(optarg, "dbus"))
+					transport = NOTIFY_TRANSPORT_DBUS;
+				else if (!strcmp(optarg, "loopback"))
+					transport = NOTIFY_TRANSPORT_LOOPBACK;
+				else {
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'P':
+				peer_to_peer = 1;
+				break;
+			default:
+				usage(argv[0]);
+				return opt != 'h';
+		}
+	}
+	if (iterations <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	s = notify_session_new("tinynotify-bench", NOTIFY_SESSION_NO_APP_ICON);
+	notify_session_set_transport(s, transport);
+	notify_session_set_peer_to_peer(s, peer_to_peer);
+	if (notify_session_connect(s))
+		fail(s, "notify_session_connect()");
+	if (peer_to_peer && !notify_session_is_peer_connected(s))
+		fprintf(stderr, "Direct connection failed, using the bus\n");
+
+	for (live_str = strtok_r(live_list, ",", &saveptr); live_str;
+			live_str = strtok_r(NULL, ",", &saveptr)) {
+		int live = atoi(live_str);
+
+		/* the benchmarked notification is live as well */
+		populate(s, &live_ns, &live_count, live > 0 ? live - 1 : 0);
+
+		for (i = 0; benches[i].name; i++) {
+			const char *p = strstr(bench_list, benches[i].name);
+			size_t len = strlen(benches[i].name);
+
+			if (p && (p == bench_list || p[-1] == ',')
+					&& (p[len] == ',' || !p[len]))
+				run_bench(out, &benches[i], s, live, iterations);
+		}
+	}
+
+	/* disconnecting emits close for all live notifications */
+	notify_session_free(s);
+	for (i = 0; i < live_count; i++)
+		notification_free(live_ns[i]);
+	free(live_ns);
+	free(live_list);
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
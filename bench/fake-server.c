@@ -0,0 +1,349 @@
+/* libtinynotify -- stand-in notification server for benchmarks
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <dbus/dbus.h>
+
+#define NOTIFICATIONS_NAME "org.freedesktop.Notifications"
+#define NOTIFICATIONS_PATH "/org/freedesktop/Notifications"
+
+/* actions with this key are invoked right after the notification is shown */
+#define AUTO_INVOKE_ACTION "invoke"
+
+#define PEER_CAPABILITY "x-tinynotify-peer:"
+#define MAX_WATCHES 64
+#define MAX_PEERS 32
+
+static useconds_t reply_delay = 0;
+static int emit_closed = 0;
+
+/* the bus connection (signals are always emitted there) */
+static DBusConnection *bus;
+/* the direct connection listener, if any */
+static DBusServer *server;
+static char *peer_capability;
+
+static DBusConnection *peers[MAX_PEERS];
+static int peer_count = 0;
+
+static DBusWatch *watches[MAX_WATCHES];
+static int watch_count = 0;
+
+static void send_signal(DBusConnection* conn, const char* member,
+		int first_type, ...) {
+	DBusMessage *sig;
+	va_list ap;
+
+	sig = dbus_message_new_signal(NOTIFICATIONS_PATH,
+			NOTIFICATIONS_NAME, member);
+	if (!sig)
+		abort();
+	va_start(ap, first_type);
+	if (!dbus_message_append_args_valist(sig, first_type, ap))
+		abort();
+	va_end(ap);
+
+	dbus_connection_send(conn, sig, NULL);
+	dbus_message_unref(sig);
+}
+
+static void reply(DBusConnection* conn, DBusMessage* msg,
+		int first_type, ...) {
+	DBusMessage *ret;
+	va_list ap;
+
+	if (reply_delay)
+		usleep(reply_delay);
+
+	ret = dbus_message_new_method_return(msg);
+	if (!ret)
+		abort();
+	va_start(ap, first_type);
+	if (!dbus_message_append_args_valist(ret, first_type, ap))
+		abort();
+	va_end(ap);
+
+	dbus_connection_send(conn, ret, NULL);
+	dbus_message_unref(ret);
+}
+
+static void handle_notify(DBusConnection* conn, DBusMessage* msg) {
+	static dbus_uint32_t last_id = 0;
+
+	DBusMessageIter iter, subiter;
+	dbus_uint32_t id;
+	const char *action = NULL;
+
+	dbus_message_iter_init(msg, &iter);
+	dbus_message_iter_next(&iter); /* app_name */
+	dbus_message_iter_get_basic(&iter, &id);
+	if (!id)
+		id = ++last_id;
+
+	/* app_icon, summary, body */
+	dbus_message_iter_next(&iter);
+	dbus_message_iter_next(&iter);
+	dbus_message_iter_next(&iter);
+	dbus_message_iter_next(&iter);
+	dbus_message_iter_recurse(&iter, &subiter);
+	if (dbus_message_iter_get_arg_type(&subiter) == DBUS_TYPE_STRING)
+		dbus_message_iter_get_basic(&subiter, &action);
+
+	reply(conn, msg, DBUS_TYPE_UINT32, &id, DBUS_TYPE_INVALID);
+
+	if (action && !strcmp(action, AUTO_INVOKE_ACTION))
+		send_signal(bus, "ActionInvoked", DBUS_TYPE_UINT32, &id,
+				DBUS_TYPE_STRING, &action, DBUS_TYPE_INVALID);
+	if (emit_closed) {
+		dbus_uint32_t reason = 1; /* expired */
+
+		send_signal(bus, "NotificationClosed", DBUS_TYPE_UINT32, &id,
+				DBUS_TYPE_UINT32, &reason, DBUS_TYPE_INVALID);
+	}
+}
+
+static void handle_close(DBusConnection* conn, DBusMessage* msg) {
+	dbus_uint32_t id, reason = 3; /* closed by a call */
+
+	if (!dbus_message_get_args(msg, NULL, DBUS_TYPE_UINT32, &id,
+				DBUS_TYPE_INVALID))
+		return;
+
+	reply(conn, msg, DBUS_TYPE_INVALID);
+	send_signal(bus, "NotificationClosed", DBUS_TYPE_UINT32, &id,
+			DBUS_TYPE_UINT32, &reason, DBUS_TYPE_INVALID);
+}
+
+static void handle_get_server_information(DBusConnection* conn,
+		DBusMessage* msg) {
+	const char *name = "fake-notify-server";
+	const char *vendor = "libtinynotify";
+	const char *version = PACKAGE_VERSION;
+	const char *spec_version = "1.2";
+
+	reply(conn, msg, DBUS_TYPE_STRING, &name, DBUS_TYPE_STRING, &vendor,
+			DBUS_TYPE_STRING, &version, DBUS_TYPE_STRING, &spec_version,
+			DBUS_TYPE_INVALID);
+}
+
+static void handle_get_capabilities(DBusConnection* conn, DBusMessage* msg) {
+	const char *caps[] = { "actions", "body", NULL };
+	const char **capsp = caps;
+
+	if (peer_capability)
+		caps[2] = peer_capability;
+	reply(conn, msg, DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &capsp,
+			peer_capability ? 3 : 2, DBUS_TYPE_INVALID);
+}
+
+static DBusHandlerResult handle_message(DBusConnection* conn,
+		DBusMessage* msg, void* user_data) {
+	if (dbus_message_is_method_call(msg, NOTIFICATIONS_NAME, "Notify"))
+		handle_notify(conn, msg);
+	else if (dbus_message_is_method_call(msg, NOTIFICATIONS_NAME,
+				"CloseNotification"))
+		handle_close(conn, msg);
+	else if (dbus_message_is_method_call(msg, NOTIFICATIONS_NAME,
+				"GetServerInformation"))
+		handle_get_server_information(conn, msg);
+	else if (dbus_message_is_method_call(msg, NOTIFICATIONS_NAME,
+				"GetCapabilities"))
+		handle_get_capabilities(conn, msg);
+	else
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/* a minimal main loop, serving the bus and the direct connections */
+
+static dbus_bool_t add_watch(DBusWatch* watch, void* data) {
+	if (watch_count == MAX_WATCHES)
+		return FALSE;
+	watches[watch_count++] = watch;
+	return TRUE;
+}
+
+static void remove_watch(DBusWatch* watch, void* data) {
+	int i;
+
+	for (i = 0; i < watch_count; i++) {
+		if (watches[i] == watch) {
+			watches[i] = watches[--watch_count];
+			break;
+		}
+	}
+}
+
+static void toggle_watch(DBusWatch* watch, void* data) {
+	/* dbus_watch_get_enabled() is checked before every poll() */
+}
+
+static void setup_connection(DBusConnection* conn) {
+	if (!dbus_connection_set_watch_functions(conn, add_watch, remove_watch,
+				toggle_watch, NULL, NULL)
+			|| !dbus_connection_add_filter(conn, handle_message, NULL, NULL))
+		abort();
+}
+
+static void new_connection(DBusServer* srv, DBusConnection* conn,
+		void* data) {
+	if (peer_count == MAX_PEERS)
+		return;
+
+	dbus_connection_ref(conn);
+	setup_connection(conn);
+	peers[peer_count++] = conn;
+}
+
+static void dispatch_connection(DBusConnection* conn) {
+	while (dbus_connection_dispatch(conn) == DBUS_DISPATCH_DATA_REMAINS);
+}
+
+static int run_main_loop(void) {
+	struct pollfd fds[MAX_WATCHES];
+	DBusWatch *polled[MAX_WATCHES];
+	int i, j, nfds;
+
+	while (dbus_connection_get_is_connected(bus)) {
+		dispatch_connection(bus);
+		for (i = peer_count - 1; i >= 0; i--) {
+			dispatch_connection(peers[i]);
+			if (!dbus_connection_get_is_connected(peers[i])) {
+				dbus_connection_unref(peers[i]);
+				peers[i] = peers[--peer_count];
+			}
+		}
+
+		nfds = 0;
+		for (i = 0; i < watch_count; i++) {
+			unsigned int flags = dbus_watch_get_flags(watches[i]);
+
+			if (!dbus_watch_get_enabled(watches[i]))
+				continue;
+			polled[nfds] = watches[i];
+			fds[nfds].fd = dbus_watch_get_unix_fd(watches[i]);
+			fds[nfds].events = (flags & DBUS_WATCH_READABLE ? POLLIN : 0)
+				| (flags & DBUS_WATCH_WRITABLE ? POLLOUT : 0);
+			nfds++;
+		}
+
+		if (poll(fds, nfds, -1) == -1)
+			return 1;
+
+		for (i = 0; i < nfds; i++) {
+			unsigned int flags = 0;
+
+			if (!fds[i].revents)
+				continue;
+			/* the watch may have been removed by a previous handler */
+			for (j = 0; j < watch_count && watches[j] != polled[i]; j++);
+			if (j == watch_count)
+				continue;
+
+			if (fds[i].revents & POLLIN)
+				flags |= DBUS_WATCH_READABLE;
+			if (fds[i].revents & POLLOUT)
+				flags |= DBUS_WATCH_WRITABLE;
+			if (fds[i].revents & POLLHUP)
+				flags |= DBUS_WATCH_HANGUP;
+			if (fds[i].revents & POLLERR)
+				flags |= DBUS_WATCH_ERROR;
+			dbus_watch_handle(polled[i], flags);
+		}
+	}
+
+	return 0;
+}
+
+static void usage(const char* argv0) {
+	fprintf(stderr, "Usage: %s [-c] [-d usec] [-p address]\n"
+			"\n"
+			"  -c  emit NotificationClosed right after every notification\n"
+			"  -d  delay every reply by usec microseconds\n"
+			"  -p  accept direct connections on address (e.g. unix:tmpdir=/tmp),\n"
+			"      and advertise it through GetCapabilities\n"
+			"\n"
+			"ActionInvoked is emitted right after every notification whose first\n"
+			"action is '" AUTO_INVOKE_ACTION "'.\n",
+			argv0);
+}
+
+int main(int argc, char* argv[]) {
+	const char *listen_address = NULL;
+	DBusError err;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "cd:p:h")) != -1) {
+		switch (opt) {
+			case 'c':
+				emit_closed = 1;
+				break;
+			case 'd':
+				reply_delay = atol(optarg);
+				break;
+			case 'p':
+				listen_address = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return opt != 'h';
+		}
+	}
+
+	dbus_error_init(&err);
+	bus = dbus_bus_get(DBUS_BUS_SESSION, &err);
+	if (!bus) {
+		fprintf(stderr, "Unable to connect to the session bus: %s\n",
+				err.message);
+		return 1;
+	}
+	if (dbus_bus_request_name(bus, NOTIFICATIONS_NAME,
+				DBUS_NAME_FLAG_DO_NOT_QUEUE, &err)
+			!= DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+		fprintf(stderr, "Unable to own " NOTIFICATIONS_NAME ": %s\n",
+				dbus_error_is_set(&err) ? err.message : "name taken");
+		return 1;
+	}
+	setup_connection(bus);
+
+	if (listen_address) {
+		char *address;
+
+		server = dbus_server_listen(listen_address, &err);
+		if (!server) {
+			fprintf(stderr, "Unable to listen on %s: %s\n",
+					listen_address, err.message);
+			return 1;
+		}
+		if (!dbus_server_set_watch_functions(server, add_watch,
+					remove_watch, toggle_watch, NULL, NULL))
+			abort();
+		dbus_server_set_new_connection_function(server, new_connection,
+				NULL, NULL);
+
+		address = dbus_server_get_address(server);
+		peer_capability = malloc(strlen(PEER_CAPABILITY) + strlen(address) + 1);
+		if (!peer_capability)
+			abort();
+		strcpy(peer_capability, PEER_CAPABILITY);
+		strcat(peer_capability, address);
+		dbus_free(address);
+	}
+
+	/* let the caller know we're ready to serve */
+	puts("ready");
+	fflush(stdout);
+
+	return run_main_loop();
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+# libtinynotify -- run the benchmark suite against a private bus
+# (c) 2011 Michał Górny
+# 2-clause BSD-licensed
+#
+# Usage: run-bench.sh [fake-server options --] [tinynotify-bench options]
+#
+# Starts a private dbus-daemon and the stand-in notification server, then
+# runs tinynotify-bench. No connection to the user's session is made.
+
+srcdir=${srcdir:-$(dirname "$0")}
+builddir=${builddir:-.}
+DBUS_DAEMON=${DBUS_DAEMON:-dbus-daemon}
+
+server_args=
+case " $* " in
+	*" -- "*)
+		while [ "${1}" != "--" ]; do
+			server_args="${server_args} ${1}"
+			shift
+		done
+		shift
+		;;
+esac
+
+tmpdir=$(mktemp -d "${TMPDIR:-/tmp}/tinynotify-bench.XXXXXX") || exit 1
+daemon_pid=
+server_pid=
+
+cleanup() {
+	[ -n "${server_pid}" ] && kill "${server_pid}" 2>/dev/null
+	[ -n "${daemon_pid}" ] && kill "${daemon_pid}" 2>/dev/null
+	rm -rf "${tmpdir}"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+"${DBUS_DAEMON}" --config-file="${srcdir}/bench-bus.conf" --nofork \
+	--print-address=3 --print-pid=4 3>"${tmpdir}/address" 4>"${tmpdir}/pid" &
+daemon_pid=$!
+
+# wait for the daemon to print its address
+i=0
+while [ ! -s "${tmpdir}/address" ]; do
+	i=$(( i + 1 ))
+	if [ ${i} -gt 100 ] || ! kill -0 "${daemon_pid}" 2>/dev/null; then
+		echo "dbus-daemon failed to start" >&2
+		exit 1
+	fi
+	sleep 0.1
+done
+DBUS_SESSION_BUS_ADDRESS=$(head -n 1 "${tmpdir}/address")
+export DBUS_SESSION_BUS_ADDRESS
+
+mkfifo "${tmpdir}/ready"
+"${builddir}/fake-notify-server" ${server_args} > "${tmpdir}/ready" &
+server_pid=$!
+read ready < "${tmpdir}/ready"
+if [ "${ready}" != "ready" ]; then
+	echo "fake-notify-server failed to start" >&2
+	exit 1
+fi
+
+"${builddir}/tinynotify-bench" "$@"
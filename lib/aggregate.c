@@ -0,0 +1,301 @@
+/* libtinynotify -- aggregation of notification bursts
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "hints.h"
+#include "aggregate.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "stats_.h"
+#include "memory_.h"
+#include "queue_.h"
+#include "utf8_.h"
+#include "aggregate_.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const char* const NOTIFICATION_NO_AGGREGATION_KEY = NULL;
+
+const unsigned int NOTIFY_SESSION_NO_AGGREGATION = 0;
+const char* const NOTIFY_SESSION_DEFAULT_AGGREGATION_FORMAT
+	= "%lu new notifications from %s";
+const size_t NOTIFY_SESSION_MAX_AGGREGATED = 64;
+
+#define _aggregate_item(g, i) \
+	(&(g)->items[((g)->item_first + (i)) % (g)->items_alloc])
+
+void notification_set_aggregation_key(Notification n, const char* key) {
+	free(n->aggregation_key);
+	n->aggregation_key = key ? _notify_utf8_strdup(key) : NULL;
+}
+
+void notify_session_set_aggregation(NotifySession s,
+		unsigned int threshold, int window, const char* format) {
+	struct _notify_aggregate_state *a = &s->aggregate;
+
+	a->threshold = threshold;
+	a->window = window;
+	free(a->format);
+	a->format = _notify_utf8_strdup(format ? format
+			: NOTIFY_SESSION_DEFAULT_AGGREGATION_FORMAT);
+}
+
+void _notify_aggregate_init(struct _notify_aggregate_state* a) {
+	memset(a, 0, sizeof(*a));
+}
+
+static void _aggregate_clear_items(NotifySession s,
+		struct _notify_aggregate_group* g) {
+	size_t i;
+
+	for (i = 0; i < g->item_count; i++) {
+		free(g->items[i].summary);
+		free(g->items[i].body);
+	}
+	free(g->items);
+	_notify_mem_release(s, g->items_size);
+
+	g->items = NULL;
+	g->item_first = g->item_count = g->items_alloc = g->items_size = 0;
+}
+
+static void _aggregate_free_group(NotifySession s,
+		struct _notify_aggregate_group* g) {
+	_aggregate_clear_items(s, g);
+	if (g->summary) {
+		/* it could still be waiting in the queue */
+		_notify_queue_transfer(s, g->summary, NULL);
+		notification_free(g->summary);
+	}
+	_notify_mem_release(s, sizeof(*g) + strlen(g->key) + 1);
+	free(g->key);
+	free(g);
+}
+
+void _notify_aggregate_free(NotifySession s) {
+	struct _notify_aggregate_group *g, *next;
+
+	for (g = s->aggregate.groups; g; g = next) {
+		next = g->next;
+		_aggregate_free_group(s, g);
+	}
+	free(s->aggregate.format);
+}
+
+static long _aggregate_ms_since(const struct timespec* start,
+		const struct timespec* now) {
+	return (now->tv_sec - start->tv_sec) * 1000
+		+ (now->tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static struct _notify_aggregate_group* _aggregate_find_group(
+		NotifySession s, const char* key) {
+	struct _notify_aggregate_group *g;
+
+	for (g = s->aggregate.groups; g; g = g->next) {
+		if (!strcmp(g->key, key))
+			break;
+	}
+
+	return g;
+}
+
+/* find the group for key, freeing the other ones which have nothing
+ * to keep them around: the burst is over, and no items are kept */
+static struct _notify_aggregate_group* _aggregate_find_group_sweep(
+		NotifySession s, const char* key, const struct timespec* now) {
+	struct _notify_aggregate_group **gp, *g, *found = NULL;
+
+	for (gp = &s->aggregate.groups; *gp;) {
+		g = *gp;
+		if (!found && !strcmp(g->key, key))
+			found = g;
+		else if (!g->item_count && _aggregate_ms_since(&g->last_arrival, now)
+				> s->aggregate.window) {
+			*gp = g->next;
+			_aggregate_free_group(s, g);
+			continue;
+		}
+		gp = &g->next;
+	}
+
+	return found;
+}
+
+struct _notify_aggregate_group* _notify_aggregate_match(NotifySession s,
+		Notification n) {
+	struct _notify_aggregate_state *a = &s->aggregate;
+	struct _notify_aggregate_group *g;
+	struct timespec now;
+	const char *key;
+	long since_last;
+
+	if (!a->threshold || a->sending_summary)
+		return NULL;
+
+	key = n->aggregation_key;
+	if (!key)
+		key = _notification_hints_get_string(n->hints, "category",
+				_notification_hints_get_string(s->default_hints,
+					"category", NULL));
+	if (!key)
+		return NULL;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!(g = _aggregate_find_group_sweep(s, key, &now))) {
+		size_t size = sizeof(*g) + strlen(key) + 1;
+
+		/* without the group, the notification is just sent */
+		if (_notify_mem_charge(s, size))
+			return NULL;
+		if (!(g = calloc(1, sizeof(*g))) || !(g->key = strdup(key))) {
+			free(g);
+			_notify_mem_release(s, size);
+			return NULL;
+		}
+
+		g->next = a->groups;
+		a->groups = g;
+	}
+
+	since_last = _aggregate_ms_since(&g->last_arrival, &now);
+	if (!g->burst || since_last > a->window)
+		g->burst = g->aggregated = 0;
+	g->last_arrival = now;
+
+	if (++g->burst <= a->threshold)
+		return NULL;
+	return g;
+}
+
+/* keep a copy of the text, replacing the oldest one if there are
+ * too many; on failure, it is just not kept */
+static void _aggregate_keep_item(NotifySession s,
+		struct _notify_aggregate_group* g,
+		const struct _notification_text* t) {
+	struct _notify_aggregate_item *it;
+	size_t summary_len = strlen(t->summary);
+	size_t size = summary_len + t->body_len + 2;
+	char *summary, *body = NULL;
+
+	/* the ring is only formed once it is full, so it is never moved */
+	if (g->item_count == g->items_alloc
+			&& g->items_alloc < NOTIFY_SESSION_MAX_AGGREGATED) {
+		size_t new_alloc = g->items_alloc ? g->items_alloc * 2 : 8;
+		size_t grow;
+
+		if (new_alloc > NOTIFY_SESSION_MAX_AGGREGATED)
+			new_alloc = NOTIFY_SESSION_MAX_AGGREGATED;
+		grow = (new_alloc - g->items_alloc) * sizeof(*it);
+		if (_notify_mem_charge(s, grow))
+			return;
+		if (!(it = realloc(g->items, new_alloc * sizeof(*it)))) {
+			_notify_mem_release(s, grow);
+			return;
+		}
+
+		g->items = it;
+		g->items_alloc = new_alloc;
+		g->items_size += grow;
+	}
+
+	if (_notify_mem_charge(s, size))
+		return;
+	if (!(summary = malloc(summary_len + 1))
+			|| !(body = malloc(t->body_len + 1))) {
+		free(summary);
+		_notify_mem_release(s, size);
+		return;
+	}
+
+	if (g->item_count < g->items_alloc)
+		it = &g->items[g->item_count++];
+	else {
+		it = &g->items[g->item_first];
+		g->item_first = (g->item_first + 1) % g->items_alloc;
+		free(it->summary);
+		free(it->body);
+		_notify_mem_release(s, it->size);
+		g->items_size -= it->size;
+	}
+
+	memcpy(summary, t->summary, summary_len + 1);
+	memcpy(body, t->body, t->body_len);
+	body[t->body_len] = 0;
+	it->summary = summary;
+	it->body = body;
+	it->size = size;
+	g->items_size += size;
+}
+
+NotifyError _notify_aggregate_add(NotifySession s,
+		struct _notify_aggregate_group* g, Notification n, va_list ap) {
+	struct _notify_aggregate_state *a = &s->aggregate;
+	struct _notification_text t;
+	NotifyError ret;
+
+	if ((ret = _notification_format_text(n, s, ap, &t)))
+		return ret;
+
+	_aggregate_keep_item(s, g, &t);
+	g->aggregated++;
+	_stats_inc(s, aggregated);
+
+	if (!g->summary) {
+		const char *category = _notification_hints_get_string(n->hints,
+				"category", NULL);
+
+		g->summary = notification_new(a->format, "%M");
+		if (category)
+			notification_set_category(g->summary, category);
+	}
+
+	a->sending_summary = 1;
+	ret = notification_update(g->summary, s, g->aggregated, g->key,
+			t.summary);
+	a->sending_summary = 0;
+
+	_notification_text_free(&t);
+	return ret;
+}
+
+size_t notify_session_get_aggregated_count(NotifySession s,
+		const char* key) {
+	struct _notify_aggregate_group *g = _aggregate_find_group(s, key);
+
+	return g ? g->item_count : 0;
+}
+
+const char* notify_session_get_aggregated_summary(NotifySession s,
+		const char* key, size_t index) {
+	struct _notify_aggregate_group *g = _aggregate_find_group(s, key);
+
+	if (!g || index >= g->item_count)
+		return NULL;
+	return _aggregate_item(g, index)->summary;
+}
+
+const char* notify_session_get_aggregated_body(NotifySession s,
+		const char* key, size_t index) {
+	struct _notify_aggregate_group *g = _aggregate_find_group(s, key);
+
+	if (!g || index >= g->item_count)
+		return NULL;
+	return _aggregate_item(g, index)->body;
+}
+
+void notify_session_clear_aggregated(NotifySession s, const char* key) {
+	struct _notify_aggregate_group *g = _aggregate_find_group(s, key);
+
+	if (g)
+		_aggregate_clear_items(s, g);
+}
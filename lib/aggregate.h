@@ -0,0 +1,148 @@
+/* libtinynotify -- aggregation of notification bursts
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_AGGREGATE_H
+#define _TINYNOTIFY_AGGREGATE_H
+
+#include <stddef.h>
+
+/**
+ * SECTION: NotifyAggregate
+ * @short_description: API to aggregate bursts of notifications
+ * @include: tinynotify.h
+ *
+ * A #NotifySession can aggregate bursts of related notifications. Each
+ * notification is related to the others by its aggregation key (see
+ * notification_set_aggregation_key()), or its category if it has no key.
+ *
+ * A burst is a series of notifications with the same key, each sent within
+ * the aggregation window after the previous one. The first notifications
+ * of a burst (up to the threshold) are sent as usual. The following ones
+ * are not sent; instead, a single summary notification for the key is
+ * sent, and updated in place with each one (e.g. '37 new notifications
+ * from build farm'). Only new notifications are aggregated; updates
+ * to the notifications sent already are not.
+ *
+ * The summaries and bodies of the aggregated notifications are kept
+ * in the session, and can be accessed using
+ * notify_session_get_aggregated_summary() and
+ * notify_session_get_aggregated_body(), until they are cleared using
+ * notify_session_clear_aggregated(). Up to %NOTIFY_SESSION_MAX_AGGREGATED
+ * of them are kept for each key; past that, the oldest ones are dropped.
+ */
+
+/**
+ * NOTIFICATION_NO_AGGREGATION_KEY
+ *
+ * A constant specifying that the notification category should be used
+ * as the aggregation key.
+ */
+extern const char* const NOTIFICATION_NO_AGGREGATION_KEY;
+
+/**
+ * notification_set_aggregation_key
+ * @notification: notification to operate on
+ * @key: a new aggregation key, or %NOTIFICATION_NO_AGGREGATION_KEY
+ *
+ * Set the key used to aggregate the notification with the related ones.
+ * The string will be copied.
+ */
+void notification_set_aggregation_key(Notification notification,
+		const char* key);
+
+/**
+ * NOTIFY_SESSION_NO_AGGREGATION
+ *
+ * A threshold disabling aggregation.
+ */
+extern const unsigned int NOTIFY_SESSION_NO_AGGREGATION;
+
+/**
+ * NOTIFY_SESSION_DEFAULT_AGGREGATION_FORMAT
+ *
+ * The default format of the summary notification.
+ */
+extern const char* const NOTIFY_SESSION_DEFAULT_AGGREGATION_FORMAT;
+
+/**
+ * NOTIFY_SESSION_MAX_AGGREGATED
+ *
+ * The maximal number of the aggregated notifications kept for a single
+ * aggregation key.
+ */
+extern const size_t NOTIFY_SESSION_MAX_AGGREGATED;
+
+/**
+ * notify_session_set_aggregation
+ * @session: session to operate on
+ * @threshold: the number of notifications in a burst sent as usual,
+ *	or %NOTIFY_SESSION_NO_AGGREGATION
+ * @window: the maximal time between notifications in a burst [ms]
+ * @format: the format of the summary notification,
+ *	or %NOTIFY_SESSION_DEFAULT_AGGREGATION_FORMAT
+ *
+ * Enable or disable aggregating bursts of notifications sent through
+ * @session. By default, aggregation is disabled.
+ *
+ * The summary notification is formatted using @format, which is given
+ * the number of notifications aggregated in the current burst
+ * (an unsigned long) and the aggregation key (a string), in this order.
+ * Its body is the summary of the last notification aggregated.
+ * The string will be copied.
+ */
+void notify_session_set_aggregation(NotifySession session,
+		unsigned int threshold, int window, const char* format);
+
+/**
+ * notify_session_get_aggregated_count
+ * @session: session to operate on
+ * @key: the aggregation key
+ *
+ * Get the number of the aggregated notifications kept for @key.
+ *
+ * Returns: the number of notifications
+ */
+size_t notify_session_get_aggregated_count(NotifySession session,
+		const char* key);
+
+/**
+ * notify_session_get_aggregated_summary
+ * @session: session to operate on
+ * @key: the aggregation key
+ * @index: the index of the notification, oldest first
+ *
+ * Get the (formatted) summary of an aggregated notification.
+ *
+ * Returns: a string valid until the aggregated notifications are cleared,
+ * or NULL if @index is out of range
+ */
+const char* notify_session_get_aggregated_summary(NotifySession session,
+		const char* key, size_t index);
+
+/**
+ * notify_session_get_aggregated_body
+ * @session: session to operate on
+ * @key: the aggregation key
+ * @index: the index of the notification, oldest first
+ *
+ * Get the (formatted) body of an aggregated notification.
+ *
+ * Returns: a string valid until the aggregated notifications are cleared,
+ * or NULL if @index is out of range
+ */
+const char* notify_session_get_aggregated_body(NotifySession session,
+		const char* key, size_t index);
+
+/**
+ * notify_session_clear_aggregated
+ * @session: session to operate on
+ * @key: the aggregation key
+ *
+ * Free the aggregated notifications kept for @key.
+ */
+void notify_session_clear_aggregated(NotifySession session, const char* key);
+
+#endif /*_TINYNOTIFY_AGGREGATE_H*/
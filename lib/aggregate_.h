@@ -0,0 +1,72 @@
+/* libtinynotify -- aggregation of notification bursts
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_AGGREGATE__H
+#define _TINYNOTIFY_AGGREGATE__H
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notify_aggregate_item {
+	char* summary;
+	char* body;
+	/* of both the strings */
+	size_t size;
+};
+
+struct _notify_aggregate_group {
+	char* key;
+
+	/* the current burst */
+	unsigned long burst;
+	unsigned long aggregated;
+	struct timespec last_arrival;
+
+	Notification summary;
+
+	/* kept for the caller, charged against the memory budget;
+	 * once there are NOTIFY_SESSION_MAX_AGGREGATED of them, a ring
+	 * with the oldest one at item_first */
+	struct _notify_aggregate_item* items;
+	size_t item_first;
+	size_t item_count;
+	size_t items_alloc;
+	size_t items_size;
+
+	struct _notify_aggregate_group* next;
+};
+
+struct _notify_aggregate_state {
+	/* zero if disabled */
+	unsigned int threshold;
+	int window;
+	char* format;
+
+	struct _notify_aggregate_group* groups;
+	int sending_summary;
+};
+
+void _notify_aggregate_init(struct _notify_aggregate_state* a);
+void _notify_aggregate_free(NotifySession s);
+
+/* account n in the burst for its key; returns the group if n is to be
+ * aggregated, NULL if it is to be sent */
+struct _notify_aggregate_group* _notify_aggregate_match(NotifySession s,
+		Notification n);
+/* aggregate n into the summary of g */
+NotifyError _notify_aggregate_add(NotifySession s,
+		struct _notify_aggregate_group* g, Notification n, va_list ap);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_AGGREGATE__H*/
@@ -0,0 +1,274 @@
+/* libtinynotify -- raw notification bodies
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+
+#include "common_.h"
+#include "notification_.h"
+#include "utf8_.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+const size_t NOTIFICATION_BODY_NO_LIMIT = 0;
+
+/* files smaller than that are read rather than mapped */
+#define BODY_MMAP_THRESHOLD (64 * 1024)
+#define BODY_READ_CHUNK 4096
+
+void _notification_body_free(Notification n) {
+	switch (n->body_type) {
+		case _NOTIFICATION_BODY_STRING:
+		case _NOTIFICATION_BODY_ALLOCATED:
+			if (n->body)
+				free(n->body);
+			break;
+		case _NOTIFICATION_BODY_MAPPED:
+			munmap(n->body_map, n->body_map_len);
+			break;
+		case _NOTIFICATION_BODY_BORROWED:
+			break;
+	}
+
+	n->body = NULL;
+	n->body_type = _NOTIFICATION_BODY_STRING;
+}
+
+/* get the number of bytes to skip at the start of data, in order not to
+ * start with a partial UTF-8 character (e.g. when reading from an arbitrary
+ * offset) */
+static size_t _body_skip(const char* data, size_t len) {
+	size_t i;
+
+	for (i = 0; i < len && i < 3; i++) {
+		if (((unsigned char) data[i] & 0xc0) != 0x80)
+			break;
+	}
+
+	return i;
+}
+
+/* get the length of the body within data (already cut to the byte limit),
+ * applying the line limit; the body ends at the first NUL, as D-Bus strings
+ * can't contain it */
+static size_t _body_cut(const char* data, size_t len, unsigned int max_lines) {
+	const char *p, *nl;
+	unsigned int lines = 0;
+	size_t i, seq_len;
+	unsigned char lead;
+
+	if ((p = memchr(data, 0, len)))
+		return p - data;
+
+	if (max_lines) {
+		for (p = data; (nl = memchr(p, '\n', len - (p - data))); p = nl + 1) {
+			/* a cut on a newline is always on a character boundary */
+			if (++lines == max_lines)
+				return nl - data;
+		}
+	}
+
+	/* don't leave a multibyte UTF-8 character split by the byte limit;
+	 * find the start of the last character first */
+	for (i = len; i > 0 && len - i < 4; i--) {
+		if (((unsigned char) data[i - 1] & 0xc0) != 0x80)
+			break;
+	}
+	if (!i)
+		return len;
+
+	lead = data[i - 1];
+	if (lead >= 0xf0)
+		seq_len = 4;
+	else if (lead >= 0xe0)
+		seq_len = 3;
+	else if (lead >= 0xc0)
+		seq_len = 2;
+	else
+		seq_len = 1;
+
+	return i - 1 + seq_len > len ? i - 1 : len;
+}
+
+/* map and map_len are only used for _NOTIFICATION_BODY_MAPPED */
+static void _notification_body_set_raw(Notification n, char* body,
+		size_t len, int type, void* map, size_t map_len) {
+	size_t valid_len = _notify_utf8_valid_len(body, len);
+
+	_notification_body_free(n);
+	n->body = body;
+	n->body_len = len;
+	n->body_type = type;
+	n->body_map = map;
+	n->body_map_len = map_len;
+
+	/* the contents can't be modified in place, so copy them if needed */
+	if (valid_len != len) {
+		_mem_assert(body = _notify_utf8_sanitize(body, len, valid_len, &len));
+		_notification_body_free(n);
+		n->body = body;
+		n->body_len = len;
+		n->body_type = _NOTIFICATION_BODY_ALLOCATED;
+	}
+}
+
+/* buf has to have at least len + 1 bytes allocated */
+static void _notification_body_set_allocated(Notification n, char* buf,
+		size_t len, unsigned int max_lines) {
+	size_t skip = _body_skip(buf, len);
+
+	len = _body_cut(buf + skip, len - skip, max_lines);
+	if (skip)
+		memmove(buf, buf + skip, len);
+	_mem_assert(buf = realloc(buf, len + 1));
+	buf[len] = 0;
+	_notification_body_set_raw(n, buf, len, _NOTIFICATION_BODY_ALLOCATED,
+			NULL, 0);
+}
+
+int notification_set_body_from_buffer(Notification n, const char* data,
+		size_t length, size_t max_bytes, unsigned int max_lines) {
+	size_t skip;
+
+	assert(data || !length);
+
+	if (max_bytes && length > max_bytes)
+		length = max_bytes;
+	if (!length) {
+		_notification_body_set_raw(n, "", 0, _NOTIFICATION_BODY_BORROWED,
+				NULL, 0);
+		return 0;
+	}
+
+	skip = _body_skip(data, length);
+	_notification_body_set_raw(n, (char*) data + skip,
+			_body_cut(data + skip, length - skip, max_lines),
+			_NOTIFICATION_BODY_BORROWED, NULL, 0);
+	return 0;
+}
+
+/* read the body from a stream, stopping as soon as the limits are hit */
+static int _body_read(Notification n, int fd, size_t max_bytes,
+		unsigned int max_lines) {
+	char *buf = NULL;
+	size_t len = 0, alloc = 0;
+	unsigned int lines = 0;
+
+	for (;;) {
+		ssize_t ret;
+		size_t want = BODY_READ_CHUNK;
+		const char *p, *nl;
+
+		if (max_bytes && max_bytes - len < want)
+			want = max_bytes - len;
+		if (!want)
+			break;
+		if (len + want + 1 > alloc) {
+			alloc = alloc ? alloc * 2 : BODY_READ_CHUNK + 1;
+			while (alloc < len + want + 1)
+				alloc *= 2;
+			_mem_assert(buf = realloc(buf, alloc));
+		}
+
+		ret = read(fd, buf + len, want);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			free(buf);
+			return -1;
+		} else if (!ret)
+			break;
+
+		if (memchr(buf + len, 0, ret)) {
+			len += ret;
+			break;
+		}
+		if (max_lines) {
+			for (p = buf + len; (nl = memchr(p, '\n',
+							ret - (p - (buf + len)))); p = nl + 1)
+				lines++;
+		}
+		len += ret;
+		if (max_lines && lines >= max_lines)
+			break;
+	}
+
+	if (!buf)
+		_mem_assert(buf = malloc(1));
+	_notification_body_set_allocated(n, buf, len, max_lines);
+	return 0;
+}
+
+/* read len bytes of a regular file at offset */
+static int _body_pread(Notification n, int fd, off_t offset, size_t len,
+		unsigned int max_lines) {
+	char *buf;
+	size_t done = 0;
+
+	_mem_assert(buf = malloc(len + 1));
+	while (done < len) {
+		ssize_t ret = pread(fd, buf + done, len - done, offset + done);
+
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			free(buf);
+			return -1;
+		} else if (!ret)
+			break;
+		done += ret;
+	}
+
+	_notification_body_set_allocated(n, buf, done, max_lines);
+	return 0;
+}
+
+int notification_set_body_from_fd(Notification n, int fd,
+		size_t max_bytes, unsigned int max_lines) {
+	struct stat st;
+	off_t offset;
+	size_t len, map_offset, skip;
+	long page_size;
+	char *map;
+
+	if (fstat(fd, &st) == -1)
+		return -1;
+	if (!S_ISREG(st.st_mode)
+			|| (offset = lseek(fd, 0, SEEK_CUR)) == -1)
+		return _body_read(n, fd, max_bytes, max_lines);
+
+	len = offset < st.st_size ? st.st_size - offset : 0;
+	if (max_bytes && len > max_bytes)
+		len = max_bytes;
+	if (len < BODY_MMAP_THRESHOLD)
+		return _body_pread(n, fd, offset, len, max_lines);
+
+	/* mmap() needs a page-aligned offset; nothing is written back,
+	 * so the mapping is private */
+	page_size = sysconf(_SC_PAGESIZE);
+	map_offset = offset % page_size;
+	map = mmap(NULL, len + map_offset, PROT_READ, MAP_PRIVATE, fd,
+			offset - map_offset);
+	if (map == MAP_FAILED)
+		return _body_pread(n, fd, offset, len, max_lines);
+
+	skip = _body_skip(map + map_offset, len);
+	_notification_body_set_raw(n, map + map_offset + skip,
+			_body_cut(map + map_offset + skip, len - skip, max_lines),
+			_NOTIFICATION_BODY_MAPPED, map, len + map_offset);
+	return 0;
+}
@@ -5,6 +5,7 @@
 
 #include "config.h"
 #include "common_.h"
+#include "utf8_.h"
 
 #include <stdlib.h>
 #include <stdarg.h>
@@ -27,7 +28,7 @@ void _property_assign_str(char** prop, const char* newval) {
 	if (*prop)
 		free(*prop);
 	if (newval)
-		_mem_assert(*prop = strdup(newval));
+		*prop = _notify_utf8_strdup(newval);
 	else
 		*prop = NULL;
 }
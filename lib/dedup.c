@@ -0,0 +1,147 @@
+/* libtinynotify -- deduplication of repeated notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "dedup.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "stats_.h"
+#include "memory_.h"
+#include "queue_.h"
+#include "dedup_.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const NotifyDedupPolicy NOTIFY_DEDUP_SUPPRESS = 0;
+const NotifyDedupPolicy NOTIFY_DEDUP_UPDATE = 1;
+
+const int NOTIFY_SESSION_NO_DEDUP = 0;
+
+/* the table is direct-mapped; must be a power of two */
+#define DEDUP_SLOTS 64
+
+#define FNV_PRIME 0x100000001b3ULL
+
+void notify_session_set_dedup(NotifySession s, int window,
+		NotifyDedupPolicy policy) {
+	struct _notify_dedup_state *d = &s->dedup;
+
+	d->window = window;
+	d->policy = policy;
+
+	free(d->slots);
+	d->slots = NULL;
+	if (window)
+		_mem_assert(d->slots = calloc(DEDUP_SLOTS, sizeof(*d->slots)));
+}
+
+void _notify_dedup_init(struct _notify_dedup_state* d) {
+	memset(d, 0, sizeof(*d));
+}
+
+void _notify_dedup_free(NotifySession s) {
+	free(s->dedup.slots);
+}
+
+/* FNV-1a, followed by a NUL byte to separate the fields */
+uint64_t _notify_dedup_hash(uint64_t h, const void* data, size_t len) {
+	const unsigned char *p = data;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= FNV_PRIME;
+	}
+	return h * FNV_PRIME;
+}
+
+static uint64_t _dedup_hash_str(uint64_t h, const char* s) {
+	return _notify_dedup_hash(h, s ? s : "", s ? strlen(s) : 0);
+}
+
+int _notify_dedup_check(NotifySession s, Notification n,
+		struct _notification_text* t) {
+	struct _notify_dedup_state *d = &s->dedup;
+	struct _notify_dedup_slot *slot;
+	struct timespec now;
+	uint64_t h = _NOTIFY_DEDUP_HASH_INIT;
+	unsigned char urgency;
+	char *summary;
+	long age;
+
+	urgency = _notification_hints_get_byte(n->hints, "urgency",
+			_notification_hints_get_byte(s->default_hints, "urgency",
+				NOTIFICATION_URGENCY_NORMAL));
+
+	h = _dedup_hash_str(h, s->app_name);
+	h = _dedup_hash_str(h, t->summary);
+	h = _notify_dedup_hash(h, t->body, t->body_len);
+	h = _dedup_hash_str(h, _notification_hints_get_string(n->hints,
+				"category", _notification_hints_get_string(s->default_hints,
+					"category", NULL)));
+	h = _notify_dedup_hash(h, &urgency, 1);
+	/* zero means unused */
+	t->hash = h ? h : 1;
+
+	slot = &d->slots[t->hash & (DEDUP_SLOTS - 1)];
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	age = (now.tv_sec - slot->sent_at.tv_sec) * 1000
+		+ (now.tv_nsec - slot->sent_at.tv_nsec) / 1000000;
+
+	if (slot->hash != t->hash || age > d->window) {
+		_stats_inc(s, dedup_misses);
+		slot->hash = t->hash;
+		slot->id = 0;
+		slot->repeats = 0;
+		slot->sent_at = now;
+		return _NOTIFY_DEDUP_NEW;
+	}
+
+	_stats_inc(s, dedup_hits);
+	slot->repeats++;
+	n->message_id = slot->id;
+	if (d->policy != NOTIFY_DEDUP_UPDATE || !slot->id)
+		return _NOTIFY_DEDUP_SUPPRESS;
+
+	/* the count includes the original */
+	if (asprintf(&summary, "%s (\xc3\x97%lu)", t->summary,
+				slot->repeats + 1) == -1) {
+		_notify_session_out_of_memory(s);
+		return -1;
+	}
+	free(t->summary_buf);
+	t->summary = t->summary_buf = summary;
+	return _NOTIFY_DEDUP_UPDATE;
+}
+
+void _notify_dedup_record(NotifySession s, uint64_t hash, uint32_t id) {
+	struct _notify_dedup_slot *slot;
+
+	if (!s->dedup.slots)
+		return;
+
+	slot = &s->dedup.slots[hash & (DEDUP_SLOTS - 1)];
+	if (slot->hash == hash)
+		slot->id = id;
+}
+
+void _notify_dedup_forget(NotifySession s, uint64_t hash) {
+	struct _notify_dedup_slot *slot;
+
+	if (!s->dedup.slots)
+		return;
+
+	slot = &s->dedup.slots[hash & (DEDUP_SLOTS - 1)];
+	if (slot->hash == hash && !slot->id)
+		slot->hash = 0;
+}
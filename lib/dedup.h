@@ -0,0 +1,76 @@
+/* libtinynotify -- deduplication of repeated notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_DEDUP_H
+#define _TINYNOTIFY_DEDUP_H
+
+/**
+ * SECTION: NotifyDedup
+ * @short_description: API to deduplicate repeated notifications
+ * @include: tinynotify.h
+ *
+ * A #NotifySession can recognize new notifications repeating one sent
+ * recently. The notifications are compared using a hash of the application
+ * name, the formatted summary and body, the category and the urgency.
+ * A notification is a repeat if an identical one was sent (as new) within
+ * the deduplication window.
+ *
+ * The repeats are either suppressed, or sent as updates to the original
+ * notification, with the repeat count appended to the summary. Either way,
+ * the notification gets the ID of the original one, so it can be closed
+ * or updated as usual.
+ *
+ * The recent notifications are kept in a small, fixed-size table; a
+ * notification can be forgotten early if another one takes its slot.
+ * The hits and misses are counted in #NotifyStats.
+ */
+
+/**
+ * NotifyDedupPolicy
+ *
+ * The action taken when a repeated notification is sent.
+ */
+typedef const int NotifyDedupPolicy;
+
+/**
+ * NOTIFY_DEDUP_SUPPRESS
+ *
+ * Do not send the repeat, and report success.
+ */
+extern const NotifyDedupPolicy NOTIFY_DEDUP_SUPPRESS;
+
+/**
+ * NOTIFY_DEDUP_UPDATE
+ *
+ * Send the repeat as an update to the original notification, with
+ * the number of times it was sent appended to the summary (e.g. 'Disk full
+ * (×3)'). If the ID of the original notification is not known yet (because
+ * it is still queued), the repeat is suppressed.
+ */
+extern const NotifyDedupPolicy NOTIFY_DEDUP_UPDATE;
+
+/**
+ * NOTIFY_SESSION_NO_DEDUP
+ *
+ * A window disabling deduplication.
+ */
+extern const int NOTIFY_SESSION_NO_DEDUP;
+
+/**
+ * notify_session_set_dedup
+ * @session: session to operate on
+ * @window: the time a notification is remembered after being sent [ms],
+ *	or %NOTIFY_SESSION_NO_DEDUP
+ * @policy: the action taken on repeats
+ *
+ * Enable or disable deduplicating the notifications sent through @session.
+ * By default, deduplication is disabled. Changing the window or policy
+ * forgets the notifications sent so far.
+ */
+void notify_session_set_dedup(NotifySession session, int window,
+		NotifyDedupPolicy policy);
+
+#endif /*_TINYNOTIFY_DEDUP_H*/
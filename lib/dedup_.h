@@ -0,0 +1,64 @@
+/* libtinynotify -- deduplication of repeated notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_DEDUP__H
+#define _TINYNOTIFY_DEDUP__H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "session.h"
+#include "notification.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notification_text;
+
+struct _notify_dedup_slot {
+	/* zero if unused */
+	uint64_t hash;
+	/* zero until the reply is received */
+	uint32_t id;
+	unsigned long repeats;
+	struct timespec sent_at;
+};
+
+struct _notify_dedup_state {
+	/* zero if disabled */
+	int window;
+	int policy;
+	struct _notify_dedup_slot* slots;
+};
+
+enum _notify_dedup_result {
+	_NOTIFY_DEDUP_NEW,
+	_NOTIFY_DEDUP_SUPPRESS,
+	_NOTIFY_DEDUP_UPDATE
+};
+
+/* FNV-1a of data followed by a NUL byte, continuing from h
+ * (_NOTIFY_DEDUP_HASH_INIT initially) */
+#define _NOTIFY_DEDUP_HASH_INIT 0xcbf29ce484222325ULL
+uint64_t _notify_dedup_hash(uint64_t h, const void* data, size_t len);
+
+void _notify_dedup_init(struct _notify_dedup_state* d);
+void _notify_dedup_free(NotifySession s);
+
+/* check whether new notification n with text t repeats a recent one;
+ * sets t->hash, and the message ID of n for repeats. For updates,
+ * the repeat count is appended to the summary. Returns -1 (with the session
+ * error set) if out of memory. */
+int _notify_dedup_check(NotifySession s, Notification n,
+		struct _notification_text* t);
+/* store the ID the notification with hash was sent as */
+void _notify_dedup_record(NotifySession s, uint64_t hash, uint32_t id);
+/* drop the entry for hash if it wasn't sent after all */
+void _notify_dedup_forget(NotifySession s, uint64_t hash);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_DEDUP__H*/
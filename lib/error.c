@@ -18,3 +18,23 @@ static const struct notify_error _error_invalid_reply = { "Invalid reply receive
 const NotifyError NOTIFY_ERROR_INVALID_REPLY = &_error_invalid_reply;
 static const struct notify_error _error_no_notification_id = { "No notification-id is specified" };
 const NotifyError NOTIFY_ERROR_NO_NOTIFICATION_ID = &_error_no_notification_id;
+static const struct notify_error _error_stats_shm = { "Setting up statistics segment failed: %s" };
+const NotifyError NOTIFY_ERROR_STATS_SHM = &_error_stats_shm;
+static const struct notify_error _error_no_memory = { "Out of memory" };
+const NotifyError NOTIFY_ERROR_NO_MEMORY = &_error_no_memory;
+static const struct notify_error _error_memory_budget = { "Session memory budget exceeded: %lu of %lu bytes in use" };
+const NotifyError NOTIFY_ERROR_MEMORY_BUDGET = &_error_memory_budget;
+static const struct notify_error _error_queue_full = { "Outgoing queue is full" };
+const NotifyError NOTIFY_ERROR_QUEUE_FULL = &_error_queue_full;
+static const struct notify_error _error_rate_limited = { "Notification rate limit exceeded" };
+const NotifyError NOTIFY_ERROR_RATE_LIMITED = &_error_rate_limited;
+static const struct notify_error _error_state_file = { "Setting up the state file failed: %s" };
+const NotifyError NOTIFY_ERROR_STATE_FILE = &_error_state_file;
+static const struct notify_error _error_spool_file = { "Setting up the spool file failed: %s" };
+const NotifyError NOTIFY_ERROR_SPOOL_FILE = &_error_spool_file;
+static const struct notify_error _error_spooled = { "Notification server unavailable, notification spooled" };
+const NotifyError NOTIFY_ERROR_SPOOLED = &_error_spooled;
+static const struct notify_error _error_no_server = { "Notification server unavailable: %s" };
+const NotifyError NOTIFY_ERROR_NO_SERVER = &_error_no_server;
+static const struct notify_error _error_invalid_format = { "Unsupported format string" };
+const NotifyError NOTIFY_ERROR_INVALID_FORMAT = &_error_invalid_format;
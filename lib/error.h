@@ -85,4 +85,90 @@ extern const NotifyError NOTIFY_ERROR_INVALID_REPLY;
  */
 extern const NotifyError NOTIFY_ERROR_NO_NOTIFICATION_ID;
 
+/**
+ * NOTIFY_ERROR_STATS_SHM
+ *
+ * An error occuring while setting up the shared memory segment for
+ * notify_session_publish_stats().
+ */
+extern const NotifyError NOTIFY_ERROR_STATS_SHM;
+
+/**
+ * NOTIFY_ERROR_NO_MEMORY
+ *
+ * An error denoting that a memory allocation failed. It is returned only
+ * if recoverable allocation failures were enabled using
+ * notify_session_set_recoverable_oom(); otherwise, the program is aborted.
+ */
+extern const NotifyError NOTIFY_ERROR_NO_MEMORY;
+
+/**
+ * NOTIFY_ERROR_MEMORY_BUDGET
+ *
+ * An error denoting that the operation would exceed the session memory
+ * budget set using notify_session_set_memory_budget().
+ */
+extern const NotifyError NOTIFY_ERROR_MEMORY_BUDGET;
+
+/**
+ * NOTIFY_ERROR_QUEUE_FULL
+ *
+ * An error denoting that the notification was dropped because
+ * the outgoing queue was full (see notify_session_set_queue()).
+ */
+extern const NotifyError NOTIFY_ERROR_QUEUE_FULL;
+
+/**
+ * NOTIFY_ERROR_RATE_LIMITED
+ *
+ * An error denoting that the notification was rejected because it exceeded
+ * the rate limit (see notify_session_set_rate_limit()).
+ */
+extern const NotifyError NOTIFY_ERROR_RATE_LIMITED;
+
+/**
+ * NOTIFY_ERROR_STATE_FILE
+ *
+ * An error denoting that opening or mapping the state file failed (see
+ * notify_session_set_state_file()). The error message will contain
+ * the system error message.
+ */
+extern const NotifyError NOTIFY_ERROR_STATE_FILE;
+
+/**
+ * NOTIFY_ERROR_SPOOL_FILE
+ *
+ * An error denoting that opening or mapping the spool file failed (see
+ * notify_session_set_spool()). The error message will contain
+ * the system error message.
+ */
+extern const NotifyError NOTIFY_ERROR_SPOOL_FILE;
+
+/**
+ * NOTIFY_ERROR_SPOOLED
+ *
+ * An error denoting that the notification couldn't be sent because
+ * the notification server is unavailable, and it was spooled to be sent
+ * later (see notify_session_set_spool()).
+ */
+extern const NotifyError NOTIFY_ERROR_SPOOLED;
+
+/**
+ * NOTIFY_ERROR_NO_SERVER
+ *
+ * An error denoting that no notification server is running on the bus
+ * (and none could be started). The error message will contain
+ * the D-Bus error message.
+ */
+extern const NotifyError NOTIFY_ERROR_NO_SERVER;
+
+/**
+ * NOTIFY_ERROR_INVALID_FORMAT
+ *
+ * An error denoting that the summary or body format string uses
+ * a conversion which is not supported, or positional arguments along with
+ * markup escaping (see notification_set_escape_markup()).
+ */
+extern const NotifyError NOTIFY_ERROR_INVALID_FORMAT;
+
 #endif /*_TINYNOTIFY_ERROR_H*/
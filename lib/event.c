@@ -14,14 +14,19 @@
 #include "session_.h"
 #include "notification_.h"
 #include "event_.h"
+#include "transport_.h"
+#include "queue_.h"
+#include "registry_.h"
+#include "expiry_.h"
+#include "ratelimit_.h"
+#include "probes_.h"
+#include "utf8_.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
-#include <dbus/dbus.h>
-
 #ifdef HAVE_LIBSTRL
 #	include <strl.h>
 #endif
@@ -34,12 +39,15 @@ const NotificationCloseReason NOTIFICATION_CLOSED_BY_DISCONNECT = 'D';
 const NotificationCloseReason NOTIFICATION_CLOSED_BY_EXPIRATION = 'E';
 const NotificationCloseReason NOTIFICATION_CLOSED_BY_USER = 'U';
 const NotificationCloseReason NOTIFICATION_CLOSED_BY_CALLER = 'C';
+const NotificationCloseReason NOTIFICATION_CLOSED_BY_EVICTION = 'V';
 
 const NotifyDispatchStatus NOTIFY_DISPATCH_DONE = 0;
 const NotifyDispatchStatus NOTIFY_DISPATCH_ALL_CLOSED = 1;
 const NotifyDispatchStatus NOTIFY_DISPATCH_NOT_CONNECTED = 2;
 
 const int NOTIFY_SESSION_NO_TIMEOUT = -1;
+const int NOTIFY_SESSION_NO_EXPIRY_TRACKING = -1;
+const int NOTIFY_SESSION_DEFAULT_SERVER_EXPIRE_TIMEOUT = 10000;
 
 static void _notification_noop_on_close(Notification n, NotificationCloseReason r, void* user_data) {
 }
@@ -72,84 +80,78 @@ void _notification_event_free(Notification n) {
 	}
 }
 
-void _emit_closed(Notification n, NotificationCloseReason reason) {
-	if (n->close_callback)
+void _emit_closed(NotifySession s, Notification n, NotificationCloseReason reason) {
+	/* the key is released first, the callback may reuse it */
+	int registered = _notify_registry_release(s, n);
+
+	if (n->close_callback) {
+		/* the callback may free the notification */
+		uint32_t id = n->message_id;
+
+		_probe(callback__entry, s, id);
 		n->close_callback(n, reason, n->close_data);
+		_probe(callback__return, s, id);
+	} else if (registered) {
+		/* nobody else has it */
+		_notify_queue_transfer(s, n, NULL);
+		notification_free(n);
+	}
 }
 
-static void _notify_session_handle_message(DBusMessage *msg, NotifySession s) {
-	const char *member;
-	int is_notification_closed;
-
-	assert(dbus_message_get_type(msg) == DBUS_MESSAGE_TYPE_SIGNAL);
-	assert(!strcmp(dbus_message_get_interface(msg),
-				"org.freedesktop.Notifications"));
-
-	member = dbus_message_get_member(msg);
-	is_notification_closed = !strcmp(member, "NotificationClosed");
-	if (is_notification_closed || !strcmp(member, "ActionInvoked")) {
-		DBusError err;
-		dbus_uint32_t id, reason;
-		const char *action;
-		int ret;
-
-		dbus_error_init(&err);
-		if (is_notification_closed)
-			ret = dbus_message_get_args(msg, &err,
-					DBUS_TYPE_UINT32, &id,
-					DBUS_TYPE_UINT32, &reason,
-					DBUS_TYPE_INVALID);
-		else
-			ret = dbus_message_get_args(msg, &err,
-					DBUS_TYPE_UINT32, &id,
-					DBUS_TYPE_STRING, &action,
-					DBUS_TYPE_INVALID);
-
-		if (!ret) {
-			/* XXX: error handling? */
-			dbus_error_free(&err);
-		} else {
-			struct _notification_list *nl;
-
-			for (nl = s->notifications; nl; nl = nl->next) {
-				Notification n = nl->n;
-
-				if (n->message_id == id) {
-					if (is_notification_closed) {
-						NotificationCloseReason r;
-
-						switch (reason) {
-							case 1:
-								r = NOTIFICATION_CLOSED_BY_EXPIRATION;
-								break;
-							case 2:
-								r = NOTIFICATION_CLOSED_BY_USER;
-								break;
-							case 3:
-								r = NOTIFICATION_CLOSED_BY_CALLER;
-								break;
-							default:
-								r = 0;
-						}
-
-						_emit_closed(n, r);
-						_notify_session_remove_notification(s, n);
-					} else {
-						struct _notification_action_list *al;
-
-						for (al = n->actions; al; al = al->next) {
-							if (!strcmp(al->key, action)) {
-								al->callback(n, al->key, al->callback_data);
-								break;
-							}
-						}
+static void _notify_session_handle_signal(NotifySession s,
+		const struct _notify_signal* sig) {
+	struct _notification_list *nl;
+
+	if (sig->type == _NOTIFY_SIGNAL_REPLY) {
+		_notify_queue_handle_reply(s, sig);
+		return;
+	}
+
+	_probe(signal__received, s, sig->id);
+	if (sig->type == _NOTIFY_SIGNAL_NOTIFICATION_CLOSED) {
+		_notify_expiry_cancel(s, sig->id);
+		_notify_state_closed(s, sig->id);
+	}
+
+	for (nl = s->notifications; nl; nl = nl->next) {
+		Notification n = nl->n;
+
+		if (n->message_id == sig->id) {
+			if (sig->type == _NOTIFY_SIGNAL_NOTIFICATION_CLOSED) {
+				NotificationCloseReason r;
+
+				switch (sig->reason) {
+					case 1:
+						r = NOTIFICATION_CLOSED_BY_EXPIRATION;
+						break;
+					case 2:
+						r = NOTIFICATION_CLOSED_BY_USER;
+						break;
+					case 3:
+						r = NOTIFICATION_CLOSED_BY_CALLER;
+						break;
+					default:
+						r = 0;
+				}
+
+				/* the callback may free the notification */
+				_notify_session_remove_notification(s, n);
+				_emit_closed(s, n, r);
+			} else {
+				struct _notification_action_list *al;
+
+				for (al = n->actions; al; al = al->next) {
+					if (!strcmp(al->key, sig->action)) {
+						_probe(callback__entry, s, sig->id);
+						al->callback(n, al->key, al->callback_data);
+						_probe(callback__return, s, sig->id);
+						break;
 					}
-					break;
 				}
 			}
+			break;
 		}
-	} else
-		assert(!"reached when invalid signal is received");
+	}
 }
 
 void notification_bind_close_callback(Notification n,
@@ -181,7 +183,7 @@ void notification_bind_action(Notification n,
 		if (!key) /* XXX: something nicer? */
 			_mem_assert(asprintf(&(*al)->key, "_%lx", (long int) *al) != -1);
 		else
-			(*al)->key = strdup(key);
+			(*al)->key = _notify_utf8_strdup(key);
 		(*al)->next = NULL;
 	}
 	a = *al;
@@ -194,26 +196,89 @@ void notification_bind_action(Notification n,
 	}
 
 	if (description)
-		a->desc = strdup(description);
+		a->desc = _notify_utf8_strdup(description);
 	else
-		a->desc = strdup(a->key);
+		a->desc = _notify_utf8_strdup(a->key);
 	a->callback = callback;
 	a->callback_data = user_data;
 }
 
-NotifyDispatchStatus notify_session_dispatch(NotifySession s, int timeout) {
-	DBusMessage *msg;
+void notify_session_set_expiry_tracking(NotifySession s, int grace) {
+	struct _notification_list *nl;
 
-	if (s->conn && !dbus_connection_get_is_connected(s->conn))
+	s->tracking_grace = grace;
+	if (grace < 0) {
+		_notify_wheel_init(&s->tracking);
+		for (nl = s->notifications; nl; nl = nl->next)
+			_notify_timer_init(&nl->timer);
+	}
+}
+
+void notify_session_set_server_expire_timeout(NotifySession s, int timeout) {
+	s->tracking_timeout = timeout;
+}
+
+/* evict the tracked notifications the server didn't report closed */
+static void _notify_session_evict(NotifySession s) {
+	struct _notify_timer *t;
+
+	_notify_wheel_advance(&s->tracking);
+	/* a callback may disconnect the session */
+	while (s->transport_data && (t = _notify_wheel_pop_due(&s->tracking))) {
+		/* the timer is the first member */
+		Notification n = ((struct _notification_list*) t)->n;
+
+		_stats_inc(s, evicted);
+		_notify_session_remove_notification(s, n);
+		_emit_closed(s, n, NOTIFICATION_CLOSED_BY_EVICTION);
+	}
+}
+
+void _notify_session_process(NotifySession s, int timeout) {
+	struct _notify_signal sig;
+	int got_signal;
+
+	/* signals may have been queued already while waiting for a reply;
+	 * block only if there are none (and until the next close is due) */
+	if (!(got_signal = s->transport->pop_signal(s, &sig))) {
+		s->transport->read_write(s, _notify_wheel_timeout(&s->tracking,
+					_notify_ratelimit_timeout(s, _notify_queue_timeout(s,
+							_notify_expiry_timeout(s, timeout)))));
+		got_signal = s->transport->pop_signal(s, &sig);
+	}
+	/* a callback may disconnect the session */
+	for (; got_signal && s->transport_data;
+			got_signal = s->transport->pop_signal(s, &sig))
+		_notify_session_handle_signal(s, &sig);
+
+	if (s->transport_data)
+		_notify_session_evict(s);
+	if (s->transport_data)
+		_notify_expiry_run(s);
+	if (s->transport_data)
+		_notify_ratelimit_run(s);
+}
+
+NotifyDispatchStatus notify_session_dispatch(NotifySession s, int timeout) {
+	if (s->transport_data && !s->transport->is_connected(s))
 		notify_session_disconnect(s);
-	if (!s->conn)
+	if (!s->transport_data)
 		return NOTIFY_DISPATCH_NOT_CONNECTED;
 
-	dbus_connection_read_write_dispatch(s->conn, timeout);
-	while ((msg = dbus_connection_pop_message(s->conn)))
-		_notify_session_handle_message(msg, s);
-
-	if (s->notifications)
+	/* the notifications closed by notification_close() don't need
+	 * to wait for anything */
+	if (s->closing) {
+		_notify_session_emit_closed(s);
+		timeout = 0;
+	}
+	/* a callback may disconnect the session */
+	if (s->transport_data)
+		_notify_session_process(s, timeout);
+	if (s->transport_data)
+		_notify_queue_pump(s);
+
+	if (s->notifications || s->closing || !_notify_queue_empty(&s->queue) || s->expiries
+			|| s->ratelimit.folded)
 		return NOTIFY_DISPATCH_DONE;
 	else
 		return NOTIFY_DISPATCH_ALL_CLOSED;
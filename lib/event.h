@@ -70,6 +70,18 @@ extern const NotificationCloseReason NOTIFICATION_CLOSED_BY_USER;
  */
 extern const NotificationCloseReason NOTIFICATION_CLOSED_BY_CALLER;
 
+/**
+ * NOTIFICATION_CLOSED_BY_EVICTION
+ *
+ * A constant passed to #NotificationCloseCallback when the notification was
+ * evicted by the client-side expiry tracking (see
+ * notify_session_set_expiry_tracking()).
+ *
+ * Like with %NOTIFICATION_CLOSED_BY_DISCONNECT, the notification may still be
+ * open; libtinynotify just stopped waiting for the NotificationClosed signal.
+ */
+extern const NotificationCloseReason NOTIFICATION_CLOSED_BY_EVICTION;
+
 /**
  * NotificationCloseCallback
  * @notification: the notification which was closed
@@ -270,7 +282,8 @@ extern const int NOTIFY_SESSION_NO_TIMEOUT;
  * are expected, and thus used to terminate the main loop. Note, however, that
  * if for some reason the notification daemon doesn't send NotificationClosed
  * signal, the program may deadlock waiting for it. In order to avoid that, one
- * should use a kind of timeout timer.
+ * should use a kind of timeout timer, or enable the client-side expiry
+ * tracking.
  *
  * Return value: %NOTIFY_DISPATCH_DONE (which evaluates to false) unless
  * no more events are expected to come
@@ -278,4 +291,53 @@ extern const int NOTIFY_SESSION_NO_TIMEOUT;
 NotifyDispatchStatus notify_session_dispatch(NotifySession session,
 		int timeout);
 
+/**
+ * NOTIFY_SESSION_NO_EXPIRY_TRACKING
+ *
+ * A constant for notify_session_set_expiry_tracking() disabling the tracking.
+ */
+extern const int NOTIFY_SESSION_NO_EXPIRY_TRACKING;
+
+/**
+ * notify_session_set_expiry_tracking
+ * @session: session to operate on
+ * @grace: the time to wait for the server after the notification expires
+ *	[ms], or %NOTIFY_SESSION_NO_EXPIRY_TRACKING
+ *
+ * Enable or disable the client-side expiry tracking. By default, it is
+ * disabled.
+ *
+ * The notifications with event callbacks are kept in @session until
+ * the server reports them closed. Some servers never do that for expired
+ * notifications, so they would be kept forever. With the expiry tracking,
+ * a notification is evicted (and %NOTIFICATION_CLOSED_BY_EVICTION is passed
+ * to its close callback) once its expiration timeout and @grace pass
+ * after it was sent or last updated. The notifications which don't expire
+ * are never evicted.
+ *
+ * The evictions are done by notify_session_dispatch(), which doesn't
+ * block past the next one.
+ */
+void notify_session_set_expiry_tracking(NotifySession session, int grace);
+
+/**
+ * NOTIFY_SESSION_DEFAULT_SERVER_EXPIRE_TIMEOUT
+ *
+ * The expiration timeout assumed by default for the notifications using
+ * %NOTIFICATION_DEFAULT_EXPIRE_TIMEOUT, in milliseconds.
+ */
+extern const int NOTIFY_SESSION_DEFAULT_SERVER_EXPIRE_TIMEOUT;
+
+/**
+ * notify_session_set_server_expire_timeout
+ * @session: session to operate on
+ * @timeout: the expiration timeout [ms]
+ *
+ * Set the expiration timeout assumed for the notifications using
+ * %NOTIFICATION_DEFAULT_EXPIRE_TIMEOUT by the expiry tracking. It should
+ * match the default of the notification server.
+ */
+void notify_session_set_server_expire_timeout(NotifySession session,
+		int timeout);
+
 #endif /*_TINYNOTIFY_EVENT_H*/
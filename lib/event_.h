@@ -23,7 +23,11 @@ struct _notification_action_list {
 void _notification_event_init(Notification n);
 void _notification_event_free(Notification n);
 
-void _emit_closed(Notification n, NotificationCloseReason reason);
+void _emit_closed(NotifySession s, Notification n, NotificationCloseReason reason);
+
+/* do the I/O (blocking up to timeout if no signals are queued yet)
+ * and handle the signals received */
+void _notify_session_process(NotifySession s, int timeout);
 
 #pragma GCC visibility pop
 #endif /*_TINYNOTIFY_EVENT__H*/
@@ -0,0 +1,155 @@
+/* libtinynotify -- notification time-to-live
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+
+#include "session_.h"
+#include "notification_.h"
+#include "stats_.h"
+#include "memory_.h"
+#include "transport_.h"
+#include "expiry_.h"
+
+#include <stdlib.h>
+
+int _notification_get_deadline(Notification n, struct timespec* deadline) {
+	if (n->ttl < 0)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += n->ttl / 1000;
+	deadline->tv_nsec += (n->ttl % 1000) * 1000000L;
+	if (deadline->tv_nsec >= 1000000000L) {
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000L;
+	}
+	return 1;
+}
+
+/* the time left until deadline [ms], rounded up */
+static long _deadline_remaining(const struct timespec* deadline) {
+	struct timespec now;
+	long ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ret = (deadline->tv_sec - now.tv_sec) * 1000
+		+ (deadline->tv_nsec - now.tv_nsec + 999999) / 1000000;
+	return ret > 0 ? ret : 0;
+}
+
+int _notify_deadline_passed(const struct timespec* deadline) {
+	return !_deadline_remaining(deadline);
+}
+
+static int _deadline_before(const struct timespec* a,
+		const struct timespec* b) {
+	return a->tv_sec < b->tv_sec
+		|| (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+struct _notify_expiry* _notify_expiry_new(NotifySession s,
+		const struct timespec* deadline) {
+	struct _notify_expiry *e;
+
+	if (_notify_session_charge(s, sizeof(*e)))
+		return NULL;
+	if (!(e = malloc(sizeof(*e)))) {
+		_notify_mem_release(s, sizeof(*e));
+		_notify_session_out_of_memory(s);
+		return NULL;
+	}
+
+	e->deadline = *deadline;
+	return e;
+}
+
+void _notify_expiry_discard(NotifySession s, struct _notify_expiry* e) {
+	free(e);
+	_notify_mem_release(s, sizeof(*e));
+}
+
+void _notify_expiry_schedule(NotifySession s, struct _notify_expiry* e,
+		uint32_t id) {
+	struct _notify_expiry **ep;
+
+	_notify_expiry_cancel(s, id);
+
+	/* keep the list sorted by deadline */
+	for (ep = &s->expiries; *ep; ep = &(*ep)->next) {
+		if (_deadline_before(&e->deadline, &(*ep)->deadline))
+			break;
+	}
+
+	e->id = id;
+	e->next = *ep;
+	*ep = e;
+}
+
+void _notify_expiry_cancel(NotifySession s, uint32_t id) {
+	struct _notify_expiry **ep;
+
+	for (ep = &s->expiries; *ep; ep = &(*ep)->next) {
+		if ((*ep)->id == id) {
+			struct _notify_expiry *e = *ep;
+
+			*ep = e->next;
+			_notify_expiry_discard(s, e);
+			break;
+		}
+	}
+}
+
+void _notify_expiry_clear(NotifySession s) {
+	struct _notify_expiry *e, *next;
+
+	for (e = s->expiries; e; e = next) {
+		next = e->next;
+		_notify_expiry_discard(s, e);
+	}
+	s->expiries = NULL;
+}
+
+int _notify_expiry_timeout(NotifySession s, int timeout) {
+	long remaining;
+
+	if (!s->expiries)
+		return timeout;
+
+	remaining = _deadline_remaining(&s->expiries->deadline);
+	if (timeout < 0 || remaining < timeout)
+		return remaining;
+	return timeout;
+}
+
+void _notify_expiry_run(NotifySession s) {
+	struct _notify_expiry *e;
+	int sent = 0;
+
+	while ((e = s->expiries) && _notify_deadline_passed(&e->deadline)) {
+		struct _notify_call c;
+		uint32_t serial;
+
+		s->expiries = e->next;
+
+		/* the reply is not waited for; the server will send
+		 * NotificationClosed if the notification is still open */
+		c.method = _NOTIFY_CALL_CLOSE_NOTIFICATION;
+		c.id = e->id;
+		if (!s->transport->send(s, &c, &serial)) {
+			_stats_inc(s, ttl_closed);
+			sent = 1;
+		} else
+			_stats_inc(s, failed);
+
+		_notify_expiry_discard(s, e);
+	}
+
+	if (sent)
+		s->transport->read_write(s, 0);
+}
@@ -0,0 +1,50 @@
+/* libtinynotify -- notification time-to-live
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_EXPIRY__H
+#define _TINYNOTIFY_EXPIRY__H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "session.h"
+#include "notification.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+/* a notification to be closed when its time-to-live passes */
+struct _notify_expiry {
+	uint32_t id;
+	struct timespec deadline;
+
+	struct _notify_expiry* next;
+};
+
+/* get the deadline for n sent now; returns zero if it has no TTL */
+int _notification_get_deadline(Notification n, struct timespec* deadline);
+int _notify_deadline_passed(const struct timespec* deadline);
+
+/* allocate (and charge) an entry to be scheduled once the notification ID
+ * is known; returns NULL (with the session error set) on failure */
+struct _notify_expiry* _notify_expiry_new(NotifySession s,
+		const struct timespec* deadline);
+/* schedule e for the notification id (taking it over) */
+void _notify_expiry_schedule(NotifySession s, struct _notify_expiry* e,
+		uint32_t id);
+/* free an entry which was not scheduled */
+void _notify_expiry_discard(NotifySession s, struct _notify_expiry* e);
+/* unschedule the close of the notification id, if any */
+void _notify_expiry_cancel(NotifySession s, uint32_t id);
+void _notify_expiry_clear(NotifySession s);
+
+/* shorten timeout [ms] to the next deadline */
+int _notify_expiry_timeout(NotifySession s, int timeout);
+/* close the notifications whose deadlines passed */
+void _notify_expiry_run(NotifySession s);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_EXPIRY__H*/
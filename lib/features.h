@@ -35,4 +35,166 @@
  */
 #define LIBTINYNOTIFY_HAS_ACTIONS 1
 
+/**
+ * LIBTINYNOTIFY_HAS_TIMING
+ *
+ * Denotes that libtinynotify is capable of timing the phases of send calls;
+ * basically, notify_session_set_timing() and relevant types.
+ */
+#define LIBTINYNOTIFY_HAS_TIMING 1
+
+/**
+ * LIBTINYNOTIFY_HAS_STATS
+ *
+ * Denotes that libtinynotify keeps session traffic counters, and is able
+ * to publish them for tinynotify-top; basically, notify_session_get_stats()
+ * and notify_session_publish_stats().
+ */
+#define LIBTINYNOTIFY_HAS_STATS 1
+
+/**
+ * LIBTINYNOTIFY_HAS_TRANSPORTS
+ *
+ * Denotes that libtinynotify supports choosing the message transport,
+ * and exposes the event file descriptor; basically,
+ * notify_session_set_transport() and notify_session_get_fd().
+ */
+#define LIBTINYNOTIFY_HAS_TRANSPORTS 1
+
+/**
+ * LIBTINYNOTIFY_HAS_PEER_TO_PEER
+ *
+ * Denotes that libtinynotify is able to connect directly to the notification
+ * server; basically, notify_session_set_peer_to_peer().
+ */
+#define LIBTINYNOTIFY_HAS_PEER_TO_PEER 1
+
+/**
+ * LIBTINYNOTIFY_HAS_HINTS
+ *
+ * Denotes that libtinynotify supports setting arbitrary hints; basically,
+ * notification_set_hint_string() and relevant functions.
+ */
+#define LIBTINYNOTIFY_HAS_HINTS 1
+
+/**
+ * LIBTINYNOTIFY_HAS_SESSION_HINTS
+ *
+ * Denotes that libtinynotify supports default hints for all notifications
+ * in a session; basically, notify_session_set_hint_string() and relevant
+ * functions.
+ */
+#define LIBTINYNOTIFY_HAS_SESSION_HINTS 1
+
+/**
+ * LIBTINYNOTIFY_HAS_IMAGES
+ *
+ * Denotes that libtinynotify supports attaching images to notifications;
+ * basically, notification_set_image_data() and relevant functions.
+ */
+#define LIBTINYNOTIFY_HAS_IMAGES 1
+
+/**
+ * LIBTINYNOTIFY_HAS_RAW_BODY
+ *
+ * Denotes that libtinynotify is able to take the notification body from
+ * a file or a buffer; basically, notification_set_body_from_fd()
+ * and notification_set_body_from_buffer().
+ */
+#define LIBTINYNOTIFY_HAS_RAW_BODY 1
+
+/**
+ * LIBTINYNOTIFY_HAS_MARKUP_ESCAPE
+ *
+ * Denotes that libtinynotify is able to escape markup in notification
+ * bodies; basically, notification_set_escape_markup(), notify_markup_escape()
+ * and the '%M' format conversion.
+ */
+#define LIBTINYNOTIFY_HAS_MARKUP_ESCAPE 1
+
+/**
+ * LIBTINYNOTIFY_HAS_MEMORY_BUDGET
+ *
+ * Denotes that libtinynotify supports recoverable allocation failures
+ * and per-session memory budgets; basically,
+ * notify_session_set_recoverable_oom(), notify_session_set_memory_budget()
+ * and relevant functions.
+ */
+#define LIBTINYNOTIFY_HAS_MEMORY_BUDGET 1
+
+/**
+ * LIBTINYNOTIFY_HAS_QUEUE
+ *
+ * Denotes that libtinynotify supports a bounded outgoing queue;
+ * basically, notify_session_set_queue(), notify_session_flush()
+ * and relevant functions.
+ */
+#define LIBTINYNOTIFY_HAS_QUEUE 1
+
+/**
+ * LIBTINYNOTIFY_HAS_TTL
+ *
+ * Denotes that libtinynotify supports notification time-to-live;
+ * basically, notification_set_ttl() and notification_set_close_on_ttl().
+ */
+#define LIBTINYNOTIFY_HAS_TTL 1
+
+/**
+ * LIBTINYNOTIFY_HAS_RATE_LIMIT
+ *
+ * Denotes that libtinynotify supports limiting the rate of notifications;
+ * basically, notify_session_set_rate_limit() and relevant functions.
+ */
+#define LIBTINYNOTIFY_HAS_RATE_LIMIT 1
+
+/**
+ * LIBTINYNOTIFY_HAS_AGGREGATION
+ *
+ * Denotes that libtinynotify is able to aggregate bursts of notifications;
+ * basically, notify_session_set_aggregation() and relevant functions.
+ */
+#define LIBTINYNOTIFY_HAS_AGGREGATION 1
+
+/**
+ * LIBTINYNOTIFY_HAS_DEDUP
+ *
+ * Denotes that libtinynotify is able to deduplicate repeated notifications;
+ * basically, notify_session_set_dedup().
+ */
+#define LIBTINYNOTIFY_HAS_DEDUP 1
+
+/**
+ * LIBTINYNOTIFY_HAS_EXPIRY_TRACKING
+ *
+ * Denotes that libtinynotify is able to evict the expired notifications
+ * client-side; basically, notify_session_set_expiry_tracking()
+ * and %NOTIFICATION_CLOSED_BY_EVICTION.
+ */
+#define LIBTINYNOTIFY_HAS_EXPIRY_TRACKING 1
+
+/**
+ * LIBTINYNOTIFY_HAS_REGISTRY
+ *
+ * Denotes that libtinynotify is able to keep notifications addressable
+ * by application keys; basically, notify_session_register()
+ * and notify_session_lookup().
+ */
+#define LIBTINYNOTIFY_HAS_REGISTRY 1
+
+/**
+ * LIBTINYNOTIFY_HAS_STATE_FILE
+ *
+ * Denotes that libtinynotify is able to keep the notification IDs across
+ * restarts; basically, notify_session_set_state_file().
+ */
+#define LIBTINYNOTIFY_HAS_STATE_FILE 1
+
+/**
+ * LIBTINYNOTIFY_HAS_SPOOL
+ *
+ * Denotes that libtinynotify is able to spool the notifications while
+ * the server is unavailable; basically, notify_session_set_spool().
+ */
+#define LIBTINYNOTIFY_HAS_SPOOL 1
+
 #endif /*_TINYNOTIFY_FEATURES_H*/
@@ -0,0 +1,421 @@
+/* libtinynotify -- summary & body formatting
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "common_.h"
+#include "format_.h"
+#include "markup_.h"
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <wchar.h>
+
+#ifdef HAVE_LIBSTRL
+#	include <strl.h>
+#endif
+
+void _notify_strbuf_init(struct _notify_strbuf* b, size_t initial) {
+	b->len = 0;
+	b->alloc = initial ? initial : 1;
+	b->failed = 0;
+	if (!(b->data = malloc(b->alloc))) {
+		b->alloc = 0;
+		b->failed = 1;
+		return;
+	}
+	b->data[0] = 0;
+}
+
+int _notify_strbuf_reserve(struct _notify_strbuf* b, size_t len) {
+	if (b->failed)
+		return -1;
+	if (b->len + len + 1 > b->alloc) {
+		size_t new_alloc = b->alloc;
+		char *new_data;
+
+		while (new_alloc < b->len + len + 1)
+			new_alloc *= 2;
+		if (!(new_data = realloc(b->data, new_alloc))) {
+			b->failed = 1;
+			return -1;
+		}
+		b->data = new_data;
+		b->alloc = new_alloc;
+	}
+
+	return 0;
+}
+
+void _notify_strbuf_append(struct _notify_strbuf* b, const char* s,
+		size_t len) {
+	if (_notify_strbuf_reserve(b, len))
+		return;
+	memcpy(b->data + b->len, s, len);
+	b->len += len;
+	b->data[b->len] = 0;
+}
+
+/* the parts of a conversion specification, before the conversion */
+#define FORMAT_FLAGS "#0- +'I"
+#define FORMAT_DIGITS "0123456789"
+#define FORMAT_LENGTHS "hlLqjzt"
+
+/* check whether fmt uses positional arguments (%n$) */
+static int _format_is_positional(const char* fmt) {
+	const char *p;
+
+	for (p = fmt; (p = strchr(p, '%')); p++) {
+		p++;
+		p += strspn(p, FORMAT_DIGITS);
+		if (*p == '$')
+			return 1;
+		if (*p == '%')
+			continue;
+	}
+
+	return 0;
+}
+
+/* check whether fmt uses the %M conversion */
+static int _format_uses_markup(const char* fmt) {
+	const char *p;
+
+	for (p = fmt; (p = strchr(p, '%')); p++) {
+		p++;
+		p += strspn(p, FORMAT_FLAGS FORMAT_DIGITS "$*." FORMAT_LENGTHS);
+		if (*p == 'M')
+			return 1;
+		if (!*p)
+			break;
+	}
+
+	return 0;
+}
+
+/* the argument types, as determined by the length modifier and conversion */
+enum _format_arg_type {
+	FORMAT_INT,
+	FORMAT_LONG,
+	FORMAT_LONG_LONG,
+	FORMAT_INTMAX,
+	FORMAT_SIZE,
+	FORMAT_PTRDIFF,
+	FORMAT_DOUBLE,
+	FORMAT_LONG_DOUBLE,
+	FORMAT_WINT,
+	FORMAT_STRING,
+	FORMAT_WSTRING,
+	FORMAT_POINTER,
+	/* %m, a string not taken from the arguments */
+	FORMAT_STRERROR,
+	FORMAT_INVALID
+};
+
+union _format_arg {
+	int i;
+	long l;
+	long long ll;
+	intmax_t im;
+	size_t sz;
+	ptrdiff_t pd;
+	double d;
+	long double ld;
+	wint_t wi;
+	const char* s;
+	const wchar_t* ws;
+	void* p;
+};
+
+/* format a single conversion (with the '*' values in stars) and append
+ * the result to b */
+static int _format_append_one(struct _notify_strbuf* b, const char* spec,
+		int nstars, const int* stars, enum _format_arg_type type,
+		const union _format_arg* arg) {
+	int ret;
+
+	if (b->failed)
+		return -1;
+
+	for (;;) {
+		size_t avail = b->alloc - b->len;
+		char *out = b->data + b->len;
+
+#define FORMAT_CALL(val) \
+		(nstars == 2 ? snprintf(out, avail, spec, stars[0], stars[1], val) \
+		: nstars == 1 ? snprintf(out, avail, spec, stars[0], val) \
+		: snprintf(out, avail, spec, val))
+
+		switch (type) {
+			case FORMAT_INT: ret = FORMAT_CALL(arg->i); break;
+			case FORMAT_LONG: ret = FORMAT_CALL(arg->l); break;
+			case FORMAT_LONG_LONG: ret = FORMAT_CALL(arg->ll); break;
+			case FORMAT_INTMAX: ret = FORMAT_CALL(arg->im); break;
+			case FORMAT_SIZE: ret = FORMAT_CALL(arg->sz); break;
+			case FORMAT_PTRDIFF: ret = FORMAT_CALL(arg->pd); break;
+			case FORMAT_DOUBLE: ret = FORMAT_CALL(arg->d); break;
+			case FORMAT_LONG_DOUBLE: ret = FORMAT_CALL(arg->ld); break;
+			case FORMAT_WINT: ret = FORMAT_CALL(arg->wi); break;
+			case FORMAT_STRING: ret = FORMAT_CALL(arg->s); break;
+			case FORMAT_WSTRING: ret = FORMAT_CALL(arg->ws); break;
+			case FORMAT_POINTER: ret = FORMAT_CALL(arg->p); break;
+			default: return -1;
+		}
+#undef FORMAT_CALL
+
+		if (ret < 0)
+			return -1;
+		if ((size_t) ret < avail)
+			break;
+		if (_notify_strbuf_reserve(b, ret))
+			return -1;
+	}
+
+	b->len += ret;
+	return 0;
+}
+
+/* format fmt into b, consuming the arguments from ap; errnum is used
+ * for %m */
+static int _format_append(struct _notify_strbuf* b, const char* fmt,
+		int escape, int errnum, va_list* ap) {
+	const char *p = fmt;
+	char spec[64];
+
+	for (;;) {
+		const char *start = strchr(p, '%');
+		const char *conv;
+		size_t len, spec_len;
+		int nstars = 0, stars[2];
+		int escape_arg;
+		enum _format_arg_type type;
+		union _format_arg arg;
+
+		if (!start) {
+			_notify_strbuf_append(b, p, strlen(p));
+			return 0;
+		}
+		_notify_strbuf_append(b, p, start - p);
+
+		/* flags, width, precision, length */
+		conv = start + 1;
+		conv += strspn(conv, FORMAT_FLAGS);
+		if (*conv == '*') {
+			stars[nstars++] = va_arg(*ap, int);
+			conv++;
+		} else
+			conv += strspn(conv, FORMAT_DIGITS);
+		if (*conv == '.') {
+			conv++;
+			if (*conv == '*') {
+				stars[nstars++] = va_arg(*ap, int);
+				conv++;
+			} else
+				conv += strspn(conv, FORMAT_DIGITS);
+		}
+		len = strspn(conv, FORMAT_LENGTHS);
+		conv += len;
+
+		/* invalid specifications are output literally, like glibc does */
+		if (!*conv) {
+			_notify_strbuf_append(b, start, strlen(start));
+			return 0;
+		}
+		p = conv + 1;
+		spec_len = conv - start + 1;
+		if (spec_len >= sizeof(spec))
+			return _NOTIFY_FORMAT_INVALID;
+		memcpy(spec, start, spec_len);
+		spec[spec_len] = 0;
+
+		escape_arg = 0;
+		switch (*conv) {
+			case '%':
+				_notify_strbuf_append(b, "%", 1);
+				continue;
+			case 'd': case 'i':
+			case 'o': case 'u': case 'x': case 'X':
+				if (len == 1 && conv[-1] == 'l')
+					type = FORMAT_LONG;
+				else if (len == 2 && conv[-1] == 'l')
+					type = FORMAT_LONG_LONG;
+				else if (len == 1 && (conv[-1] == 'q' || conv[-1] == 'L'))
+					type = FORMAT_LONG_LONG;
+				else if (len == 1 && conv[-1] == 'j')
+					type = FORMAT_INTMAX;
+				else if (len == 1 && conv[-1] == 'z')
+					type = FORMAT_SIZE;
+				else if (len == 1 && conv[-1] == 't')
+					type = FORMAT_PTRDIFF;
+				else if (len && conv[-1] != 'h')
+					type = FORMAT_INVALID;
+				else /* promoted */
+					type = FORMAT_INT;
+				break;
+			case 'e': case 'E': case 'f': case 'F':
+			case 'g': case 'G': case 'a': case 'A':
+				type = len == 1 && conv[-1] == 'L'
+					? FORMAT_LONG_DOUBLE : FORMAT_DOUBLE;
+				break;
+			case 'c':
+				type = len == 1 && conv[-1] == 'l' ? FORMAT_WINT : FORMAT_INT;
+				escape_arg = escape;
+				break;
+			case 's':
+				type = len == 1 && conv[-1] == 'l'
+					? FORMAT_WSTRING : FORMAT_STRING;
+				escape_arg = escape;
+				break;
+			case 'M':
+				if (len) {
+					type = FORMAT_INVALID;
+					break;
+				}
+				spec[spec_len - 1] = 's';
+				type = FORMAT_STRING;
+				escape_arg = 1;
+				break;
+			case 'm':
+				if (len) {
+					type = FORMAT_INVALID;
+					break;
+				}
+				spec[spec_len - 1] = 's';
+				type = FORMAT_STRERROR;
+				escape_arg = escape;
+				break;
+			case 'p':
+				type = FORMAT_POINTER;
+				break;
+			case 'n':
+				/* not supported, the pointer is just skipped */
+				(void) va_arg(*ap, void*);
+				continue;
+			default:
+				type = FORMAT_INVALID;
+		}
+
+		switch (type) {
+			/* the size of the argument is unknown, so none of the following
+			 * arguments could be pulled correctly */
+			case FORMAT_INVALID: return _NOTIFY_FORMAT_INVALID;
+			case FORMAT_STRERROR:
+				arg.s = strerror(errnum);
+				type = FORMAT_STRING;
+				break;
+			case FORMAT_INT: arg.i = va_arg(*ap, int); break;
+			case FORMAT_LONG: arg.l = va_arg(*ap, long); break;
+			case FORMAT_LONG_LONG: arg.ll = va_arg(*ap, long long); break;
+			case FORMAT_INTMAX: arg.im = va_arg(*ap, intmax_t); break;
+			case FORMAT_SIZE: arg.sz = va_arg(*ap, size_t); break;
+			case FORMAT_PTRDIFF: arg.pd = va_arg(*ap, ptrdiff_t); break;
+			case FORMAT_DOUBLE: arg.d = va_arg(*ap, double); break;
+			case FORMAT_LONG_DOUBLE: arg.ld = va_arg(*ap, long double); break;
+			case FORMAT_WINT: arg.wi = va_arg(*ap, wint_t); break;
+			case FORMAT_STRING: arg.s = va_arg(*ap, const char*); break;
+			case FORMAT_WSTRING: arg.ws = va_arg(*ap, const wchar_t*); break;
+			case FORMAT_POINTER: arg.p = va_arg(*ap, void*); break;
+		}
+
+		if (!escape_arg) {
+			if (_format_append_one(b, spec, nstars, stars, type, &arg))
+				return -1;
+		} else if (type == FORMAT_STRING && spec_len == 2 && arg.s) {
+			/* the common case, escape straight from the argument */
+			_notify_markup_escape_append(b, arg.s, strlen(arg.s));
+		} else {
+			/* format it first, to apply the width and precision */
+			size_t piece_start = b->len;
+			char *piece;
+
+			if (_format_append_one(b, spec, nstars, stars, type, &arg))
+				return -1;
+			if (_notify_markup_scan(b->data + piece_start,
+						b->len - piece_start) != b->len - piece_start) {
+				if (!(piece = strdup(b->data + piece_start)))
+					return -1;
+				b->len = piece_start;
+				_notify_markup_escape_append(b, piece, strlen(piece));
+				free(piece);
+			}
+		}
+	}
+}
+
+/* format the strings using printf(), which knows nothing about the escaping */
+static int _format_printf(char** summary, const char* summary_fmt,
+		char** body, const char* body_fmt, int errnum, va_list ap) {
+	const char *body_out;
+	int ret;
+
+	/* for %m */
+	errno = errnum;
+	if (!body_fmt) {
+		ret = vasprintf(summary, summary_fmt, ap);
+		return ret == -1 ? -1 : 0;
+	}
+
+	/* the arguments can be referenced by both strings */
+	if (_dual_vasprintf(summary, summary_fmt, &body_out, body_fmt, ap) == -1)
+		return -1;
+	if (!(*body = strdup(body_out))) {
+		free(*summary);
+		return -1;
+	}
+	return 0;
+}
+
+int _notify_format(char** summary, const char* summary_fmt,
+		char** body, const char* body_fmt, int escape_body, va_list ap) {
+	struct _notify_strbuf sb, bb;
+	/* before the allocations have a chance to change it */
+	int errnum = errno;
+	int escaping = _format_uses_markup(summary_fmt) || (body_fmt
+			&& (escape_body || _format_uses_markup(body_fmt)));
+	va_list aq;
+	int ret;
+
+	if (_format_is_positional(summary_fmt)
+			|| (body_fmt && _format_is_positional(body_fmt))) {
+		if (escaping)
+			return _NOTIFY_FORMAT_INVALID;
+		return _format_printf(summary, summary_fmt, body, body_fmt,
+				errnum, ap);
+	}
+
+	va_copy(aq, ap);
+	_notify_strbuf_init(&sb, strlen(summary_fmt) + 64);
+	ret = _format_append(&sb, summary_fmt, 0, errnum, &aq);
+	if (!ret && sb.failed)
+		ret = -1;
+	if (!ret && body_fmt) {
+		_notify_strbuf_init(&bb, strlen(body_fmt) + 64);
+		ret = _format_append(&bb, body_fmt, escape_body, errnum, &aq);
+		if (!ret && bb.failed)
+			ret = -1;
+		if (ret)
+			free(bb.data);
+		else
+			*body = bb.data;
+	}
+	va_end(aq);
+
+	if (ret) {
+		free(sb.data);
+		/* the conversions unknown here (e.g. %S, or the ones registered
+		 * using register_printf_function()) are left to printf() */
+		if (ret == _NOTIFY_FORMAT_INVALID && !escaping)
+			return _format_printf(summary, summary_fmt, body, body_fmt,
+					errnum, ap);
+		return ret;
+	}
+	*summary = sb.data;
+	return 0;
+}
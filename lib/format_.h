@@ -0,0 +1,47 @@
+/* libtinynotify -- summary & body formatting
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_FORMAT__H
+#define _TINYNOTIFY_FORMAT__H
+
+#include <stddef.h>
+#include <stdarg.h>
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+/* a growing, NUL-terminated string buffer; if an allocation fails,
+ * failed is set and the further appends are ignored */
+struct _notify_strbuf {
+	char* data;
+	size_t len;
+	size_t alloc;
+
+	int failed;
+};
+
+void _notify_strbuf_init(struct _notify_strbuf* b, size_t initial);
+/* returns non-zero on failure */
+int _notify_strbuf_reserve(struct _notify_strbuf* b, size_t len);
+void _notify_strbuf_append(struct _notify_strbuf* b, const char* s,
+		size_t len);
+
+/* returned by _notify_format() for the formats it can't handle */
+#define _NOTIFY_FORMAT_INVALID -2
+
+/* format summary_fmt, then body_fmt (if not NULL) with the following
+ * arguments, as if they were a single format string. In addition to the
+ * printf() conversions, %M outputs a string argument with markup
+ * escaped; if escape_body is set, %s, %c and %m in body_fmt do that
+ * as well. The results are newly-allocated; the body is NULL if body_fmt is.
+ * Returns 0 on success, -1 if out of memory, or _NOTIFY_FORMAT_INVALID
+ * for unknown conversions and for positional arguments combined
+ * with escaping. */
+int _notify_format(char** summary, const char* summary_fmt,
+		char** body, const char* body_fmt, int escape_body, va_list ap);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_FORMAT__H*/
@@ -0,0 +1,230 @@
+/* libtinynotify -- notification hints
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+#include "hints.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "transport_.h"
+#include "wire_.h"
+#include "utf8_.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+static struct _notification_hint** _notification_hints_find(
+		struct _notification_hint** list, const char* key) {
+	struct _notification_hint **h;
+
+	for (h = list; *h; h = &(*h)->next) {
+		if (!strcmp(_notification_hint_key(*h), key))
+			break;
+	}
+
+	return h;
+}
+
+void _notification_hints_set(struct _notification_hint** list,
+		const char* key, char type, const void* value, size_t value_len) {
+	struct _notification_hint **hp, *h;
+	struct _notify_wire_buf w;
+	char *fixed_key = NULL, *fixed_value = NULL;
+	size_t key_len;
+
+	assert(key);
+
+	key_len = strlen(key);
+	_mem_assert(key = _notify_utf8_check(key, &key_len, &fixed_key));
+	if (type == 's')
+		_mem_assert(value = _notify_utf8_check(value, &value_len,
+					&fixed_value));
+
+	memset(&w, 0, sizeof(w));
+	hp = _notification_hints_find(list, key);
+	if (*hp) {
+		/* replace in place, keeping the order */
+		h = *hp;
+		free(h->blob);
+	} else {
+		_mem_assert(h = malloc(sizeof(*h)));
+		h->next = NULL;
+		*hp = h;
+	}
+
+	h->type = type;
+	h->value_offset = _notify_wire_encode_hint(&w, key, type,
+			value, value_len);
+	_mem_assert(!w.failed);
+	h->value_len = value_len;
+	h->blob = w.data;
+	h->len = w.len;
+
+	free(fixed_key);
+	free(fixed_value);
+}
+
+void _notification_hints_remove(struct _notification_hint** list,
+		const char* key) {
+	struct _notification_hint **hp = _notification_hints_find(list, key);
+	struct _notification_hint *h = *hp;
+
+	if (h) {
+		*hp = h->next;
+		free(h->blob);
+		free(h);
+	}
+}
+
+int _notification_hints_contain(const struct _notification_hint* list,
+		const char* key) {
+	for (; list; list = list->next) {
+		if (!strcmp(_notification_hint_key(list), key))
+			return 1;
+	}
+
+	return 0;
+}
+
+int _notification_hints_get_byte(const struct _notification_hint* list,
+		const char* key, int def) {
+	for (; list; list = list->next) {
+		if (list->type == 'y' && !strcmp(_notification_hint_key(list), key))
+			return list->blob[list->value_offset];
+	}
+
+	return def;
+}
+
+const char* _notification_hints_get_string(
+		const struct _notification_hint* list, const char* key,
+		const char* def) {
+	for (; list; list = list->next) {
+		if (list->type == 's' && !strcmp(_notification_hint_key(list), key))
+			return (const char*) list->blob + list->value_offset;
+	}
+
+	return def;
+}
+
+void _notification_hints_free(struct _notification_hint** list) {
+	struct _notification_hint *h, *next;
+
+	for (h = *list; h; h = next) {
+		next = h->next;
+		free(h->blob);
+		free(h);
+	}
+	*list = NULL;
+}
+
+void notification_remove_hint(Notification n, const char* key) {
+	_notification_hints_remove(&n->hints, key);
+}
+
+int notification_has_hint(Notification n, const char* key) {
+	return _notification_hints_contain(n->hints, key);
+}
+
+void notification_set_hint_string(Notification n, const char* key,
+		const char* value) {
+	assert(value);
+	_notification_hints_set(&n->hints, key, 's', value, strlen(value));
+}
+
+void notification_set_hint_int(Notification n, const char* key, int value) {
+	const int32_t val = value;
+
+	_notification_hints_set(&n->hints, key, 'i', &val, sizeof(val));
+}
+
+void notification_set_hint_byte(Notification n, const char* key,
+		unsigned char value) {
+	const uint8_t val = value;
+
+	_notification_hints_set(&n->hints, key, 'y', &val, sizeof(val));
+}
+
+void notification_set_hint_boolean(Notification n, const char* key,
+		int value) {
+	const uint32_t val = !!value;
+
+	_notification_hints_set(&n->hints, key, 'b', &val, sizeof(val));
+}
+
+void notification_set_hint_byte_array(Notification n, const char* key,
+		const void* data, size_t length) {
+	_notification_hints_set(&n->hints, key, 'a', data, length);
+}
+
+void notification_set_desktop_entry(Notification n,
+		const char* desktop_entry) {
+	if (desktop_entry)
+		notification_set_hint_string(n, "desktop-entry", desktop_entry);
+	else
+		notification_remove_hint(n, "desktop-entry");
+}
+
+void notification_set_transient(Notification n, int transient) {
+	notification_set_hint_boolean(n, "transient", transient);
+}
+
+void notification_set_resident(Notification n, int resident) {
+	notification_set_hint_boolean(n, "resident", resident);
+}
+
+void notification_set_position(Notification n, int x, int y) {
+	notification_set_hint_int(n, "x", x);
+	notification_set_hint_int(n, "y", y);
+}
+
+void notification_set_value(Notification n, int value) {
+	notification_set_hint_int(n, "value", value);
+}
+
+void notify_session_set_hint_string(NotifySession s, const char* key,
+		const char* value) {
+	assert(value);
+	_notification_hints_set(&s->default_hints, key, 's',
+			value, strlen(value));
+}
+
+void notify_session_set_hint_int(NotifySession s, const char* key,
+		int value) {
+	const int32_t val = value;
+
+	_notification_hints_set(&s->default_hints, key, 'i', &val, sizeof(val));
+}
+
+void notify_session_set_hint_byte(NotifySession s, const char* key,
+		unsigned char value) {
+	const uint8_t val = value;
+
+	_notification_hints_set(&s->default_hints, key, 'y', &val, sizeof(val));
+}
+
+void notify_session_set_hint_boolean(NotifySession s, const char* key,
+		int value) {
+	const uint32_t val = !!value;
+
+	_notification_hints_set(&s->default_hints, key, 'b', &val, sizeof(val));
+}
+
+void notify_session_set_hint_byte_array(NotifySession s, const char* key,
+		const void* data, size_t length) {
+	_notification_hints_set(&s->default_hints, key, 'a', data, length);
+}
+
+void notify_session_remove_hint(NotifySession s, const char* key) {
+	_notification_hints_remove(&s->default_hints, key);
+}
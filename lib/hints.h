@@ -0,0 +1,231 @@
+/* libtinynotify -- notification hints
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_HINTS_H
+#define _TINYNOTIFY_HINTS_H
+
+#include <stddef.h>
+
+/**
+ * SECTION: NotifyHints
+ * @short_description: API to set notification hints
+ * @include: tinynotify.h
+ *
+ * Hints are additional, mostly optional properties of a notification which
+ * the notification server may use to alter the way it is displayed.
+ * The Desktop Notification Specification defines a few standard hints;
+ * servers may support additional, vendor-specific ones (prefixed with 'x-').
+ *
+ * A hint is identified by its key, and holds a value of one of the types
+ * below. Setting a hint replaces any previous hint with the same key.
+ * The hints are encoded for the wire when they are set, so re-sending
+ * a notification doesn't need to encode them again.
+ *
+ * The urgency and category (see notification_set_urgency() and
+ * notification_set_category()) are hints as well.
+ *
+ * A #NotifySession can hold default hints as well, which are added
+ * to every notification sent through it. A hint set on the notification
+ * itself overrides the session default with the same key.
+ */
+
+/**
+ * notification_set_hint_string
+ * @notification: notification to operate on
+ * @key: the hint key
+ * @value: the new string value
+ *
+ * Set a string hint. The value will be copied into the #Notification.
+ */
+void notification_set_hint_string(Notification notification,
+		const char* key, const char* value);
+
+/**
+ * notification_set_hint_int
+ * @notification: notification to operate on
+ * @key: the hint key
+ * @value: the new value
+ *
+ * Set a 32-bit signed integer hint.
+ */
+void notification_set_hint_int(Notification notification,
+		const char* key, int value);
+
+/**
+ * notification_set_hint_byte
+ * @notification: notification to operate on
+ * @key: the hint key
+ * @value: the new value
+ *
+ * Set a byte hint.
+ */
+void notification_set_hint_byte(Notification notification,
+		const char* key, unsigned char value);
+
+/**
+ * notification_set_hint_boolean
+ * @notification: notification to operate on
+ * @key: the hint key
+ * @value: zero (false) or non-zero (true)
+ *
+ * Set a boolean hint.
+ */
+void notification_set_hint_boolean(Notification notification,
+		const char* key, int value);
+
+/**
+ * notification_set_hint_byte_array
+ * @notification: notification to operate on
+ * @key: the hint key
+ * @data: the array contents
+ * @length: the array length, in bytes
+ *
+ * Set a byte array hint. The data will be copied into the #Notification.
+ */
+void notification_set_hint_byte_array(Notification notification,
+		const char* key, const void* data, size_t length);
+
+/**
+ * notification_remove_hint
+ * @notification: notification to operate on
+ * @key: the hint key
+ *
+ * Remove the hint with the given key, if set.
+ */
+void notification_remove_hint(Notification notification, const char* key);
+
+/**
+ * notification_has_hint
+ * @notification: notification to operate on
+ * @key: the hint key
+ *
+ * Check whether the hint with the given key is set.
+ *
+ * Returns: non-zero if the hint is set
+ */
+int notification_has_hint(Notification notification, const char* key);
+
+/**
+ * notification_set_desktop_entry
+ * @notification: notification to operate on
+ * @desktop_entry: the desktop file name, without the '.desktop' suffix
+ *
+ * Set the 'desktop-entry' hint, specifying the application sending
+ * the notification. Pass %NULL to remove the hint.
+ */
+void notification_set_desktop_entry(Notification notification,
+		const char* desktop_entry);
+
+/**
+ * notification_set_transient
+ * @notification: notification to operate on
+ * @transient: zero (false) or non-zero (true)
+ *
+ * Set the 'transient' hint. A transient notification bypasses the server's
+ * persistence capability, and is not kept after it expires.
+ */
+void notification_set_transient(Notification notification, int transient);
+
+/**
+ * notification_set_resident
+ * @notification: notification to operate on
+ * @resident: zero (false) or non-zero (true)
+ *
+ * Set the 'resident' hint. A resident notification is not removed
+ * automatically when one of its actions is invoked.
+ */
+void notification_set_resident(Notification notification, int resident);
+
+/**
+ * notification_set_position
+ * @notification: notification to operate on
+ * @x: the x coordinate on the screen
+ * @y: the y coordinate on the screen
+ *
+ * Set the 'x' and 'y' hints, asking the server to point the notification
+ * at the given position.
+ */
+void notification_set_position(Notification notification, int x, int y);
+
+/**
+ * notification_set_value
+ * @notification: notification to operate on
+ * @value: the progress value, in percent (0 to 100)
+ *
+ * Set the 'value' hint, used by some servers to display a progress bar.
+ */
+void notification_set_value(Notification notification, int value);
+
+/**
+ * notify_session_set_hint_string
+ * @session: session to operate on
+ * @key: the hint key
+ * @value: the new string value
+ *
+ * Set a default string hint for all notifications sent through
+ * the session. The value will be copied into the #NotifySession.
+ */
+void notify_session_set_hint_string(NotifySession session,
+		const char* key, const char* value);
+
+/**
+ * notify_session_set_hint_int
+ * @session: session to operate on
+ * @key: the hint key
+ * @value: the new value
+ *
+ * Set a default 32-bit signed integer hint for all notifications sent
+ * through the session.
+ */
+void notify_session_set_hint_int(NotifySession session,
+		const char* key, int value);
+
+/**
+ * notify_session_set_hint_byte
+ * @session: session to operate on
+ * @key: the hint key
+ * @value: the new value
+ *
+ * Set a default byte hint for all notifications sent through the session.
+ */
+void notify_session_set_hint_byte(NotifySession session,
+		const char* key, unsigned char value);
+
+/**
+ * notify_session_set_hint_boolean
+ * @session: session to operate on
+ * @key: the hint key
+ * @value: zero (false) or non-zero (true)
+ *
+ * Set a default boolean hint for all notifications sent through
+ * the session.
+ */
+void notify_session_set_hint_boolean(NotifySession session,
+		const char* key, int value);
+
+/**
+ * notify_session_set_hint_byte_array
+ * @session: session to operate on
+ * @key: the hint key
+ * @data: the array contents
+ * @length: the array length, in bytes
+ *
+ * Set a default byte array hint for all notifications sent through
+ * the session. The data will be copied into the #NotifySession.
+ */
+void notify_session_set_hint_byte_array(NotifySession session,
+		const char* key, const void* data, size_t length);
+
+/**
+ * notify_session_remove_hint
+ * @session: session to operate on
+ * @key: the hint key
+ *
+ * Remove the default hint with the given key, if set.
+ */
+void notify_session_remove_hint(NotifySession session, const char* key);
+
+#endif /*_TINYNOTIFY_HINTS_H*/
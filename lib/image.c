@@ -0,0 +1,244 @@
+/* libtinynotify -- notification images
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+#include "hints.h"
+#include "image.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "image_.h"
+#include "wire_.h"
+#include "memory_.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#define IMAGE_DATA_HINT "image-data"
+#define IMAGE_PATH_HINT "image-path"
+
+const size_t NOTIFY_SESSION_DEFAULT_IMAGE_CACHE_SIZE = 8;
+
+void notification_set_image_data(Notification n, int width, int height,
+		int rowstride, int has_alpha, int bits_per_sample, int channels,
+		const void* data) {
+	struct _notification_image *img;
+
+	if (!data) {
+		free(n->image);
+		n->image = NULL;
+		return;
+	}
+
+	assert(width > 0 && height > 0);
+	assert(bits_per_sample > 0 && channels > 0);
+	assert(rowstride >= width * ((channels * bits_per_sample + 7) / 8));
+
+	if (!n->image)
+		_mem_assert(n->image = malloc(sizeof(*n->image)));
+	img = n->image;
+
+	img->width = width;
+	img->height = height;
+	img->rowstride = rowstride;
+	img->has_alpha = !!has_alpha;
+	img->bits_per_sample = bits_per_sample;
+	img->channels = channels;
+	img->data = data;
+	/* the last row doesn't have to be padded to rowstride */
+	img->len = (size_t) (height - 1) * rowstride
+		+ width * ((channels * bits_per_sample + 7) / 8);
+	img->hashed = 0;
+}
+
+void notification_set_image_path(Notification n, const char* path) {
+	if (path)
+		notification_set_hint_string(n, IMAGE_PATH_HINT, path);
+	else
+		notification_remove_hint(n, IMAGE_PATH_HINT);
+}
+
+/* the memory charged against the session budget */
+#define IMAGE_ENTRY_SIZE(e) (sizeof(*(e)) + (e)->hint.len)
+
+static void _image_cache_drop(NotifySession s,
+		struct _notify_image_cache_entry* e) {
+	_notify_mem_release(s, IMAGE_ENTRY_SIZE(e));
+	free(e->hint.blob);
+	free(e);
+	s->image_cache.count--;
+}
+
+void notify_session_set_image_cache_size(NotifySession s, size_t entries) {
+	struct _notify_image_cache_entry **e, *next;
+	size_t i;
+
+	s->image_cache.max = entries;
+
+	/* drop the entries past the new size */
+	for (e = &s->image_cache.first, i = 0; *e && i < entries;
+			e = &(*e)->next, i++);
+	for (; *e; *e = next) {
+		next = (*e)->next;
+		_image_cache_drop(s, *e);
+	}
+}
+
+void _notify_image_cache_init(struct _notify_image_cache* cache) {
+	cache->first = NULL;
+	cache->count = 0;
+	cache->max = NOTIFY_SESSION_DEFAULT_IMAGE_CACHE_SIZE;
+}
+
+void _notify_image_cache_clear(struct _notify_image_cache* cache) {
+	struct _notify_image_cache_entry *e, *next;
+
+	for (e = cache->first; e; e = next) {
+		next = e->next;
+		free(e->hint.blob);
+		free(e);
+	}
+	cache->first = NULL;
+	cache->count = 0;
+}
+
+static uint64_t _image_rotl(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+/* a simple word-at-a-time hash; it is only used to skip the entries
+ * which can't match, the image itself is compared on a hit (unless
+ * it comes from the same buffer) */
+static uint64_t _image_hash(const struct _notification_image* img) {
+	const unsigned char *p = img->data;
+	const unsigned char *end = p + img->len;
+	uint64_t h = 0x9e3779b97f4a7c15ULL ^ img->len;
+	uint64_t k;
+
+	for (; end - p >= 8; p += 8) {
+		memcpy(&k, p, 8);
+		h ^= _image_rotl(k * 0x87c37b91114253d5ULL, 31) * 0x4cf5ad432745937fULL;
+		h = _image_rotl(h, 27) * 5 + 0x52dce729;
+	}
+	k = 0;
+	memcpy(&k, p, end - p);
+	h ^= k * 0x87c37b91114253d5ULL;
+
+	/* final avalanche */
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* returns non-zero if out of memory */
+static int _image_encode(const struct _notification_image* img,
+		struct _notification_hint* h) {
+	struct _notify_wire_buf w;
+
+	memset(&w, 0, sizeof(w));
+	h->type = '(';
+	h->value_offset = _notify_wire_encode_image_hint(&w, IMAGE_DATA_HINT,
+			img);
+	if (w.failed) {
+		free(w.data);
+		return -1;
+	}
+	h->value_len = w.len - h->value_offset;
+	h->blob = w.data;
+	h->len = w.len;
+	h->next = NULL;
+	return 0;
+}
+
+
+static int _image_matches(struct _notify_image_cache_entry* e,
+		const struct _notification_image* img) {
+	const unsigned char *value = e->hint.blob + e->hint.value_offset;
+	uint32_t len;
+
+	if (e->hash != img->hash)
+		return 0;
+	/* the six integers are laid out the same as in the struct */
+	if (memcmp(value, &img->width, 6 * sizeof(int32_t)))
+		return 0;
+	memcpy(&len, value + 6 * sizeof(int32_t), sizeof(len));
+	if (len != img->len)
+		return 0;
+	/* the caller keeps the data unchanged while it is set, so the same
+	 * buffer with the same hash is the same image */
+	if (img->data == e->data)
+		return 1;
+	/* otherwise, the hash is only a shortcut; a collision must not send
+	 * the wrong image */
+	if (memcmp(value + 7 * sizeof(int32_t), img->data, img->len))
+		return 0;
+	e->data = img->data;
+	return 1;
+}
+
+const struct _notification_hint* _notify_session_get_image_hint(
+		NotifySession s, struct _notification_image* img,
+		struct _notification_hint* uncached) {
+	struct _notify_image_cache* cache = &s->image_cache;
+	struct _notify_image_cache_entry **ep, *e;
+
+	if (!cache->max)
+		return _image_encode(img, uncached) ? NULL : uncached;
+
+	if (!img->hashed) {
+		img->hash = _image_hash(img);
+		img->hashed = 1;
+	}
+
+	for (ep = &cache->first; *ep; ep = &(*ep)->next) {
+		if (_image_matches(*ep, img))
+			break;
+	}
+
+	if (*ep) {
+		e = *ep;
+		*ep = e->next;
+		_stats_inc(s, image_cache_hits);
+	} else {
+		/* drop the least recently used entry if full */
+		if (cache->count == cache->max) {
+			for (ep = &cache->first; (*ep)->next; ep = &(*ep)->next);
+			_image_cache_drop(s, *ep);
+			*ep = NULL;
+		}
+
+		_stats_inc(s, image_cache_misses);
+		if (!(e = malloc(sizeof(*e))))
+			return NULL;
+		if (_image_encode(img, &e->hint)) {
+			free(e);
+			return NULL;
+		}
+		/* over the budget, send it without caching */
+		if (_notify_mem_charge(s, IMAGE_ENTRY_SIZE(e))) {
+			*uncached = e->hint;
+			free(e);
+			return uncached;
+		}
+		e->hash = img->hash;
+		e->data = img->data;
+		cache->count++;
+	}
+
+	e->next = cache->first;
+	cache->first = e;
+	return &e->hint;
+}
@@ -0,0 +1,81 @@
+/* libtinynotify -- notification images
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_IMAGE_H
+#define _TINYNOTIFY_IMAGE_H
+
+#include <stddef.h>
+
+/**
+ * SECTION: NotifyImage
+ * @short_description: API to attach images to notifications
+ * @include: tinynotify.h
+ *
+ * A notification can carry an image, either as raw pixel data
+ * (the 'image-data' hint) or as a path to an image file (the 'image-path'
+ * hint). If both are set, the server will prefer the pixel data.
+ *
+ * The pixel data is not copied into the #Notification; it is referenced
+ * until the notification is freed or another image is set. This way,
+ * the data can reside in a caller-owned or mmap()-ed buffer.
+ *
+ * Every #NotifySession keeps a small cache of the images it sent,
+ * keyed by a hash of their contents. When the same image is sent again,
+ * even as part of a different notification, it doesn't need to be encoded
+ * for the wire again.
+ */
+
+/**
+ * notification_set_image_data
+ * @notification: notification to operate on
+ * @width: the image width, in pixels
+ * @height: the image height, in pixels
+ * @rowstride: the distance between the starts of two rows, in bytes
+ * @has_alpha: whether the image has an alpha channel
+ * @bits_per_sample: the number of bits in a single sample (8)
+ * @channels: the number of channels (3 for RGB, 4 for RGBA)
+ * @data: the pixel data, or %NULL to remove the image
+ *
+ * Set the image for a notification, in the format specified for
+ * the 'image-data' hint (RGB or RGBA, samples ordered as such).
+ *
+ * The @data is not copied; it has to stay valid and unchanged until
+ * the notification is freed, or the image is replaced or removed.
+ */
+void notification_set_image_data(Notification notification,
+		int width, int height, int rowstride, int has_alpha,
+		int bits_per_sample, int channels, const void* data);
+
+/**
+ * notification_set_image_path
+ * @notification: notification to operate on
+ * @path: the image path or URI, or %NULL to remove it
+ *
+ * Set the path (or URI) of the image for a notification. The path will be
+ * copied into the #Notification.
+ */
+void notification_set_image_path(Notification notification,
+		const char* path);
+
+/**
+ * NOTIFY_SESSION_DEFAULT_IMAGE_CACHE_SIZE
+ *
+ * The default number of images kept in the session image cache.
+ */
+extern const size_t NOTIFY_SESSION_DEFAULT_IMAGE_CACHE_SIZE;
+
+/**
+ * notify_session_set_image_cache_size
+ * @session: session to operate on
+ * @entries: the maximal number of cached images, 0 to disable the cache
+ *
+ * Set the size of the session image cache. When the cache is full,
+ * the least recently sent image is dropped.
+ */
+void notify_session_set_image_cache_size(NotifySession session,
+		size_t entries);
+
+#endif /*_TINYNOTIFY_IMAGE_H*/
@@ -0,0 +1,67 @@
+/* libtinynotify -- notification images
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_IMAGE__H
+#define _TINYNOTIFY_IMAGE__H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "session.h"
+#include "notification.h"
+
+#include "notification_.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+/* the 'image-data' value, (iiibiiay); data is owned by the caller */
+struct _notification_image {
+	int32_t width;
+	int32_t height;
+	int32_t rowstride;
+	uint32_t has_alpha;
+	int32_t bits_per_sample;
+	int32_t channels;
+
+	const void* data;
+	size_t len;
+
+	/* the content hash, calculated on first send */
+	uint64_t hash;
+	int hashed;
+};
+
+struct _notify_image_cache_entry {
+	uint64_t hash;
+	/* the pixel data of the last image matched; not dereferenced */
+	const void* data;
+	/* the encoded 'image-data' dict entry */
+	struct _notification_hint hint;
+
+	struct _notify_image_cache_entry* next;
+};
+
+/* most recently used first */
+struct _notify_image_cache {
+	struct _notify_image_cache_entry* first;
+	size_t count;
+	size_t max;
+};
+
+void _notify_image_cache_init(struct _notify_image_cache* cache);
+void _notify_image_cache_clear(struct _notify_image_cache* cache);
+
+/* get the encoded hint for img, from the session cache if possible;
+ * if the cache is disabled (or the entry doesn't fit in the session memory
+ * budget), the hint is encoded into uncached (whose blob is initially NULL)
+ * and has to be freed by the caller. Returns NULL if out of memory. */
+const struct _notification_hint* _notify_session_get_image_hint(
+		NotifySession s, struct _notification_image* img,
+		struct _notification_hint* uncached);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_IMAGE__H*/
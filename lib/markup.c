@@ -0,0 +1,143 @@
+/* libtinynotify -- body markup escaping
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+#include "markup.h"
+
+#include "common_.h"
+#include "notification_.h"
+#include "format_.h"
+#include "markup_.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#	include <immintrin.h>
+#	define MARKUP_HAVE_AVX2 1
+#endif
+
+static size_t _markup_scan_scalar(const char* s, size_t len) {
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (s[i] == '<' || s[i] == '>' || s[i] == '&')
+			break;
+	}
+
+	return i;
+}
+
+#ifdef __SSE2__
+static size_t _markup_scan_sse2(const char* s, size_t len) {
+	const __m128i lt = _mm_set1_epi8('<');
+	const __m128i gt = _mm_set1_epi8('>');
+	const __m128i amp = _mm_set1_epi8('&');
+	size_t i;
+
+	for (i = 0; len - i >= 16; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (s + i));
+		int mask = _mm_movemask_epi8(_mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, gt)),
+					_mm_cmpeq_epi8(v, amp)));
+
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	return i + _markup_scan_scalar(s + i, len - i);
+}
+#endif
+
+#ifdef MARKUP_HAVE_AVX2
+__attribute__((target("avx2")))
+static size_t _markup_scan_avx2(const char* s, size_t len) {
+	const __m256i lt = _mm256_set1_epi8('<');
+	const __m256i gt = _mm256_set1_epi8('>');
+	const __m256i amp = _mm256_set1_epi8('&');
+	size_t i;
+
+	for (i = 0; len - i >= 32; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (s + i));
+		unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(v, lt),
+						_mm256_cmpeq_epi8(v, gt)),
+					_mm256_cmpeq_epi8(v, amp)));
+
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+#	ifdef __SSE2__
+	return i + _markup_scan_sse2(s + i, len - i);
+#	else
+	return i + _markup_scan_scalar(s + i, len - i);
+#	endif
+}
+#endif
+
+size_t _notify_markup_scan(const char* s, size_t len) {
+	/* the CPU features are detected by libgcc at startup, so this is
+	 * only a load */
+#ifdef MARKUP_HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		return _markup_scan_avx2(s, len);
+#endif
+#ifdef __SSE2__
+	return _markup_scan_sse2(s, len);
+#else
+	return _markup_scan_scalar(s, len);
+#endif
+}
+
+void _notify_markup_escape_append(struct _notify_strbuf* b, const char* s,
+		size_t len) {
+	size_t i = 0;
+
+	/* assume a few characters need escaping, to avoid regrowing */
+	if (_notify_strbuf_reserve(b, len + len / 16))
+		return;
+
+	for (;;) {
+		size_t run = _notify_markup_scan(s + i, len - i);
+
+		_notify_strbuf_append(b, s + i, run);
+		i += run;
+		if (i == len)
+			break;
+
+		switch (s[i++]) {
+			case '<':
+				_notify_strbuf_append(b, "&lt;", 4);
+				break;
+			case '>':
+				_notify_strbuf_append(b, "&gt;", 4);
+				break;
+			case '&':
+				_notify_strbuf_append(b, "&amp;", 5);
+				break;
+		}
+	}
+}
+
+char* notify_markup_escape(const char* text) {
+	struct _notify_strbuf b;
+	size_t len = strlen(text);
+
+	_notify_strbuf_init(&b, len + 1);
+	_notify_markup_escape_append(&b, text, len);
+	_mem_assert(!b.failed);
+	return b.data;
+}
+
+void notification_set_escape_markup(Notification n, int enabled) {
+	n->escape_markup = !!enabled;
+}
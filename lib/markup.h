@@ -0,0 +1,56 @@
+/* libtinynotify -- body markup escaping
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_MARKUP_H
+#define _TINYNOTIFY_MARKUP_H
+
+/**
+ * SECTION: NotifyMarkup
+ * @short_description: API to escape markup in notification bodies
+ * @include: tinynotify.h
+ *
+ * Notification servers supporting the 'body-markup' capability interpret
+ * a subset of HTML markup in notification bodies. Any untrusted text
+ * inserted into the body therefore has to have the '&lt;', '&gt;'
+ * and '&amp;' characters escaped.
+ *
+ * When formatting is enabled, the '%M' conversion can be used in the summary
+ * and body format strings. It takes a string argument (like '%s'), and
+ * outputs it with the markup escaped. Alternatively,
+ * notification_set_escape_markup() makes all the string arguments
+ * in the body escaped.
+ *
+ * Note that these extensions don't work with positional arguments
+ * (e.g. '%1$s'), nor with the conversions not known to the library (e.g.
+ * '%S', or the ones registered with register_printf_function()); if
+ * the format strings use them along with escaping, sending fails with
+ * %NOTIFY_ERROR_INVALID_FORMAT.
+ */
+
+/**
+ * notification_set_escape_markup
+ * @notification: notification to operate on
+ * @enabled: zero (false) to disable, non-zero (true) to enable
+ *
+ * Enable or disable escaping markup in the notification body.
+ *
+ * If formatting is enabled, the string arguments ('%s' and '%c') inserted
+ * into the body are escaped, while the body format string itself is
+ * passed as-is. Otherwise, the whole body is escaped.
+ */
+void notification_set_escape_markup(Notification notification, int enabled);
+
+/**
+ * notify_markup_escape
+ * @text: the text to escape
+ *
+ * Escape the markup in @text.
+ *
+ * Returns: a newly-allocated string, to be freed using free()
+ */
+char* notify_markup_escape(const char* text);
+
+#endif /*_TINYNOTIFY_MARKUP_H*/
@@ -0,0 +1,26 @@
+/* libtinynotify -- body markup escaping
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_MARKUP__H
+#define _TINYNOTIFY_MARKUP__H
+
+#include <stddef.h>
+
+#include "format_.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+/* get the offset of the first character needing escaping in s,
+ * or len if there is none */
+size_t _notify_markup_scan(const char* s, size_t len);
+
+/* append s to b, escaping the markup, in a single pass */
+void _notify_markup_escape_append(struct _notify_strbuf* b, const char* s,
+		size_t len);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_MARKUP__H*/
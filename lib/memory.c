@@ -0,0 +1,56 @@
+/* libtinynotify -- memory management
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "memory.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "memory_.h"
+
+#include <assert.h>
+
+const size_t NOTIFY_SESSION_NO_MEMORY_BUDGET = 0;
+
+void notify_session_set_recoverable_oom(NotifySession s, int enabled) {
+	s->mem.recoverable = !!enabled;
+}
+
+void notify_session_set_memory_budget(NotifySession s, size_t bytes) {
+	s->mem.budget = bytes;
+}
+
+size_t notify_session_get_memory_usage(NotifySession s) {
+	return s->mem.used;
+}
+
+NotifyError _notify_session_out_of_memory(NotifySession s) {
+	_mem_check(s->mem.recoverable);
+	return notify_session_set_error(s, NOTIFY_ERROR_NO_MEMORY);
+}
+
+int _notify_mem_charge(NotifySession s, size_t len) {
+	if (s->mem.budget && (s->mem.used > s->mem.budget
+				|| len > s->mem.budget - s->mem.used))
+		return -1;
+
+	s->mem.used += len;
+	return 0;
+}
+
+void _notify_mem_release(NotifySession s, size_t len) {
+	assert(len <= s->mem.used);
+	s->mem.used -= len;
+}
+
+NotifyError _notify_session_charge(NotifySession s, size_t len) {
+	if (_notify_mem_charge(s, len))
+		return notify_session_set_error(s, NOTIFY_ERROR_MEMORY_BUDGET,
+				(unsigned long) s->mem.used, (unsigned long) s->mem.budget);
+	return NOTIFY_ERROR_NO_ERROR;
+}
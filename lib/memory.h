@@ -0,0 +1,78 @@
+/* libtinynotify -- memory management
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_MEMORY_H
+#define _TINYNOTIFY_MEMORY_H
+
+#include <stddef.h>
+
+/**
+ * SECTION: NotifyMemory
+ * @short_description: API to control memory use of a session
+ * @include: tinynotify.h
+ *
+ * By default, libtinynotify aborts the program when a memory allocation
+ * fails. A #NotifySession can be switched into a mode in which allocation
+ * failures while connecting, sending or closing notifications and
+ * dispatching events are recoverable instead. Functions returning
+ * a #NotifyError return %NOTIFY_ERROR_NO_MEMORY then, and the server
+ * signals which couldn't be queued are dropped (and counted
+ * in #NotifyStats).
+ *
+ * Functions which can't return an error, e.g. the property setters and
+ * notification_new(), still abort on allocation failure.
+ *
+ * Additionally, a session can be given a memory budget. It covers
+ * the memory held on behalf of the session: the notifications tracked
+ * for events, the signals queued for dispatching, the session image cache,
+ * and the buffers used to format and build a message (for the duration
+ * of the call). Once the budget would be exceeded, sending a notification
+ * fails with %NOTIFY_ERROR_MEMORY_BUDGET, images are no longer cached
+ * and incoming signals are dropped. Memory held by the notifications
+ * themselves, and messages queued by libdbus is not covered.
+ */
+
+/**
+ * notify_session_set_recoverable_oom
+ * @session: session to operate on
+ * @enabled: zero (false) to disable, non-zero (true) to enable
+ *
+ * Enable or disable recoverable allocation failures for @session.
+ * By default, they are disabled and allocation failures abort the program.
+ */
+void notify_session_set_recoverable_oom(NotifySession session, int enabled);
+
+/**
+ * NOTIFY_SESSION_NO_MEMORY_BUDGET
+ *
+ * A constant specifying that the session memory use is not limited.
+ */
+extern const size_t NOTIFY_SESSION_NO_MEMORY_BUDGET;
+
+/**
+ * notify_session_set_memory_budget
+ * @session: session to operate on
+ * @bytes: the memory budget, in bytes,
+ *	or %NOTIFY_SESSION_NO_MEMORY_BUDGET to disable it
+ *
+ * Set the memory budget for @session. Lowering the budget below the current
+ * use doesn't free anything; the operations needing more memory will be
+ * rejected until enough is released.
+ */
+void notify_session_set_memory_budget(NotifySession session, size_t bytes);
+
+/**
+ * notify_session_get_memory_usage
+ * @session: session to operate on
+ *
+ * Get the amount of memory currently charged against the budget
+ * of @session. It is tracked even if no budget is set.
+ *
+ * Returns: the memory use, in bytes
+ */
+size_t notify_session_get_memory_usage(NotifySession session);
+
+#endif /*_TINYNOTIFY_MEMORY_H*/
@@ -0,0 +1,39 @@
+/* libtinynotify -- memory management
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_MEMORY__H
+#define _TINYNOTIFY_MEMORY__H
+
+#include <stddef.h>
+
+#include "error.h"
+#include "session.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notify_mem_state {
+	int recoverable;
+	/* zero means no limit */
+	size_t budget;
+	size_t used;
+};
+
+/* handle an allocation failure on a path which can return an error: abort
+ * unless recoverable failures are enabled, set NOTIFY_ERROR_NO_MEMORY
+ * otherwise */
+NotifyError _notify_session_out_of_memory(NotifySession s);
+
+/* charge len bytes against the session budget; returns non-zero (without
+ * setting the session error) if it would be exceeded */
+int _notify_mem_charge(NotifySession s, size_t len);
+void _notify_mem_release(NotifySession s, size_t len);
+
+/* _notify_mem_charge(), setting NOTIFY_ERROR_MEMORY_BUDGET on failure */
+NotifyError _notify_session_charge(NotifySession s, size_t len);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_MEMORY__H*/
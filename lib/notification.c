@@ -9,22 +9,36 @@
 #include "session.h"
 #include "notification.h"
 #include "event.h"
+#include "timing.h"
+#include "stats.h"
+#include "hints.h"
+#include "spool.h"
 
 #include "common_.h"
 #include "session_.h"
 #include "notification_.h"
+#include "image_.h"
 #include "event_.h"
+#include "timing_.h"
+#include "stats_.h"
+#include "memory_.h"
+#include "queue_.h"
+#include "expiry_.h"
+#include "ratelimit_.h"
+#include "aggregate_.h"
+#include "dedup_.h"
+#include "spool_.h"
+#include "transport_.h"
+#include "probes_.h"
+#include "utf8_.h"
+#include "format_.h"
+#include "markup_.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <assert.h>
 
-#include <dbus/dbus.h>
-
-#ifndef DBUS_TIMEOUT_INFINITE /* dbus < 1.4.12 */
-#	define DBUS_TIMEOUT_INFINITE 0x7fffffff
-#endif
-
 const char* const NOTIFICATION_NO_BODY = NULL;
 
 const char* const NOTIFICATION_DEFAULT_APP_ICON = NULL;
@@ -32,11 +46,12 @@ const char* const NOTIFICATION_NO_APP_ICON = "";
 
 const int NOTIFICATION_DEFAULT_EXPIRE_TIMEOUT = -1;
 const int NOTIFICATION_NO_EXPIRE_TIMEOUT = 0;
+const int NOTIFICATION_NO_TTL = -1;
 
 const short int NOTIFICATION_NO_URGENCY = -1;
 const char* const NOTIFICATION_NO_CATEGORY = NULL;
 
-static const dbus_uint32_t NOTIFICATION_NO_NOTIFICATION_ID = 0;
+static const uint32_t NOTIFICATION_NO_NOTIFICATION_ID = 0;
 
 Notification notification_new(const char* summary, const char* body) {
 	Notification n = notification_new_unformatted(summary, body);
@@ -51,27 +66,52 @@ Notification notification_new_unformatted(const char* summary, const char* body)
 
 	_mem_assert(n = malloc(sizeof(*n)));
 	/* can't use notification_set_summary() here because it has to free sth */
-	_mem_assert(n->summary = strdup(summary));
+	n->summary = _notify_utf8_strdup(summary);
+	n->summary_format_safe = _notify_utf8_format_is_safe(n->summary);
 	n->body = NULL;
-	n->category = NULL;
+	n->body_type = _NOTIFICATION_BODY_STRING;
+	n->escape_markup = 0;
+	n->hints = NULL;
+	n->image = NULL;
 	n->app_icon = NULL;
+	n->aggregation_key = NULL;
+	n->registry_key = NULL;
 	n->message_id = NOTIFICATION_NO_NOTIFICATION_ID;
+	n->queue_refs = 0;
+	n->freed = 0;
+	n->close_pending = NULL;
 
 	notification_set_body(n, body);
 	notification_set_formatting(n, 0);
 	notification_set_expire_timeout(n, NOTIFICATION_DEFAULT_EXPIRE_TIMEOUT);
+	notification_set_ttl(n, NOTIFICATION_NO_TTL);
+	notification_set_close_on_ttl(n, 0);
 	notification_set_urgency(n, NOTIFICATION_NO_URGENCY);
 	_notification_event_init(n);
 	return n;
 }
 
 void notification_free(Notification n) {
+	/* the registry would be left with a dangling entry */
+	assert(!n->registry_key);
+	_notify_session_cancel_closed(n);
+
+	/* the queue still needs it to send the pending messages */
+	if (n->queue_refs)
+		n->freed = 1;
+	else
+		_notification_destroy(n);
+}
+
+void _notification_destroy(Notification n) {
 	_notification_event_free(n);
+	_notification_hints_free(&n->hints);
+	free(n->image);
 	free(n->summary);
-	if (n->body)
-		free(n->body);
+	_notification_body_free(n);
 	if (n->app_icon)
 		free(n->app_icon);
+	free(n->aggregation_key);
 	free(n);
 }
 
@@ -83,157 +123,338 @@ void notification_set_expire_timeout(Notification n, int expire_timeout) {
 	n->expire_timeout = expire_timeout;
 }
 
+void notification_set_ttl(Notification n, int ttl) {
+	n->ttl = ttl;
+}
+
+void notification_set_close_on_ttl(Notification n, int enabled) {
+	n->close_on_ttl = !!enabled;
+}
+
 void notification_set_urgency(Notification n, short int urgency) {
-	n->urgency = urgency;
+	if (urgency != NOTIFICATION_NO_URGENCY)
+		notification_set_hint_byte(n, "urgency", urgency);
+	else
+		notification_remove_hint(n, "urgency");
 }
 
 void notification_set_category(Notification n, const char* category) {
-	_property_assign_str(&n->category, category);
+	if (category)
+		notification_set_hint_string(n, "category", category);
+	else
+		notification_remove_hint(n, "category");
 }
 
-static void _notification_append_hint(DBusMessageIter* subiter,
-		const char* key, const char* hint_type, const void* hint_val) {
-	DBusMessageIter dictiter, variter;
+NotifyError _notification_format_text(Notification n, NotifySession s,
+		va_list ap, struct _notification_text* t) {
+	char *fixed = NULL;
 
-	_mem_assert(dbus_message_iter_open_container(subiter,
-				DBUS_TYPE_DICT_ENTRY,
-				NULL,
-				&dictiter));
+	t->summary = n->summary;
+	t->body = n->body ? n->body : "";
+	t->body_len = n->body_len;
+	t->summary_buf = t->body_buf = NULL;
+	t->hash = 0;
+
+	if (n->formatting) {
+		/* raw bodies are never formatted */
+		int ret = _notify_format(&t->summary_buf, t->summary, &t->body_buf,
+				n->body_type == _NOTIFICATION_BODY_STRING ? t->body : NULL,
+				n->escape_markup, ap);
+
+		if (ret) {
+			t->summary_buf = t->body_buf = NULL;
+			if (ret == _NOTIFY_FORMAT_INVALID)
+				return notify_session_set_error(s,
+						NOTIFY_ERROR_INVALID_FORMAT);
+			goto oom;
+		}
+
+		t->summary = t->summary_buf;
+		if (t->body_buf)
+			t->body = t->body_buf;
+	}
+	if (n->body_type == _NOTIFICATION_BODY_STRING)
+		t->body_len = strlen(t->body);
+	if (n->escape_markup && (!n->formatting
+				|| n->body_type != _NOTIFICATION_BODY_STRING)) {
+		struct _notify_strbuf b;
+
+		_notify_strbuf_init(&b, t->body_len + 1);
+		_notify_markup_escape_append(&b, t->body, t->body_len);
+		if (b.failed) {
+			free(b.data);
+			goto oom;
+		}
+		free(t->body_buf);
+		t->body = t->body_buf = b.data;
+		t->body_len = b.len;
+	}
+	/* the strings are validated when set, but the format arguments
+	 * could have introduced invalid UTF-8 */
+	if (n->formatting && !n->summary_format_safe) {
+		size_t summary_len = strlen(t->summary);
+
+		if (!(t->summary = _notify_utf8_check(t->summary, &summary_len,
+						&fixed)))
+			goto oom;
+		if (fixed) {
+			free(t->summary_buf);
+			t->summary_buf = fixed;
+			fixed = NULL;
+		}
+	}
+	if (n->formatting && !n->body_format_safe
+			&& n->body_type == _NOTIFICATION_BODY_STRING) {
+		if (!(t->body = _notify_utf8_check(t->body, &t->body_len, &fixed)))
+			goto oom;
+		if (fixed) {
+			free(t->body_buf);
+			t->body_buf = fixed;
+		}
+	}
 
-	_mem_assert(dbus_message_iter_append_basic(&dictiter,
-				DBUS_TYPE_STRING, &key));
+	return NOTIFY_ERROR_NO_ERROR;
 
-	_mem_assert(dbus_message_iter_open_container(&dictiter,
-				DBUS_TYPE_VARIANT,
-				hint_type,
-				&variter));
+oom:
+	_notification_text_free(t);
+	return _notify_session_out_of_memory(s);
+}
 
-	_mem_assert(dbus_message_iter_append_basic(&variter,
-				*hint_type, hint_val));
+int _notification_text_own(struct _notification_text* t) {
+	if (!t->summary_buf) {
+		if (!(t->summary_buf = strdup(t->summary)))
+			return -1;
+		t->summary = t->summary_buf;
+	}
+	if (!t->body_buf) {
+		if (!(t->body_buf = malloc(t->body_len + 1)))
+			return -1;
+		memcpy(t->body_buf, t->body, t->body_len);
+		t->body_buf[t->body_len] = 0;
+		t->body = t->body_buf;
+	}
 
-	_mem_assert(dbus_message_iter_close_container(&dictiter, &variter));
-	_mem_assert(dbus_message_iter_close_container(subiter, &dictiter));
+	return 0;
 }
 
-static NotifyError notification_update_va(Notification n, NotifySession s, va_list ap) {
-	NotifyError ret;
-	char *err_msg;
-	char *f_summary;
-	struct _notification_action_list *al;
+size_t _notification_text_size(const struct _notification_text* t) {
+	return (t->summary_buf ? strlen(t->summary_buf) + 1 : 0)
+		+ (t->body_buf ? t->body_len + 1 : 0);
+}
 
-	DBusMessage *msg, *reply;
-	DBusMessageIter iter, subiter;
-	DBusError err;
+void _notification_text_free(struct _notification_text* t) {
+	free(t->summary_buf);
+	free(t->body_buf);
+	t->summary_buf = t->body_buf = NULL;
+}
 
-	const char *app_name = s->app_name ? s->app_name : "";
-	dbus_uint32_t replaces_id = n->message_id;
-	const char *app_icon = n->app_icon ? n->app_icon :
+int _notification_build_call(Notification n, NotifySession s,
+		const struct _notification_text* t, struct _notify_call* c,
+		struct _notification_hint* uncached) {
+	c->method = _NOTIFY_CALL_NOTIFY;
+	c->id = n->message_id;
+	c->app_name = s->app_name ? s->app_name : "";
+	c->app_icon = n->app_icon ? n->app_icon :
 			s->app_icon ? s->app_icon : "";
-	const char *summary = n->summary;
-	const char *body = n->body ? n->body : "";
-	dbus_int32_t expire_timeout = n->expire_timeout;
+	c->summary = t->summary;
+	c->body = t->body;
+	c->body_len = t->body_len;
+	c->actions = n->actions;
+	c->hints = n->hints;
+	c->default_hints = s->default_hints;
+	c->image = NULL;
+	c->expire_timeout = n->expire_timeout;
+
+	if (n->image && !(c->image = _notify_session_get_image_hint(s, n->image,
+					uncached)))
+		return -1;
+	return 0;
+}
 
-	if (notify_session_connect(s))
-		return notify_session_get_error(s);
+NotifyError _notification_send_text(Notification n, NotifySession s,
+		const struct _notification_text* t) {
+	NotifyError ret;
+	struct _notify_call c;
+	struct _notification_hint uncached_image;
+	struct _notify_expiry *expiry = NULL;
+	struct timespec deadline;
+	size_t scratch = 0;
+	int tracked;
+	uint32_t new_id;
+
+	uncached_image.blob = NULL;
+	if (_notification_build_call(n, s, t, &c, &uncached_image)) {
+		ret = _notify_session_out_of_memory(s);
+		goto done;
+	}
 
-	if (n->formatting) {
-		_mem_assert(_dual_vasprintf(&f_summary, summary,
-					&body, body, ap) != -1);
+	/* the buffers above, and the ones to build the message */
+	scratch = _notification_text_size(t) + _notify_call_size(&c);
+	if (uncached_image.blob)
+		scratch += uncached_image.len;
+	if ((ret = _notify_session_charge(s, scratch))) {
+		scratch = 0;
+		goto done;
+	}
+	if (n->close_on_ttl && _notification_get_deadline(n, &deadline)
+			&& !(expiry = _notify_expiry_new(s, &deadline))) {
+		ret = notify_session_get_error(s);
+		goto done;
+	}
+
+	/* track it before sending, to fail before the notification is shown */
+	if ((tracked = _notify_session_add_notification(s, n)) == -1) {
+		ret = notify_session_get_error(s);
+		goto done;
+	}
+
+	ret = _notify_transport_call(s, &c, _NOTIFY_TRANSPORT_NO_TIMEOUT, &new_id);
+	if (!ret) {
+		_probe(reply__received, s, new_id);
+		n->message_id = new_id;
+		_notify_state_sync(s, n);
+		_stats_inc(s, sent);
+		if (t->hash)
+			_notify_dedup_record(s, t->hash, new_id);
+
+		if (expiry) {
+			_notify_expiry_schedule(s, expiry, new_id);
+			expiry = NULL;
+		} else
+			_notify_expiry_cancel(s, new_id);
+	} else if (tracked)
+		_notify_session_remove_notification(s, n);
+
+done:
+	if (expiry)
+		_notify_expiry_discard(s, expiry);
+	_notify_mem_release(s, scratch);
+	free(uncached_image.blob);
+	return ret;
+}
+
+static NotifyError notification_update_va(Notification n, NotifySession s, va_list ap) {
+	NotifyError ret;
+	struct _notification_text t;
+	struct _notify_aggregate_group *g;
+	/* for %m, as the caller has seen it */
+	int saved_errno = errno;
+	int formatted = 0, connect_failed = 0;
+	/* of a new entry in the dedup table, to be undone on failure */
+	uint64_t dedup_hash = 0;
+
+	_timing_start(s);
+	/* it is shown again, the pending close event is stale */
+	_notify_session_cancel_closed(n);
+
+	/* only the new notifications are aggregated */
+	if (n->message_id == NOTIFICATION_NO_NOTIFICATION_ID
+			&& (g = _notify_aggregate_match(s, n))) {
+		ret = _notify_aggregate_add(s, g, n, ap);
+		_timing_finish(s);
+		return ret;
+	}
+
+	/* the repeats are dropped before they take a token, or a connection;
+	 * the registered notifications replace their own ID instead */
+	if (s->dedup.slots && n->message_id == NOTIFICATION_NO_NOTIFICATION_ID
+			&& !n->registry_key) {
+		if ((ret = _notification_format_text(n, s, ap, &t))) {
+			_stats_inc(s, failed);
+			goto not_sent;
+		}
+		formatted = 1;
+		_timing_mark(s, NOTIFY_TIMING_FORMAT);
+
+		switch (_notify_dedup_check(s, n, &t)) {
+			case _NOTIFY_DEDUP_SUPPRESS:
+				ret = notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+				goto not_sent;
+			case _NOTIFY_DEDUP_NEW:
+				dedup_hash = t.hash;
+				break;
+			case -1:
+				_stats_inc(s, failed);
+				ret = notify_session_get_error(s);
+				goto not_sent;
+		}
+	}
 
-		summary = f_summary;
+	switch (_notify_ratelimit_check(s, n)) {
+		case 1:
+			ret = notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+			goto not_sent;
+		case -1:
+			_stats_inc(s, failed);
+			ret = notify_session_get_error(s);
+			goto not_sent;
 	}
 
-	_mem_assert(msg = dbus_message_new_method_call("org.freedesktop.Notifications",
-				"/org/freedesktop/Notifications",
-				"org.freedesktop.Notifications",
-				"Notify"));
-
-	_mem_assert(dbus_message_append_args(msg,
-				DBUS_TYPE_STRING, &app_name,
-				DBUS_TYPE_UINT32, &replaces_id,
-				DBUS_TYPE_STRING, &app_icon,
-				DBUS_TYPE_STRING, &summary,
-				DBUS_TYPE_STRING, &body,
-				DBUS_TYPE_INVALID));
-
-	dbus_message_iter_init_append(msg, &iter);
-
-	/* actions */
-	_mem_assert(dbus_message_iter_open_container(&iter,
-				DBUS_TYPE_ARRAY, DBUS_TYPE_STRING_AS_STRING, &subiter));
-	for (al = n->actions; al; al = al->next) {
-		_mem_assert(dbus_message_iter_append_basic(&subiter,
-					DBUS_TYPE_STRING, &al->key));
-		_mem_assert(dbus_message_iter_append_basic(&subiter,
-					DBUS_TYPE_STRING, &al->desc));
+	/* send the spooled notifications first, to keep the order; a failed
+	 * connection is not attempted again below */
+	if (_notify_spool_pending(s)) {
+		if (notify_session_connect(s))
+			connect_failed = 1;
+		else
+			_notify_spool_replay(s);
 	}
-	_mem_assert(dbus_message_iter_close_container(&iter, &subiter));
-
-	/* hints */
-	_mem_assert(dbus_message_iter_open_container(&iter,
-				DBUS_TYPE_ARRAY,
-				DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
-				DBUS_TYPE_STRING_AS_STRING
-				DBUS_TYPE_VARIANT_AS_STRING
-				DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
-				&subiter));
-
-	/* -> urgency */
-	if (n->urgency != NOTIFICATION_NO_URGENCY) {
-		const unsigned char urgency = n->urgency;
-
-		_notification_append_hint(&subiter, "urgency",
-				DBUS_TYPE_BYTE_AS_STRING, &urgency);
+
+	if (connect_failed || notify_session_connect(s)) {
+		ret = notify_session_get_error(s);
+		/* keep it to be sent later, if possible */
+		if (_notify_spool_enabled(s)
+				&& n->message_id == NOTIFICATION_NO_NOTIFICATION_ID) {
+			errno = saved_errno;
+			if (formatted || !_notification_format_text(n, s, ap, &t)) {
+				formatted = 1;
+				ret = _notify_spool_failed(s, n, &t, ret);
+			}
+		}
+		_stats_inc(s, failed);
+		goto not_sent;
 	}
-	/* -> category */
-	if (n->category)
-		_notification_append_hint(&subiter, "category",
-				DBUS_TYPE_STRING_AS_STRING, &n->category);
-
-	_mem_assert(dbus_message_iter_close_container(&iter, &subiter));
-
-	_mem_assert(dbus_message_iter_append_basic(&iter,
-				DBUS_TYPE_INT32, &expire_timeout));
-
-	dbus_error_init(&err);
-	reply = dbus_connection_send_with_reply_and_block(s->conn,
-			msg, DBUS_TIMEOUT_INFINITE, &err);
-
-	assert(!reply == dbus_error_is_set(&err));
-	if (!reply) {
-		err_msg = strdup(err.message);
-		dbus_error_free(&err);
-		ret = NOTIFY_ERROR_DBUS_SEND;
-	} else {
-		dbus_uint32_t new_id;
-
-		assert(dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN);
-
-		if (!dbus_message_get_args(reply, &err,
-					DBUS_TYPE_UINT32, &new_id,
-					DBUS_TYPE_INVALID)) {
-			err_msg = strdup(err.message);
-			dbus_error_free(&err);
-			ret = NOTIFY_ERROR_INVALID_REPLY;
-		} else {
-			n->message_id = new_id;
-			err_msg = NULL;
-			ret = NOTIFY_ERROR_NO_ERROR;
-
-			_notify_session_add_notification(s, n);
+	_timing_mark(s, NOTIFY_TIMING_CONNECT);
+	_notify_state_resume(s, n);
+
+	if (!formatted) {
+		errno = saved_errno;
+		ret = _notification_format_text(n, s, ap, &t);
+		_timing_mark(s, NOTIFY_TIMING_FORMAT);
+	} else
+		ret = NOTIFY_ERROR_NO_ERROR;
+	if (!ret) {
+		if (s->queue.length)
+			ret = _notify_queue_push(s, n, &t);
+		else {
+			ret = _notification_send_text(n, s, &t);
+			if (ret && _notify_spool_enabled(s))
+				ret = _notify_spool_failed(s, n, &t, ret);
+			_notification_text_free(&t);
 		}
+	}
 
-		dbus_message_unref(reply);
+	_timing_finish(s);
+	if (ret) {
+		_stats_inc(s, failed);
+		if (dedup_hash)
+			_notify_dedup_forget(s, dedup_hash);
 	}
+	return ret;
 
-	dbus_message_unref(msg);
-	if (n->formatting)
-		free(f_summary);
-	return notify_session_set_error(s, ret, err_msg);
+not_sent:
+	if (formatted)
+		_notification_text_free(&t);
+	/* the repeats of what wasn't shown shouldn't be dropped */
+	if (dedup_hash)
+		_notify_dedup_forget(s, dedup_hash);
+	_timing_finish(s);
+	return ret;
 }
 
 static NotifyError notification_send_va(Notification n, NotifySession s, va_list ap) {
-	n->message_id = NOTIFICATION_NO_NOTIFICATION_ID;
+	/* registered notifications replace the one sent under the same key */
+	if (!n->registry_key)
+		n->message_id = NOTIFICATION_NO_NOTIFICATION_ID;
 	return notification_update_va(n, s, ap);
 }
 
@@ -261,56 +482,47 @@ NotifyError notification_update(Notification n, NotifySession s, ...) {
 
 NotifyError notification_close(Notification n, NotifySession s) {
 	NotifyError ret;
-	char *err_msg;
-
-	DBusMessage *msg, *reply;
-	DBusError err;
-
-	dbus_uint32_t id = n->message_id;
-
-	if (id == NOTIFICATION_NO_NOTIFICATION_ID)
+	struct _notify_call c;
+
+	/* it may have been sent by the previous instance of the program */
+	_notify_state_resume(s, n);
+	/* a notification which was not sent yet doesn't need to be closed */
+	if (_notify_queue_cancel(s, n)
+			&& n->message_id == NOTIFICATION_NO_NOTIFICATION_ID)
+		return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+	if (n->message_id == NOTIFICATION_NO_NOTIFICATION_ID)
 		return notify_session_set_error(s, NOTIFY_ERROR_NO_NOTIFICATION_ID);
+	_notify_expiry_cancel(s, n->message_id);
 
-	if (notify_session_connect(s))
+	_timing_start(s);
+	if (notify_session_connect(s)) {
+		_timing_finish(s);
+		_stats_inc(s, failed);
 		return notify_session_get_error(s);
-
-	_mem_assert(msg = dbus_message_new_method_call("org.freedesktop.Notifications",
-				"/org/freedesktop/Notifications",
-				"org.freedesktop.Notifications",
-				"CloseNotification"));
-
-	_mem_assert(dbus_message_append_args(msg,
-				DBUS_TYPE_UINT32, &id,
-				DBUS_TYPE_INVALID));
-
-	dbus_error_init(&err);
-	reply = dbus_connection_send_with_reply_and_block(s->conn,
-			msg, 5000 /* XXX */, &err);
-
-	assert(!reply == dbus_error_is_set(&err));
-	if (!reply) {
-		err_msg = strdup(err.message);
-		dbus_error_free(&err);
-		ret = NOTIFY_ERROR_DBUS_SEND;
-	} else {
-		assert(dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN);
-
-		if (!dbus_message_get_args(reply, &err,
-					DBUS_TYPE_INVALID)) {
-			err_msg = strdup(err.message);
-			dbus_error_free(&err);
-			ret = NOTIFY_ERROR_INVALID_REPLY;
-		} else {
-			n->message_id = NOTIFICATION_NO_NOTIFICATION_ID;
-			err_msg = NULL;
-			ret = NOTIFY_ERROR_NO_ERROR;
-		}
-
-		dbus_message_unref(reply);
+	}
+	_timing_mark(s, NOTIFY_TIMING_CONNECT);
+
+	c.method = _NOTIFY_CALL_CLOSE_NOTIFICATION;
+	c.id = n->message_id;
+
+	ret = _notify_transport_call(s, &c, 5000 /* XXX */, NULL);
+	if (!ret) {
+		_probe(reply__received, s, c.id);
+		n->message_id = NOTIFICATION_NO_NOTIFICATION_ID;
+		_notify_state_sync(s, n);
+		_stats_inc(s, closed);
+
+		/* the NotificationClosed signal won't match the notification
+		 * anymore, so the event is emitted from the next dispatch (a registered
+		 * one is released even if not tracked) */
+		if (_notify_session_remove_notification(s, n) || n->registry_key)
+			_notify_session_defer_closed(s, n);
 	}
 
-	dbus_message_unref(msg);
-	return notify_session_set_error(s, ret, err_msg);
+	_timing_finish(s);
+	if (ret)
+		_stats_inc(s, failed);
+	return ret;
 }
 
 void notification_set_formatting(Notification n, int formatting) {
@@ -320,8 +532,11 @@ void notification_set_formatting(Notification n, int formatting) {
 void notification_set_summary(Notification n, const char* summary) {
 	assert(summary);
 	_property_assign_str(&n->summary, summary);
+	n->summary_format_safe = _notify_utf8_format_is_safe(n->summary);
 }
 
 void notification_set_body(Notification n, const char* body) {
+	_notification_body_free(n);
 	_property_assign_str(&n->body, body);
+	n->body_format_safe = !n->body || _notify_utf8_format_is_safe(n->body);
 }
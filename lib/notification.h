@@ -7,6 +7,8 @@
 #ifndef _TINYNOTIFY_NOTIFICATION_H
 #define _TINYNOTIFY_NOTIFICATION_H
 
+#include <stddef.h>
+
 /**
  * SECTION: Notification
  * @short_description: API to deal with a single notification
@@ -26,6 +28,10 @@
  * it won't store any reference to the #NotifySession or any data contained
  * within it. In other words, one may safely free a #NotifySession after use,
  * and reuse the same #Notification in another session.
+ *
+ * All the strings are expected to be UTF-8 encoded. Invalid sequences
+ * (e.g. from binary data) are replaced with U+FFFD REPLACEMENT CHARACTER
+ * when the string is set, or formatted.
  */
 
 /**
@@ -86,6 +92,9 @@ Notification notification_new_unformatted(const char* summary, const char* body)
  *
  * This function always succeeds. After a call to this function,
  * a #Notification is no longer valid.
+ *
+ * The notifications registered in a session (see notify_session_register())
+ * are owned by the session, and must not be freed using this function.
  */
 void notification_free(Notification notification);
 
@@ -150,6 +159,45 @@ extern const int NOTIFICATION_NO_EXPIRE_TIMEOUT;
  */
 void notification_set_expire_timeout(Notification notification, int expire_timeout);
 
+/**
+ * NOTIFICATION_NO_TTL
+ *
+ * A constant specifying that the notification shall not have a time-to-live.
+ */
+extern const int NOTIFICATION_NO_TTL;
+
+/**
+ * notification_set_ttl
+ * @notification: notification to operate on
+ * @ttl: a new time-to-live [ms], or %NOTIFICATION_NO_TTL
+ *
+ * Set the time-to-live for a notification, in milliseconds. It counts from
+ * the notification_send() or notification_update() call.
+ *
+ * If the notification is still waiting in the outgoing queue (see
+ * notify_session_set_queue()) when its time-to-live passes, it is dropped
+ * without being sent. If it has been sent already, it can be closed
+ * (see notification_set_close_on_ttl()).
+ *
+ * Unlike the expiration timeout, the time-to-live is handled by the library,
+ * and it doesn't depend on the notification being displayed.
+ */
+void notification_set_ttl(Notification notification, int ttl);
+
+/**
+ * notification_set_close_on_ttl
+ * @notification: notification to operate on
+ * @enabled: zero (false) to disable, non-zero (true) to enable
+ *
+ * Enable or disable closing the notification when its time-to-live passes.
+ * The CloseNotification call is sent by notify_session_dispatch(), so it
+ * needs to be called meanwhile.
+ *
+ * Sending or updating the notification again replaces the previously
+ * scheduled close.
+ */
+void notification_set_close_on_ttl(Notification notification, int enabled);
+
 /**
  * NotificationUrgency
  * @NOTIFICATION_URGENCY_LOW: low urgency level
@@ -181,6 +229,9 @@ extern const short int NOTIFICATION_NO_URGENCY;
  *
  * If set to %NOTIFICATION_NO_URGENCY, the current urgency level would be
  * cleared.
+ *
+ * If the session has an outgoing queue (see notify_session_set_queue()),
+ * the notifications with higher urgency are sent first.
  */
 void notification_set_urgency(Notification notification, short int urgency);
 
@@ -225,6 +276,10 @@ void notification_set_category(Notification notification, const char* category);
  * within the #Notification type. The notification_update() function can be
  * used to update the notification afterwards.
  *
+ * If the notification is registered in the session (see
+ * notify_session_register()), it replaces the notification shown previously
+ * under the same key, like notification_update() does.
+ *
  * Returns: a positive #NotifyError or %NOTIFY_ERROR_NO_ERROR
  */
 NotifyError notification_send(Notification notification, NotifySession session, ...);
@@ -267,7 +322,10 @@ NotifyError notification_update(Notification notification, NotifySession session
  * it or the notification identifier was invalid.
  *
  * This function unsets the notification ID stored in #Notification -- it is no
- * longer valid after the notification is closed.
+ * longer valid after the notification is closed. If the notification has
+ * a close callback bound, it is called (with %NOTIFICATION_CLOSED_BY_CALLER)
+ * from the next notify_session_dispatch() call, unless the notification is
+ * sent again or freed before.
  *
  * Returns: a positive #NotifyError or %NOTIFY_ERROR_NO_ERROR
  */
@@ -313,4 +371,66 @@ void notification_set_summary(Notification notification, const char* summary);
  */
 void notification_set_body(Notification notification, const char* body);
 
+/**
+ * NOTIFICATION_BODY_NO_LIMIT
+ *
+ * A constant specifying that the body read by
+ * notification_set_body_from_fd() or notification_set_body_from_buffer()
+ * shouldn't be limited in bytes or lines.
+ */
+extern const size_t NOTIFICATION_BODY_NO_LIMIT;
+
+/**
+ * notification_set_body_from_fd
+ * @notification: notification to operate on
+ * @fd: an open file descriptor to read the body from
+ * @max_bytes: the maximal body length in bytes,
+ *	or %NOTIFICATION_BODY_NO_LIMIT
+ * @max_lines: the maximal number of body lines,
+ *	or %NOTIFICATION_BODY_NO_LIMIT
+ *
+ * Set the body of a notification to the contents of @fd, starting at
+ * the current file offset. The body is cut to @max_bytes bytes (without
+ * splitting a multibyte UTF-8 character) and @max_lines lines, and ends
+ * before the first NUL character. The body is not used as a format string.
+ *
+ * Large regular files are mapped into memory rather than read, and sent
+ * without copying them into the #Notification (if mapping fails, they are
+ * read instead). Such a file must not be truncated nor modified until
+ * the notification is freed or its body is replaced: accessing the truncated
+ * part raises SIGBUS, and the modified contents are sent without being
+ * validated. Files which may change (e.g. logs rotated by truncation)
+ * should be read by the caller, and set using
+ * notification_set_body_from_buffer(). Other files are read only up to
+ * the limits. For regular files, the file offset is not changed.
+ *
+ * Returns: 0 on success, -1 on error (with errno set; the body is left
+ * unchanged then)
+ */
+int notification_set_body_from_fd(Notification notification, int fd,
+		size_t max_bytes, unsigned int max_lines);
+
+/**
+ * notification_set_body_from_buffer
+ * @notification: notification to operate on
+ * @data: the body contents (not necessarily NUL-terminated)
+ * @length: the length of @data, in bytes
+ * @max_bytes: the maximal body length in bytes,
+ *	or %NOTIFICATION_BODY_NO_LIMIT
+ * @max_lines: the maximal number of body lines,
+ *	or %NOTIFICATION_BODY_NO_LIMIT
+ *
+ * Set the body of a notification to (a part of) @data, cut the same way
+ * as in notification_set_body_from_fd().
+ *
+ * The @data is not copied; it has to stay valid and unchanged until
+ * the notification is freed or another body is set. This way, it can
+ * reside in a caller-owned or mmap()-ed buffer.
+ *
+ * Returns: 0 on success
+ */
+int notification_set_body_from_buffer(Notification notification,
+		const char* data, size_t length, size_t max_bytes,
+		unsigned int max_lines);
+
 #endif /*_TINYNOTIFY_NOTIFICATION_H*/
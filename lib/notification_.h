@@ -7,7 +7,8 @@
 #ifndef _TINYNOTIFY_NOTIFICATION__H
 #define _TINYNOTIFY_NOTIFICATION__H
 
-#include <dbus/dbus.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "notification.h"
 #include "event.h"
@@ -15,23 +16,96 @@
 /*<private_header>*/
 #pragma GCC visibility push(hidden)
 
+struct _notification_image;
+
+struct _notification_hint {
+	/* the D-Bus type code of the value, 'a' meaning 'ay' */
+	char type;
+
+	/* the complete a{sv} dict entry, encoded in native byte order;
+	 * it has to be placed at an 8-aligned offset */
+	unsigned char* blob;
+	size_t len;
+	/* the value within blob, for transports which can't use it directly */
+	size_t value_offset;
+	size_t value_len;
+
+	struct _notification_hint* next;
+};
+
+/* the key is the first member of the dict entry, after its length */
+#define _notification_hint_key(h) ((const char*) (h)->blob + 4)
+
 struct _notification {
 	char* summary;
 	char* body;
 	int formatting;
+	/* whether the formatted summary/body needs UTF-8 validation */
+	int summary_format_safe;
+	int body_format_safe;
+	int escape_markup;
+
+	/* raw bodies (set from a file or a buffer) are never formatted,
+	 * and don't have to be NUL-terminated */
+	enum {
+		_NOTIFICATION_BODY_STRING,
+		_NOTIFICATION_BODY_ALLOCATED,
+		_NOTIFICATION_BODY_MAPPED,
+		_NOTIFICATION_BODY_BORROWED
+	} body_type;
+	size_t body_len;
+	/* the whole mapping, for _NOTIFICATION_BODY_MAPPED */
+	void* body_map;
+	size_t body_map_len;
 
 	NotificationCloseCallback close_callback;
 	void* close_data;
 	struct _notification_action_list* actions;
 
-	dbus_int32_t expire_timeout;
-	NotificationUrgency urgency;
-	char* category;
+	int32_t expire_timeout;
+	/* [ms], negative if none */
+	int ttl;
+	int close_on_ttl;
+	struct _notification_hint* hints;
+	struct _notification_image* image;
 
 	char* app_icon;
+	char* aggregation_key;
+	/* the key in the session registry (owned by it), NULL if none */
+	const char* registry_key;
+
+	uint32_t message_id;
+
+	/* the queue entries referring to the notification; if it is freed
+	 * while there are some, it is destroyed with the last one */
+	unsigned int queue_refs;
+	int freed;
 
-	dbus_uint32_t message_id;
+	/* the session to emit the close event from (after notification_close()),
+	 * and the next notification waiting there */
+	NotifySession close_pending;
+	Notification close_next;
 };
 
+void _notification_destroy(Notification n);
+
+void _notification_body_free(Notification n);
+
+/* hint lists, shared by notifications and session defaults */
+void _notification_hints_set(struct _notification_hint** list,
+		const char* key, char type, const void* value, size_t value_len);
+void _notification_hints_remove(struct _notification_hint** list,
+		const char* key);
+int _notification_hints_contain(const struct _notification_hint* list,
+		const char* key);
+/* get the value of a 'y' hint, or def if it is not set */
+int _notification_hints_get_byte(const struct _notification_hint* list,
+		const char* key, int def);
+/* get the value of an 's' hint, or def if it is not set */
+const char* _notification_hints_get_string(
+		const struct _notification_hint* list, const char* key,
+		const char* def);
+void _notification_hints_free(struct _notification_hint** list);
+
 #pragma GCC visibility pop
 #endif /*_TINYNOTIFY_NOTIFICATION__H*/
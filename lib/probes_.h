@@ -0,0 +1,36 @@
+/* libtinynotify -- static tracepoints
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_PROBES__H
+#define _TINYNOTIFY_PROBES__H
+
+/*<private_header>*/
+
+/* SystemTap/USDT probes, provider 'tinynotify'. The first argument is always
+ * the NotifySession pointer, the second one the notification ID (or zero if
+ * none is known yet):
+ *
+ * connect(session, success)
+ * message-built(session, replaces_id)
+ * message-sent(session, replaces_id)
+ * reply-received(session, message_id)
+ * signal-received(session, message_id)
+ * callback-entry(session, message_id)
+ * callback-return(session, message_id)
+ *
+ * When not attached, a probe costs a single nop instruction.
+ */
+
+#ifdef ENABLE_SDT_PROBES
+#	include <sys/sdt.h>
+
+#	define _probe(name, s, id) \
+		STAP_PROBE2(tinynotify, name, (s), (unsigned long) (id))
+#else
+#	define _probe(name, s, id) do { (void) (s); (void) (id); } while (0)
+#endif
+
+#endif /*_TINYNOTIFY_PROBES__H*/
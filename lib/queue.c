@@ -0,0 +1,617 @@
+/* libtinynotify -- outgoing notification queue
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+#include "queue.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "event_.h"
+#include "stats_.h"
+#include "memory_.h"
+#include "transport_.h"
+#include "queue_.h"
+#include "dedup_.h"
+#include "probes_.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum _notify_queue_policy {
+	_QUEUE_BLOCK,
+	_QUEUE_DROP_NEWEST,
+	_QUEUE_DROP_OLDEST,
+	_QUEUE_DROP_LOWEST_URGENCY,
+	_QUEUE_COALESCE
+};
+
+const NotifyQueuePolicy NOTIFY_QUEUE_BLOCK = _QUEUE_BLOCK;
+const NotifyQueuePolicy NOTIFY_QUEUE_DROP_NEWEST = _QUEUE_DROP_NEWEST;
+const NotifyQueuePolicy NOTIFY_QUEUE_DROP_OLDEST = _QUEUE_DROP_OLDEST;
+const NotifyQueuePolicy NOTIFY_QUEUE_DROP_LOWEST_URGENCY = _QUEUE_DROP_LOWEST_URGENCY;
+const NotifyQueuePolicy NOTIFY_QUEUE_COALESCE = _QUEUE_COALESCE;
+
+const size_t NOTIFY_SESSION_NO_QUEUE = 0;
+const int NOTIFY_SESSION_DEFAULT_QUEUE_DEADLINE = 1000;
+const int NOTIFY_SESSION_NO_QUEUE_AGING = 0;
+const int NOTIFY_SESSION_DEFAULT_QUEUE_AGING = 2000;
+
+/* the number of calls sent without waiting for the replies; the rest
+ * is kept in the queue, where it can be dropped or coalesced */
+#define QUEUE_WINDOW 4
+/* the time [ms] to wait for the reply to a queued call, the same as
+ * the default of libdbus; a server which stopped replying would hold
+ * the window forever otherwise */
+#define QUEUE_REPLY_TIMEOUT 25000
+
+void notify_session_set_queue(NotifySession s, size_t length,
+		NotifyQueuePolicy policy) {
+	s->queue.length = length;
+	s->queue.policy = policy;
+}
+
+void notify_session_set_queue_deadline(NotifySession s, int timeout) {
+	s->queue.deadline = timeout;
+}
+
+void notify_session_set_queue_aging(NotifySession s, int interval) {
+	s->queue.aging = interval;
+}
+
+void _notify_queue_init(struct _notify_queue* q) {
+	memset(q, 0, sizeof(*q));
+	q->policy = _QUEUE_BLOCK;
+	q->deadline = NOTIFY_SESSION_DEFAULT_QUEUE_DEADLINE;
+	q->aging = NOTIFY_SESSION_DEFAULT_QUEUE_AGING;
+}
+
+/* point e at n (or NULL), destroying the notification which was
+ * freed while queued when its last entry lets go of it */
+static void _queue_entry_set_notification(struct _notify_queue_entry* e,
+		Notification n) {
+	Notification old = e->n;
+
+	if (n)
+		n->queue_refs++;
+	e->n = n;
+	if (old && !--old->queue_refs && old->freed)
+		_notification_destroy(old);
+}
+
+static void _queue_entry_free(NotifySession s,
+		struct _notify_queue_entry* e) {
+	_queue_entry_set_notification(e, NULL);
+	_notify_mem_release(s, e->size);
+	_notification_text_free(&e->text);
+	if (e->expiry)
+		_notify_expiry_discard(s, e->expiry);
+	free(e);
+}
+
+/* set the time-to-live of e from n; returns non-zero (leaving e
+ * unchanged) on failure */
+static int _queue_entry_set_ttl(NotifySession s,
+		struct _notify_queue_entry* e, Notification n) {
+	struct _notify_expiry *expiry = NULL;
+	struct timespec deadline;
+	int has_deadline = _notification_get_deadline(n, &deadline);
+
+	if (has_deadline && n->close_on_ttl
+			&& !(expiry = _notify_expiry_new(s, &deadline)))
+		return -1;
+
+	if (e->expiry)
+		_notify_expiry_discard(s, e->expiry);
+	e->has_deadline = has_deadline;
+	e->deadline = deadline;
+	e->expiry = expiry;
+	return 0;
+}
+
+static void _queue_update_stats(NotifySession s) {
+	s->stats.counters.queued = s->queue.pending_count;
+	_stats_publish(s);
+}
+
+void _notify_queue_clear(NotifySession s) {
+	struct _notify_queue* q = &s->queue;
+	struct _notify_queue_entry *e, *next;
+
+	for (e = q->pending; e; e = next) {
+		next = e->next;
+		_queue_entry_free(s, e);
+		_stats_inc(s, queue_dropped);
+	}
+	for (e = q->in_flight; e; e = next) {
+		next = e->next;
+		_queue_entry_free(s, e);
+		_stats_dec(s, in_flight);
+		_stats_inc(s, failed);
+	}
+
+	q->pending = q->in_flight = NULL;
+	q->pending_count = q->in_flight_count = 0;
+	_queue_update_stats(s);
+}
+
+static int _queue_is_in_flight(const struct _notify_queue* q,
+		Notification n) {
+	const struct _notify_queue_entry *e;
+
+	for (e = q->in_flight; e; e = e->next) {
+		if (e->n == n)
+			return 1;
+	}
+
+	return 0;
+}
+
+static int _queue_urgency(NotifySession s, Notification n) {
+	int urgency = _notification_hints_get_byte(n->hints, "urgency",
+			_notification_hints_get_byte(s->default_hints, "urgency",
+				NOTIFICATION_URGENCY_NORMAL));
+
+	/* the hint is a byte, and it can be set directly */
+	if (urgency > NOTIFICATION_URGENCY_CRITICAL)
+		urgency = NOTIFICATION_URGENCY_CRITICAL;
+	return urgency;
+}
+
+/* returns non-zero on failure (with the entry freed) */
+static int _queue_send(NotifySession s, struct _notify_queue_entry* e) {
+	struct _notify_call c;
+	struct _notification_hint uncached_image;
+	int ret;
+
+	uncached_image.blob = NULL;
+	if (_notification_build_call(e->n, s, &e->text, &c, &uncached_image))
+		ret = !!_notify_session_out_of_memory(s);
+	else
+		ret = !!s->transport->send(s, &c, &e->serial);
+	free(uncached_image.blob);
+
+	if (ret) {
+		_queue_entry_free(s, e);
+		_stats_inc(s, failed);
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &e->sent_at);
+	_stats_inc(s, in_flight);
+
+	/* only the entry itself is needed for the reply */
+	_notification_text_free(&e->text);
+	_notify_mem_release(s, e->size - sizeof(*e));
+	e->size = sizeof(*e);
+	return 0;
+}
+
+static long _queue_ms_between(const struct timespec* start,
+		const struct timespec* end) {
+	return (end->tv_sec - start->tv_sec) * 1000
+		+ (end->tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static long _queue_elapsed_ms(const struct timespec* start) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return _queue_ms_between(start, &now);
+}
+
+/* find the pending entry to be sent next, or NULL if none can be sent
+ * now. That is the oldest of the ones with the highest urgency, raised
+ * by one level for every aging interval waited. */
+static struct _notify_queue_entry** _queue_find_next(
+		struct _notify_queue* q) {
+	struct _notify_queue_entry **ep, **next = NULL;
+	struct timespec now;
+	int next_prio = -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (ep = &q->pending; *ep; ep = &(*ep)->next) {
+		struct _notify_queue_entry *e = *ep, *prev;
+		int prio = e->urgency;
+
+		/* an update needs the ID assigned by the previous call */
+		if (_queue_is_in_flight(q, e->n))
+			continue;
+		/* and it must not overtake the previous one */
+		for (prev = q->pending; prev->n != e->n; prev = prev->next);
+		if (prev != e)
+			continue;
+
+		if (q->aging > 0) {
+			long waited = _queue_ms_between(&e->queued_at, &now);
+
+			if (waited / q->aging >= NOTIFICATION_URGENCY_CRITICAL - prio)
+				prio = NOTIFICATION_URGENCY_CRITICAL;
+			else
+				prio += waited / q->aging;
+		}
+		if (prio > next_prio) {
+			next = ep;
+			next_prio = prio;
+		}
+	}
+
+	return next;
+}
+
+/* drop the pending entries past their time-to-live */
+static void _queue_drop_expired(NotifySession s) {
+	struct _notify_queue* q = &s->queue;
+	struct _notify_queue_entry **ep, *e;
+
+	for (ep = &q->pending; *ep;) {
+		e = *ep;
+		if (e->has_deadline && _notify_deadline_passed(&e->deadline)) {
+			*ep = e->next;
+			q->pending_count--;
+			_queue_entry_free(s, e);
+			_stats_inc(s, queue_expired);
+		} else
+			ep = &e->next;
+	}
+}
+
+/* give up on the calls which weren't replied in time; a late reply
+ * is ignored */
+static void _queue_drop_unreplied(NotifySession s) {
+	struct _notify_queue* q = &s->queue;
+	struct _notify_queue_entry **ep, *e;
+
+	for (ep = &q->in_flight; *ep;) {
+		e = *ep;
+		if (_queue_elapsed_ms(&e->sent_at) >= QUEUE_REPLY_TIMEOUT) {
+			*ep = e->next;
+			q->in_flight_count--;
+			_queue_entry_free(s, e);
+			_stats_dec(s, in_flight);
+			_stats_inc(s, failed);
+		} else
+			ep = &e->next;
+	}
+}
+
+int _notify_queue_timeout(NotifySession s, int timeout) {
+	const struct _notify_queue_entry *e;
+	long remaining;
+
+	for (e = s->queue.in_flight; e; e = e->next) {
+		remaining = QUEUE_REPLY_TIMEOUT - _queue_elapsed_ms(&e->sent_at);
+		if (remaining < 0)
+			remaining = 0;
+		if (timeout < 0 || remaining < timeout)
+			timeout = remaining;
+	}
+
+	return timeout;
+}
+
+void _notify_queue_pump(NotifySession s) {
+	struct _notify_queue* q = &s->queue;
+	struct _notify_queue_entry **ep;
+	int sent = 0;
+
+	_queue_drop_expired(s);
+	_queue_drop_unreplied(s);
+
+	while (q->in_flight_count < QUEUE_WINDOW
+			&& (ep = _queue_find_next(q))) {
+		struct _notify_queue_entry *e = *ep;
+
+		*ep = e->next;
+		q->pending_count--;
+		_notify_stats_add_queue_delay(s, e->urgency, &e->queued_at);
+		if (_queue_send(s, e))
+			continue;
+
+		e->next = q->in_flight;
+		q->in_flight = e;
+		q->in_flight_count++;
+		sent = 1;
+	}
+
+	_queue_update_stats(s);
+	/* get the messages written */
+	if (sent)
+		s->transport->read_write(s, 0);
+}
+
+int _notify_queue_handle_reply(NotifySession s,
+		const struct _notify_signal* sig) {
+	struct _notify_queue* q = &s->queue;
+	struct _notify_queue_entry **ep, *e;
+
+	for (ep = &q->in_flight; *ep; ep = &(*ep)->next) {
+		if ((*ep)->serial == sig->serial)
+			break;
+	}
+	if (!*ep)
+		return 0;
+
+	e = *ep;
+	*ep = e->next;
+	q->in_flight_count--;
+	_notify_stats_add_latency(s, &e->sent_at);
+	_stats_dec(s, in_flight);
+
+	if (!sig->error_message) {
+		_probe(reply__received, s, sig->id);
+		/* the notification could have been unregistered and freed */
+		if (e->n && !e->n->freed) {
+			e->n->message_id = sig->id;
+			_notify_state_sync(s, e->n);
+			/* there is no caller to report the failure to */
+			_notify_session_add_notification(s, e->n);
+		}
+		_stats_inc(s, sent);
+		if (e->text.hash)
+			_notify_dedup_record(s, e->text.hash, sig->id);
+
+		if (e->expiry) {
+			_notify_expiry_schedule(s, e->expiry, sig->id);
+			e->expiry = NULL;
+		} else
+			_notify_expiry_cancel(s, sig->id);
+	} else
+		_stats_inc(s, failed);
+
+	_queue_entry_free(s, e);
+	_notify_queue_pump(s);
+	return 1;
+}
+
+/* process the replies until done() is true, or the timeout passes;
+ * returns the value of done() */
+static int _queue_wait(NotifySession s, int timeout,
+		int (*done)(NotifySession s, const void* data), const void* data) {
+	struct timespec start;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (!done(s, data) && s->transport_data) {
+		long remaining = timeout;
+
+		if (timeout >= 0) {
+			remaining -= _queue_elapsed_ms(&start);
+			if (remaining <= 0)
+				break;
+		}
+
+		_notify_session_process(s, remaining);
+		if (s->transport_data)
+			_notify_queue_pump(s);
+	}
+
+	return done(s, data);
+}
+
+static int _queue_has_room(NotifySession s, const void* data) {
+	return s->queue.pending_count < s->queue.length;
+}
+
+static int _queue_is_flushed(NotifySession s, const void* data) {
+	return _notify_queue_empty(&s->queue);
+}
+
+static int _queue_is_replied(NotifySession s, const void* data) {
+	return !_queue_is_in_flight(&s->queue, (Notification) data);
+}
+
+/* find the entry to be dropped to make room for one with urgency,
+ * or NULL if the new one should be dropped */
+static struct _notify_queue_entry** _queue_find_victim(
+		struct _notify_queue* q, int urgency) {
+	struct _notify_queue_entry **ep, **victim = NULL;
+
+	switch (q->policy) {
+		case _QUEUE_DROP_OLDEST:
+			return &q->pending;
+		case _QUEUE_DROP_LOWEST_URGENCY:
+			for (ep = &q->pending; *ep; ep = &(*ep)->next) {
+				if ((*ep)->urgency < urgency
+						&& (!victim || (*ep)->urgency < (*victim)->urgency))
+					victim = ep;
+			}
+			return victim;
+		default:
+			return NULL;
+	}
+}
+
+static struct _notify_queue_entry* _queue_find_coalesced(
+		struct _notify_queue* q, Notification n) {
+	struct _notify_queue_entry *e;
+
+	for (e = q->pending; e; e = e->next) {
+		if (e->n == n || (n->message_id
+					&& e->n->message_id == n->message_id))
+			return e;
+	}
+
+	return NULL;
+}
+
+NotifyError _notify_queue_push(NotifySession s, Notification n,
+		struct _notification_text* t) {
+	struct _notify_queue* q = &s->queue;
+	struct _notify_queue_entry *e;
+	struct _notify_call c;
+	struct _notification_hint uncached_image;
+	NotifyError ret;
+	size_t size;
+
+	/* make room using the replies received so far */
+	if (q->in_flight)
+		_notify_session_process(s, 0);
+	if (!s->transport_data) {
+		_notification_text_free(t);
+		return notify_session_set_error(s, NOTIFY_ERROR_DBUS_SEND,
+				"Connection is closed");
+	}
+
+	if (_notification_text_own(t)) {
+		_notification_text_free(t);
+		return _notify_session_out_of_memory(s);
+	}
+
+	/* the message is built when sent, but charge it already */
+	uncached_image.blob = NULL;
+	if (_notification_build_call(n, s, t, &c, &uncached_image)) {
+		_notification_text_free(t);
+		return _notify_session_out_of_memory(s);
+	}
+	size = sizeof(*e) + _notification_text_size(t) + _notify_call_size(&c);
+	if (uncached_image.blob)
+		size += uncached_image.len;
+	free(uncached_image.blob);
+
+	if (q->policy == _QUEUE_COALESCE && (e = _queue_find_coalesced(q, n))) {
+		_notify_mem_release(s, e->size);
+		if ((ret = _notify_session_charge(s, size))) {
+			/* it has just been released, so it fits */
+			_notify_mem_charge(s, e->size);
+			_notification_text_free(t);
+			return ret;
+		}
+		if (_queue_entry_set_ttl(s, e, n)) {
+			_notify_mem_release(s, size);
+			_notify_mem_charge(s, e->size);
+			_notification_text_free(t);
+			return notify_session_get_error(s);
+		}
+
+		_notification_text_free(&e->text);
+		e->text = *t;
+		_queue_entry_set_notification(e, n);
+		e->urgency = _queue_urgency(s, n);
+		e->size = size;
+		_stats_inc(s, queue_coalesced);
+		_notify_queue_pump(s);
+		return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+	}
+
+	if (q->pending_count >= q->length) {
+		struct _notify_queue_entry **victim;
+
+		if (q->policy == _QUEUE_BLOCK)
+			_queue_wait(s, q->deadline, _queue_has_room, NULL);
+		if (q->pending_count >= q->length) {
+			victim = _queue_find_victim(q, _queue_urgency(s, n));
+			if (!victim) {
+				_notification_text_free(t);
+				_stats_inc(s, queue_dropped);
+				return notify_session_set_error(s, NOTIFY_ERROR_QUEUE_FULL);
+			}
+
+			e = *victim;
+			*victim = e->next;
+			q->pending_count--;
+			_queue_entry_free(s, e);
+			_stats_inc(s, queue_dropped);
+		}
+	}
+
+	if ((ret = _notify_session_charge(s, size))) {
+		_notification_text_free(t);
+		return ret;
+	}
+	if (!(e = malloc(sizeof(*e)))) {
+		_notify_mem_release(s, size);
+		_notification_text_free(t);
+		return _notify_session_out_of_memory(s);
+	}
+
+	e->expiry = NULL;
+	if (_queue_entry_set_ttl(s, e, n)) {
+		free(e);
+		_notify_mem_release(s, size);
+		_notification_text_free(t);
+		return notify_session_get_error(s);
+	}
+
+	e->n = NULL;
+	_queue_entry_set_notification(e, n);
+	e->text = *t;
+	e->urgency = _queue_urgency(s, n);
+	e->size = size;
+	clock_gettime(CLOCK_MONOTONIC, &e->queued_at);
+	e->next = NULL;
+	{
+		struct _notify_queue_entry **ep;
+
+		for (ep = &q->pending; *ep; ep = &(*ep)->next);
+		*ep = e;
+	}
+	q->pending_count++;
+
+	_notify_queue_pump(s);
+	return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+}
+
+int _notify_queue_cancel(NotifySession s, Notification n) {
+	struct _notify_queue* q = &s->queue;
+	struct _notify_queue_entry **ep, *e;
+	int ret = 0;
+
+	for (ep = &q->pending; *ep;) {
+		e = *ep;
+		if (e->n == n) {
+			*ep = e->next;
+			q->pending_count--;
+			_queue_entry_free(s, e);
+			ret = 1;
+		} else
+			ep = &e->next;
+	}
+	_queue_update_stats(s);
+
+	if (_queue_is_in_flight(q, n))
+		_queue_wait(s, q->deadline, _queue_is_replied, n);
+	return ret;
+}
+
+void _notify_queue_transfer(NotifySession s, Notification from,
+		Notification to) {
+	struct _notify_queue* q = &s->queue;
+	struct _notify_queue_entry **ep, *e;
+
+	for (ep = &q->pending; *ep;) {
+		e = *ep;
+		if (e->n == from) {
+			*ep = e->next;
+			q->pending_count--;
+			_queue_entry_free(s, e);
+		} else
+			ep = &e->next;
+	}
+	_queue_update_stats(s);
+
+	for (e = q->in_flight; e; e = e->next) {
+		if (e->n == from)
+			_queue_entry_set_notification(e, to);
+	}
+}
+
+size_t notify_session_flush(NotifySession s, int timeout) {
+	struct _notify_queue* q = &s->queue;
+
+	if (s->transport_data && !s->transport->is_connected(s))
+		notify_session_disconnect(s);
+	if (!s->transport_data)
+		return q->pending_count + q->in_flight_count;
+
+	_notify_queue_pump(s);
+	_queue_wait(s, timeout, _queue_is_flushed, NULL);
+	return q->pending_count + q->in_flight_count;
+}
@@ -0,0 +1,177 @@
+/* libtinynotify -- outgoing notification queue
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_QUEUE_H
+#define _TINYNOTIFY_QUEUE_H
+
+#include <stddef.h>
+
+/**
+ * SECTION: NotifyQueue
+ * @short_description: API to send notifications without waiting for the server
+ * @include: tinynotify.h
+ *
+ * By default, notification_send() and notification_update() wait for
+ * the notification server to reply. If the server is slow, the caller is
+ * blocked as well. Alternatively, a #NotifySession can be given a bounded
+ * outgoing queue. Then, the summary and body are formatted and queued,
+ * and the notifications are sent as the server replies to the previous
+ * ones. The replies are processed by notify_session_dispatch(), which
+ * needs to be called regularly for the queue to make progress;
+ * notify_session_flush() can be used to wait for the queue to empty.
+ *
+ * The queued notifications are not sent in order. The ones with higher
+ * urgency (see notification_set_urgency()) are sent first; to prevent
+ * starvation, the urgency is raised by one level every time
+ * the notification waits for the aging interval (see
+ * notify_session_set_queue_aging()). The updates to a single notification
+ * are always sent in order.
+ *
+ * When the queue is full, the session policy decides whether the new
+ * notification waits for room (at most until the deadline set using
+ * notify_session_set_queue_deadline()), or which notification is dropped.
+ * The dropped notifications are counted in #NotifyStats.
+ *
+ * The properties other than the summary and body are read when
+ * the notification is actually sent. If the notification is freed before
+ * that, it is kept by the queue until sent, and the ID from the reply is
+ * discarded; no callbacks are invoked for it.
+ * The queue may need to process the pending replies and signals while
+ * sending, so the event callbacks can be invoked from within
+ * notification_send() and notification_update().
+ */
+
+/**
+ * NotifyQueuePolicy
+ *
+ * The action taken when a notification is sent while the queue is full.
+ */
+typedef const int NotifyQueuePolicy;
+
+/**
+ * NOTIFY_QUEUE_BLOCK
+ *
+ * Wait until the queue has room, at most until the queue deadline passes.
+ * If it does, the notification is dropped, and %NOTIFY_ERROR_QUEUE_FULL
+ * is returned.
+ */
+extern const NotifyQueuePolicy NOTIFY_QUEUE_BLOCK;
+
+/**
+ * NOTIFY_QUEUE_DROP_NEWEST
+ *
+ * Drop the notification being sent, and return %NOTIFY_ERROR_QUEUE_FULL.
+ */
+extern const NotifyQueuePolicy NOTIFY_QUEUE_DROP_NEWEST;
+
+/**
+ * NOTIFY_QUEUE_DROP_OLDEST
+ *
+ * Drop the oldest notification waiting in the queue.
+ */
+extern const NotifyQueuePolicy NOTIFY_QUEUE_DROP_OLDEST;
+
+/**
+ * NOTIFY_QUEUE_DROP_LOWEST_URGENCY
+ *
+ * Drop the oldest of the notifications with the lowest urgency. If no
+ * queued notification has urgency lower than the one being sent, the latter
+ * is dropped, and %NOTIFY_ERROR_QUEUE_FULL is returned.
+ */
+extern const NotifyQueuePolicy NOTIFY_QUEUE_DROP_LOWEST_URGENCY;
+
+/**
+ * NOTIFY_QUEUE_COALESCE
+ *
+ * If the notification (or another one with the same ID) is queued already,
+ * replace the queued one in place, whether the queue is full or not.
+ * Otherwise, behave like %NOTIFY_QUEUE_DROP_NEWEST.
+ */
+extern const NotifyQueuePolicy NOTIFY_QUEUE_COALESCE;
+
+/**
+ * NOTIFY_SESSION_NO_QUEUE
+ *
+ * A queue length disabling the queue; notification_send()
+ * and notification_update() wait for the server reply then.
+ */
+extern const size_t NOTIFY_SESSION_NO_QUEUE;
+
+/**
+ * notify_session_set_queue
+ * @session: session to operate on
+ * @length: the maximal number of notifications waiting to be sent,
+ *	or %NOTIFY_SESSION_NO_QUEUE
+ * @policy: the action taken when the queue is full
+ *
+ * Set up the outgoing queue for @session. By default, the queue
+ * is disabled.
+ *
+ * If the queue is disabled while notifications are still queued, they
+ * will be sent by notify_session_dispatch() and notify_session_flush().
+ */
+void notify_session_set_queue(NotifySession session, size_t length,
+		NotifyQueuePolicy policy);
+
+/**
+ * NOTIFY_SESSION_DEFAULT_QUEUE_DEADLINE
+ *
+ * The default time a sender can be blocked with %NOTIFY_QUEUE_BLOCK,
+ * in milliseconds.
+ */
+extern const int NOTIFY_SESSION_DEFAULT_QUEUE_DEADLINE;
+
+/**
+ * notify_session_set_queue_deadline
+ * @session: session to operate on
+ * @timeout: the time in milliseconds, or %NOTIFY_SESSION_NO_TIMEOUT
+ *
+ * Set the maximal time notification_send() and notification_update() can
+ * block waiting for room in the queue, with %NOTIFY_QUEUE_BLOCK.
+ */
+void notify_session_set_queue_deadline(NotifySession session, int timeout);
+
+/**
+ * NOTIFY_SESSION_NO_QUEUE_AGING
+ *
+ * An aging interval disabling aging; the lower urgency notifications are
+ * sent only when no higher urgency notifications are queued.
+ */
+extern const int NOTIFY_SESSION_NO_QUEUE_AGING;
+
+/**
+ * NOTIFY_SESSION_DEFAULT_QUEUE_AGING
+ *
+ * The default aging interval, in milliseconds.
+ */
+extern const int NOTIFY_SESSION_DEFAULT_QUEUE_AGING;
+
+/**
+ * notify_session_set_queue_aging
+ * @session: session to operate on
+ * @interval: the time in milliseconds, or %NOTIFY_SESSION_NO_QUEUE_AGING
+ *
+ * Set the aging interval for the queue of @session. Every time
+ * a notification waits for @interval in the queue, it is scheduled as if
+ * its urgency was one level higher.
+ */
+void notify_session_set_queue_aging(NotifySession session, int interval);
+
+/**
+ * notify_session_flush
+ * @session: session to operate on
+ * @timeout: max time to block in milliseconds, or %NOTIFY_SESSION_NO_TIMEOUT
+ *
+ * Send all the queued notifications, and wait for the server replies.
+ * Like notify_session_dispatch(), it dispatches the events received
+ * meanwhile.
+ *
+ * Returns: the number of notifications still queued or waiting for the reply
+ * (zero if the queue has been flushed)
+ */
+size_t notify_session_flush(NotifySession session, int timeout);
+
+#endif /*_TINYNOTIFY_QUEUE_H*/
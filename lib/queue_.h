@@ -0,0 +1,123 @@
+/* libtinynotify -- outgoing notification queue
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_QUEUE__H
+#define _TINYNOTIFY_QUEUE__H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+
+#include "notification_.h"
+#include "transport_.h"
+#include "expiry_.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+/* the summary and body, as they are to be sent */
+struct _notification_text {
+	const char* summary;
+	/* not necessarily NUL-terminated */
+	const char* body;
+	size_t body_len;
+
+	/* the buffers they point to, if allocated for sending */
+	char* summary_buf;
+	char* body_buf;
+
+	/* the content hash for deduplication, zero if not computed */
+	uint64_t hash;
+};
+
+/* format, escape and validate the summary and body of n */
+NotifyError _notification_format_text(Notification n, NotifySession s,
+		va_list ap, struct _notification_text* t);
+/* make t independent of the notification */
+int _notification_text_own(struct _notification_text* t);
+size_t _notification_text_size(const struct _notification_text* t);
+void _notification_text_free(struct _notification_text* t);
+
+/* fill the Notify call for n with the text t; the image hint may be
+ * encoded into uncached (whose blob is initially NULL), to be freed
+ * by the caller. Returns non-zero if out of memory. */
+int _notification_build_call(Notification n, NotifySession s,
+		const struct _notification_text* t, struct _notify_call* c,
+		struct _notification_hint* uncached);
+
+/* send n with the text t, and wait for the reply */
+NotifyError _notification_send_text(Notification n, NotifySession s,
+		const struct _notification_text* t);
+
+struct _notify_queue_entry {
+	Notification n;
+	struct _notification_text text;
+	int urgency;
+	/* charged against the session memory budget */
+	size_t size;
+	/* kept when coalesced */
+	struct timespec queued_at;
+	/* the time-to-live, and the close to be scheduled once sent */
+	int has_deadline;
+	struct timespec deadline;
+	struct _notify_expiry* expiry;
+
+	/* once sent */
+	uint32_t serial;
+	struct timespec sent_at;
+
+	struct _notify_queue_entry* next;
+};
+
+struct _notify_queue {
+	/* zero if disabled */
+	size_t length;
+	int policy;
+	int deadline;
+	int aging;
+
+	/* waiting to be sent, oldest first */
+	struct _notify_queue_entry* pending;
+	size_t pending_count;
+	/* sent, waiting for the reply */
+	struct _notify_queue_entry* in_flight;
+	size_t in_flight_count;
+};
+
+void _notify_queue_init(struct _notify_queue* q);
+/* drop all the entries (e.g. on disconnect) */
+void _notify_queue_clear(NotifySession s);
+
+#define _notify_queue_empty(q) (!(q)->pending && !(q)->in_flight)
+
+/* queue n with the text t (taking it over, even on failure) */
+NotifyError _notify_queue_push(NotifySession s, Notification n,
+		struct _notification_text* t);
+/* send as many pending entries as possible (dropping the ones
+ * which won't be replied) */
+void _notify_queue_pump(NotifySession s);
+/* shorten timeout [ms] to the time the oldest call in flight
+ * is given up on */
+int _notify_queue_timeout(NotifySession s, int timeout);
+/* handle a reply to a queued call; returns zero if it is not one */
+int _notify_queue_handle_reply(NotifySession s,
+		const struct _notify_signal* sig);
+/* drop the pending entries for n, and wait (up to the deadline) for
+ * the reply to its call in flight; returns non-zero if anything
+ * was dropped */
+int _notify_queue_cancel(NotifySession s, Notification n);
+/* drop the pending entries for from, and pass the replies to its calls
+ * in flight over to to (which can be NULL to discard them) */
+void _notify_queue_transfer(NotifySession s, Notification from,
+		Notification to);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_QUEUE__H*/
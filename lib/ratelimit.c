@@ -0,0 +1,222 @@
+/* libtinynotify -- notification rate limiting
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "ratelimit.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "stats_.h"
+#include "utf8_.h"
+#include "ratelimit_.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const NotifyRateLimitPolicy NOTIFY_RATE_LIMIT_REJECT = 0;
+const NotifyRateLimitPolicy NOTIFY_RATE_LIMIT_FOLD = 1;
+
+const unsigned int NOTIFY_SESSION_NO_RATE_LIMIT = 0;
+
+/* the token unit, allowing for sub-millisecond refill */
+#define TOKEN 1000UL
+
+static void _bucket_set(struct _notify_bucket* b,
+		unsigned int rate, unsigned int burst) {
+	b->rate = rate;
+	b->burst = burst ? burst : 1;
+	b->tokens = b->burst * TOKEN;
+	clock_gettime(CLOCK_MONOTONIC, &b->refilled);
+}
+
+static void _bucket_refill(struct _notify_bucket* b,
+		const struct timespec* now) {
+	unsigned long full = b->burst * TOKEN;
+	long long elapsed_ms = (now->tv_sec - b->refilled.tv_sec) * 1000LL
+		+ (now->tv_nsec - b->refilled.tv_nsec) / 1000000;
+
+	if (elapsed_ms <= 0)
+		return;
+
+	/* rate tokens per second is rate token units per millisecond */
+	if (b->tokens >= full
+			|| (unsigned long long) elapsed_ms >= (full - b->tokens) / b->rate + 1) {
+		b->tokens = full;
+		b->refilled = *now;
+		return;
+	}
+
+	b->tokens += elapsed_ms * b->rate;
+	/* keep the remainder of the millisecond */
+	b->refilled.tv_sec += elapsed_ms / 1000;
+	b->refilled.tv_nsec += (elapsed_ms % 1000) * 1000000L;
+	if (b->refilled.tv_nsec >= 1000000000L) {
+		b->refilled.tv_sec++;
+		b->refilled.tv_nsec -= 1000000000L;
+	}
+}
+
+/* NULL or unlimited buckets always have a token */
+static int _bucket_has_token(struct _notify_bucket* b,
+		const struct timespec* now) {
+	if (!b || !b->rate)
+		return 1;
+
+	_bucket_refill(b, now);
+	return b->tokens >= TOKEN;
+}
+
+static void _bucket_take(struct _notify_bucket* b) {
+	if (b && b->rate)
+		b->tokens -= TOKEN;
+}
+
+void notify_session_set_rate_limit(NotifySession s,
+		unsigned int rate, unsigned int burst) {
+	_bucket_set(&s->ratelimit.session, rate, burst);
+}
+
+void notify_session_set_category_rate_limit(NotifySession s,
+		const char* category, unsigned int rate, unsigned int burst) {
+	struct _notify_category_bucket **cp, *c;
+
+	for (cp = &s->ratelimit.categories; *cp; cp = &(*cp)->next) {
+		if (!strcmp((*cp)->category, category))
+			break;
+	}
+
+	if (!rate) {
+		if ((c = *cp)) {
+			*cp = c->next;
+			free(c->category);
+			free(c);
+		}
+		return;
+	}
+
+	if (!*cp) {
+		_mem_assert(c = malloc(sizeof(*c)));
+		c->category = _notify_utf8_strdup(category);
+		c->next = NULL;
+		*cp = c;
+	}
+	_bucket_set(&(*cp)->b, rate, burst);
+}
+
+void notify_session_set_rate_limit_policy(NotifySession s,
+		NotifyRateLimitPolicy policy) {
+	s->ratelimit.policy = policy;
+}
+
+void _notify_ratelimit_init(struct _notify_ratelimit_state* r) {
+	memset(r, 0, sizeof(*r));
+	r->policy = NOTIFY_RATE_LIMIT_REJECT;
+}
+
+void _notify_ratelimit_free(NotifySession s) {
+	struct _notify_ratelimit_state *r = &s->ratelimit;
+	struct _notify_category_bucket *c, *next;
+
+	for (c = r->categories; c; c = next) {
+		next = c->next;
+		free(c->category);
+		free(c);
+	}
+	if (r->summary)
+		notification_free(r->summary);
+}
+
+int _notify_ratelimit_check(NotifySession s, Notification n) {
+	struct _notify_ratelimit_state *r = &s->ratelimit;
+	struct _notify_bucket *cb = NULL;
+	struct timespec now;
+
+	if (!r->session.rate && !r->categories)
+		return 0;
+	if (n == r->summary)
+		return 0;
+
+	if (r->categories) {
+		const char *category = _notification_hints_get_string(n->hints,
+				"category", _notification_hints_get_string(s->default_hints,
+					"category", NULL));
+		struct _notify_category_bucket *c;
+
+		if (category) {
+			for (c = r->categories; c; c = c->next) {
+				if (!strcmp(c->category, category)) {
+					cb = &c->b;
+					break;
+				}
+			}
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (_bucket_has_token(cb, &now) && _bucket_has_token(&r->session, &now)) {
+		_bucket_take(cb);
+		_bucket_take(&r->session);
+		return 0;
+	}
+
+	_stats_inc(s, rate_limited);
+	if (r->policy == NOTIFY_RATE_LIMIT_FOLD) {
+		r->folded++;
+		return 1;
+	}
+
+	notify_session_set_error(s, NOTIFY_ERROR_RATE_LIMITED);
+	return -1;
+}
+
+int _notify_ratelimit_timeout(NotifySession s, int timeout) {
+	struct _notify_ratelimit_state *r = &s->ratelimit;
+	struct timespec now;
+	long remaining;
+
+	if (!r->folded)
+		return timeout;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (_bucket_has_token(&r->session, &now))
+		remaining = 0;
+	else
+		remaining = (TOKEN - r->session.tokens + r->session.rate - 1)
+			/ r->session.rate;
+
+	if (timeout < 0 || remaining < timeout)
+		return remaining;
+	return timeout;
+}
+
+void _notify_ratelimit_run(NotifySession s) {
+	struct _notify_ratelimit_state *r = &s->ratelimit;
+	struct timespec now;
+	unsigned long folded = r->folded;
+
+	/* sending the summary may process events */
+	if (!folded || r->sending_summary)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!_bucket_has_token(&r->session, &now))
+		return;
+	_bucket_take(&r->session);
+
+	if (!r->summary)
+		r->summary = notification_new("%lu notifications were suppressed",
+				NOTIFICATION_NO_BODY);
+
+	r->folded = 0;
+	r->sending_summary = 1;
+	if (notification_update(r->summary, s, folded))
+		r->folded += folded;
+	r->sending_summary = 0;
+}
@@ -0,0 +1,100 @@
+/* libtinynotify -- notification rate limiting
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_RATELIMIT_H
+#define _TINYNOTIFY_RATELIMIT_H
+
+/**
+ * SECTION: NotifyRateLimit
+ * @short_description: API to limit the rate of notifications sent
+ * @include: tinynotify.h
+ *
+ * A #NotifySession can limit the rate at which notifications are sent
+ * (or updated), to protect the notification server from a runaway
+ * component. The limit is a token bucket: it allows a burst of
+ * notifications, and then a steady rate.
+ *
+ * Additionally, separate limits can be set for notification categories
+ * (see notification_set_category()). A notification in such a category
+ * has to fit in both the category and the session limits.
+ *
+ * The notifications exceeding the limit are either rejected with
+ * %NOTIFY_ERROR_RATE_LIMITED, or folded: they are not sent, but counted,
+ * and a single summary notification is sent instead once the limit allows.
+ * Either way, they are counted in #NotifyStats.
+ */
+
+/**
+ * NotifyRateLimitPolicy
+ *
+ * The action taken when a notification exceeds the rate limit.
+ */
+typedef const int NotifyRateLimitPolicy;
+
+/**
+ * NOTIFY_RATE_LIMIT_REJECT
+ *
+ * Reject the notification with %NOTIFY_ERROR_RATE_LIMITED.
+ */
+extern const NotifyRateLimitPolicy NOTIFY_RATE_LIMIT_REJECT;
+
+/**
+ * NOTIFY_RATE_LIMIT_FOLD
+ *
+ * Drop the notification, and report success. A summary notification
+ * stating the number of notifications dropped is sent by
+ * notify_session_dispatch() once the session limit allows; it is updated
+ * in place when it is sent again.
+ */
+extern const NotifyRateLimitPolicy NOTIFY_RATE_LIMIT_FOLD;
+
+/**
+ * NOTIFY_SESSION_NO_RATE_LIMIT
+ *
+ * A rate disabling the limit.
+ */
+extern const unsigned int NOTIFY_SESSION_NO_RATE_LIMIT;
+
+/**
+ * notify_session_set_rate_limit
+ * @session: session to operate on
+ * @rate: the number of notifications allowed per second,
+ *	or %NOTIFY_SESSION_NO_RATE_LIMIT
+ * @burst: the number of notifications which can be sent at once
+ *	(at least one)
+ *
+ * Set the rate limit for all the notifications sent through @session.
+ * By default, there is no limit.
+ */
+void notify_session_set_rate_limit(NotifySession session,
+		unsigned int rate, unsigned int burst);
+
+/**
+ * notify_session_set_category_rate_limit
+ * @session: session to operate on
+ * @category: the notification category
+ * @rate: the number of notifications allowed per second,
+ *	or %NOTIFY_SESSION_NO_RATE_LIMIT
+ * @burst: the number of notifications which can be sent at once
+ *	(at least one)
+ *
+ * Set an additional rate limit for the notifications in @category.
+ */
+void notify_session_set_category_rate_limit(NotifySession session,
+		const char* category, unsigned int rate, unsigned int burst);
+
+/**
+ * notify_session_set_rate_limit_policy
+ * @session: session to operate on
+ * @policy: the action taken when a notification exceeds the limit
+ *
+ * Set the action taken when a notification exceeds the rate limit.
+ * The default is %NOTIFY_RATE_LIMIT_REJECT.
+ */
+void notify_session_set_rate_limit_policy(NotifySession session,
+		NotifyRateLimitPolicy policy);
+
+#endif /*_TINYNOTIFY_RATELIMIT_H*/
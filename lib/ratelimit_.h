@@ -0,0 +1,59 @@
+/* libtinynotify -- notification rate limiting
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_RATELIMIT__H
+#define _TINYNOTIFY_RATELIMIT__H
+
+#include <time.h>
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notify_bucket {
+	/* tokens per second, zero if unlimited */
+	unsigned int rate;
+	unsigned int burst;
+
+	/* in 1/1000 of a token */
+	unsigned long tokens;
+	struct timespec refilled;
+};
+
+struct _notify_category_bucket {
+	char* category;
+	struct _notify_bucket b;
+
+	struct _notify_category_bucket* next;
+};
+
+struct _notify_ratelimit_state {
+	struct _notify_bucket session;
+	struct _notify_category_bucket* categories;
+	int policy;
+
+	/* the notifications folded since the last summary */
+	unsigned long folded;
+	Notification summary;
+	int sending_summary;
+};
+
+void _notify_ratelimit_init(struct _notify_ratelimit_state* r);
+void _notify_ratelimit_free(NotifySession s);
+
+/* take a token for n; returns 0 if it can be sent, 1 if it was folded,
+ * or -1 if it was rejected (with the session error set) */
+int _notify_ratelimit_check(NotifySession s, Notification n);
+/* shorten timeout [ms] to the time the summary can be sent */
+int _notify_ratelimit_timeout(NotifySession s, int timeout);
+/* send the summary of the folded notifications, if the limit allows */
+void _notify_ratelimit_run(NotifySession s);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_RATELIMIT__H*/
@@ -0,0 +1,224 @@
+/* libtinynotify -- registry of keyed notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "registry.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "memory_.h"
+#include "queue_.h"
+#include "registry_.h"
+#include "state_.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* must be a power of two */
+#define REGISTRY_MIN_BUCKETS 16
+
+#define FNV32_OFFSET 0x811c9dc5U
+#define FNV32_PRIME 0x01000193U
+
+/* FNV-1a */
+uint32_t _notify_registry_hash(const char* key) {
+	uint32_t h = FNV32_OFFSET;
+
+	for (; *key; key++) {
+		h ^= (unsigned char) *key;
+		h *= FNV32_PRIME;
+	}
+	return h;
+}
+
+void _notify_registry_init(struct _notify_registry* r) {
+	memset(r, 0, sizeof(*r));
+}
+
+static struct _notify_registry_entry** _registry_find(
+		struct _notify_registry* r, const char* key, uint32_t hash) {
+	struct _notify_registry_entry **ep;
+
+	if (!r->bucket_count)
+		return NULL;
+
+	for (ep = &r->buckets[hash & (r->bucket_count - 1)]; *ep;
+			ep = &(*ep)->next) {
+		if ((*ep)->hash == hash && !strcmp((*ep)->key, key))
+			return ep;
+	}
+
+	return NULL;
+}
+
+/* keep the load factor below 3/4; on failure, the old table is kept
+ * (only failing if there is none) */
+static NotifyError _registry_grow(NotifySession s) {
+	struct _notify_registry* r = &s->registry;
+	struct _notify_registry_entry **buckets, *e, *next;
+	size_t new_count, i;
+	NotifyError ret;
+
+	if (r->count < r->bucket_count / 4 * 3)
+		return NOTIFY_ERROR_NO_ERROR;
+
+	new_count = r->bucket_count ? r->bucket_count * 2 : REGISTRY_MIN_BUCKETS;
+	if (r->bucket_count) {
+		if (_notify_mem_charge(s, new_count * sizeof(*buckets)))
+			return NOTIFY_ERROR_NO_ERROR;
+	} else if ((ret = _notify_session_charge(s, new_count * sizeof(*buckets))))
+		return ret;
+
+	if (!(buckets = calloc(new_count, sizeof(*buckets)))) {
+		_notify_mem_release(s, new_count * sizeof(*buckets));
+		return r->bucket_count ? NOTIFY_ERROR_NO_ERROR
+			: _notify_session_out_of_memory(s);
+	}
+
+	for (i = 0; i < r->bucket_count; i++) {
+		for (e = r->buckets[i]; e; e = next) {
+			struct _notify_registry_entry **bucket
+				= &buckets[e->hash & (new_count - 1)];
+
+			next = e->next;
+			e->next = *bucket;
+			*bucket = e;
+		}
+	}
+
+	free(r->buckets);
+	_notify_mem_release(s, r->bucket_count * sizeof(*buckets));
+	r->buckets = buckets;
+	r->bucket_count = new_count;
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+/* drop the notification from everything referencing it, and free it */
+static void _registry_free_notification(NotifySession s, Notification n,
+		Notification successor) {
+	_notify_queue_transfer(s, n, successor);
+	_notify_session_remove_notification(s, n);
+	n->registry_key = NULL;
+	notification_free(n);
+}
+
+static void _registry_entry_free(NotifySession s,
+		struct _notify_registry_entry* e) {
+	_notify_mem_release(s, sizeof(*e) + strlen(e->key) + 1);
+	free(e->key);
+	free(e);
+}
+
+NotifyError notify_session_register(NotifySession s, const char* key,
+		Notification n) {
+	struct _notify_registry* r = &s->registry;
+	struct _notify_registry_entry **ep, *e;
+	uint32_t hash = _notify_registry_hash(key);
+	size_t size;
+	NotifyError ret;
+
+	if ((ep = _registry_find(r, key, hash))) {
+		Notification old = (*ep)->n;
+
+		if (old == n)
+			return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+		assert(!n->registry_key);
+
+		n->message_id = old->message_id;
+		n->registry_key = (*ep)->key;
+		(*ep)->n = n;
+		_registry_free_notification(s, old, n);
+		return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+	}
+	assert(!n->registry_key);
+
+	if ((ret = _registry_grow(s)))
+		return ret;
+
+	size = sizeof(*e) + strlen(key) + 1;
+	if ((ret = _notify_session_charge(s, size)))
+		return ret;
+	if (!(e = malloc(sizeof(*e))) || !(e->key = strdup(key))) {
+		free(e);
+		_notify_mem_release(s, size);
+		return _notify_session_out_of_memory(s);
+	}
+
+	e->hash = hash;
+	e->n = n;
+	ep = &r->buckets[hash & (r->bucket_count - 1)];
+	e->next = *ep;
+	*ep = e;
+	r->count++;
+
+	n->registry_key = e->key;
+	return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+}
+
+Notification notify_session_lookup(NotifySession s, const char* key) {
+	struct _notify_registry_entry **ep
+		= _registry_find(&s->registry, key, _notify_registry_hash(key));
+
+	return ep ? (*ep)->n : NULL;
+}
+
+int _notify_registry_release(NotifySession s, Notification n) {
+	struct _notify_registry* r = &s->registry;
+	struct _notify_registry_entry **ep, *e;
+
+	if (!n->registry_key)
+		return 0;
+
+	ep = _registry_find(r, n->registry_key,
+			_notify_registry_hash(n->registry_key));
+	assert(ep && (*ep)->n == n);
+	e = *ep;
+	*ep = e->next;
+	r->count--;
+
+	n->registry_key = NULL;
+	_registry_entry_free(s, e);
+	return 1;
+}
+
+void notify_session_unregister(NotifySession s, const char* key) {
+	struct _notify_registry* r = &s->registry;
+	struct _notify_registry_entry **ep, *e;
+
+	if (!(ep = _registry_find(r, key, _notify_registry_hash(key))))
+		return;
+
+	e = *ep;
+	*ep = e->next;
+	r->count--;
+
+	_notify_state_forget(s, e->key);
+	_registry_free_notification(s, e->n, NULL);
+	_registry_entry_free(s, e);
+}
+
+void _notify_registry_free(NotifySession s) {
+	struct _notify_registry* r = &s->registry;
+	struct _notify_registry_entry *e, *next;
+	size_t i;
+
+	for (i = 0; i < r->bucket_count; i++) {
+		for (e = r->buckets[i]; e; e = next) {
+			next = e->next;
+			_registry_free_notification(s, e->n, NULL);
+			_registry_entry_free(s, e);
+		}
+	}
+
+	free(r->buckets);
+	_notify_mem_release(s, r->bucket_count * sizeof(*r->buckets));
+	_notify_registry_init(r);
+}
@@ -0,0 +1,79 @@
+/* libtinynotify -- registry of keyed notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_REGISTRY_H
+#define _TINYNOTIFY_REGISTRY_H
+
+/**
+ * SECTION: NotifyRegistry
+ * @short_description: API to address notifications by application keys
+ * @include: tinynotify.h
+ *
+ * A #Notification can be registered in a #NotifySession under a key
+ * chosen by the application (e.g. 'mail:inbox'). Then, it can be looked up
+ * by the key from anywhere in the program, without keeping the pointer.
+ *
+ * Registering another notification under the same key replaces the previous
+ * one. The new notification takes over the ID of the previous one,
+ * and notification_send() doesn't reset the ID of a registered
+ * notification. This way, sending a notification under a key which is
+ * in use updates the existing notification instead of showing a new one.
+ *
+ * The registered notifications are owned by the session; they are freed
+ * when replaced, unregistered, or when the session is freed. Their IDs
+ * can be kept across restarts of the program using
+ * notify_session_set_state_file().
+ *
+ * A registered notification is unregistered when it is closed (by
+ * the server, by notification_close() or by disconnecting), before its
+ * close callback is called. The callback takes over the notification then
+ * (e.g. %NOTIFICATION_FREE_ON_CLOSE frees it); without a close callback,
+ * it is freed by the session.
+ */
+
+/**
+ * notify_session_register
+ * @session: session to operate on
+ * @key: the key to register the notification under
+ * @notification: the notification to register
+ *
+ * Register @notification in @session under @key, transferring its ownership
+ * to @session. If another notification is registered under @key, it is
+ * freed, and @notification takes over its ID (and its pending reply,
+ * if it is still being sent). The notification must not be registered
+ * under another key.
+ *
+ * On failure, @notification is not registered, and it is still owned
+ * by the caller.
+ *
+ * Returns: a positive #NotifyError or %NOTIFY_ERROR_NO_ERROR
+ */
+NotifyError notify_session_register(NotifySession session, const char* key,
+		Notification notification);
+
+/**
+ * notify_session_lookup
+ * @session: session to operate on
+ * @key: the key to look up
+ *
+ * Find the notification registered in @session under @key.
+ *
+ * Returns: the notification (owned by @session), or NULL if none
+ */
+Notification notify_session_lookup(NotifySession session, const char* key);
+
+/**
+ * notify_session_unregister
+ * @session: session to operate on
+ * @key: the key to unregister
+ *
+ * Unregister and free the notification registered under @key, if any.
+ * The notification is not closed; use notification_close() first
+ * if necessary.
+ */
+void notify_session_unregister(NotifySession session, const char* key);
+
+#endif /*_TINYNOTIFY_REGISTRY_H*/
@@ -0,0 +1,45 @@
+/* libtinynotify -- registry of keyed notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_REGISTRY__H
+#define _TINYNOTIFY_REGISTRY__H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "session.h"
+#include "notification.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notify_registry_entry {
+	char* key;
+	uint32_t hash;
+	Notification n;
+
+	struct _notify_registry_entry* next;
+};
+
+struct _notify_registry {
+	/* the number of buckets is a power of two, or zero */
+	struct _notify_registry_entry** buckets;
+	size_t bucket_count;
+	size_t count;
+};
+
+/* FNV-1a of the key */
+uint32_t _notify_registry_hash(const char* key);
+
+void _notify_registry_init(struct _notify_registry* r);
+void _notify_registry_free(NotifySession s);
+
+/* unregister n (if registered) without freeing it, e.g. because it was
+ * closed; returns non-zero if it was registered */
+int _notify_registry_release(NotifySession s, Notification n);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_REGISTRY__H*/
@@ -9,11 +9,21 @@
 #include "session.h"
 #include "notification.h"
 #include "event.h"
+#include "timing.h"
+#include "stats.h"
+#include "transport.h"
 
 #include "common_.h"
 #include "session_.h"
 #include "notification_.h"
+#include "image_.h"
 #include "event_.h"
+#include "timing_.h"
+#include "stats_.h"
+#include "memory_.h"
+#include "queue_.h"
+#include "transport_.h"
+#include "probes_.h"
 
 #include <stdlib.h>
 #include <stdarg.h>
@@ -28,42 +38,63 @@
 const char* const NOTIFY_SESSION_NO_APP_NAME = NULL;
 const char* const NOTIFY_SESSION_NO_APP_ICON = NULL;
 
-void _notify_session_add_notification(NotifySession s, Notification n) {
+/* (re)start the client-side expiry of a tracked notification */
+static void _notify_session_arm_tracking(NotifySession s,
+		struct _notification_list* nl) {
+	int timeout = nl->n->expire_timeout;
+
+	if (s->tracking_grace < 0)
+		return;
+
+	if (timeout == NOTIFICATION_DEFAULT_EXPIRE_TIMEOUT)
+		timeout = s->tracking_timeout;
+	if (timeout == NOTIFICATION_NO_EXPIRE_TIMEOUT)
+		_notify_wheel_remove(&s->tracking, &nl->timer);
+	else
+		_notify_wheel_add(&s->tracking, &nl->timer,
+				timeout + s->tracking_grace);
+}
+
+int _notify_session_add_notification(NotifySession s, Notification n) {
 	struct _notification_list *nl;
 
 	/* add the notification only when actually useful */
 	if (!n->close_callback && !n->actions) {
 		/* XXX: drop it from list if already there */
-		return;
+		return 0;
 	}
 
 	for (nl = s->notifications; nl; nl = nl->next) {
 		/* XXX: maybe we should send some kind of close(reason = replaced)? */
-		if (nl->n == n)
-			return;
+		if (nl->n == n) {
+			/* the update restarts the expiration */
+			_notify_session_arm_tracking(s, nl);
+			return 0;
+		}
 	}
 
-	if (!s->notifications) { /* add the filter */
-		DBusError err;
-
-		dbus_error_init(&err);
-		dbus_bus_add_match(s->conn, "type='signal',"
-				"interface='org.freedesktop.Notifications',"
-				"member='NotificationClosed'", &err);
-		_mem_assert(!dbus_error_is_set(&err));
-		dbus_bus_add_match(s->conn, "type='signal',"
-				"interface='org.freedesktop.Notifications',"
-				"member='ActionInvoked'", &err);
-		_mem_assert(!dbus_error_is_set(&err));
+	/* add the filter; the events wouldn't arrive without it */
+	if (!s->notifications && s->transport->watch_signals(s))
+		return -1;
+
+	if (_notify_session_charge(s, sizeof(*nl)))
+		return -1;
+	if (!(nl = malloc(sizeof(*nl)))) {
+		_notify_mem_release(s, sizeof(*nl));
+		_notify_session_out_of_memory(s);
+		return -1;
 	}
 
-	_mem_assert(nl = malloc(sizeof(*nl)));
 	nl->n = n;
 	nl->next = s->notifications;
 	s->notifications = nl;
+	_notify_timer_init(&nl->timer);
+	_notify_session_arm_tracking(s, nl);
+	_stats_inc(s, tracked);
+	return 1;
 }
 
-void _notify_session_remove_notification(NotifySession s, Notification n) {
+int _notify_session_remove_notification(NotifySession s, Notification n) {
 	struct _notification_list **prev;
 
 	for (prev = &s->notifications; *prev; prev = &(*prev)->next) {
@@ -71,23 +102,77 @@ void _notify_session_remove_notification(NotifySession s, Notification n) {
 
 		if (n_l->n == n) {
 			*prev = n_l->next;
+			_notify_wheel_remove(&s->tracking, &n_l->timer);
 			free(n_l);
-			return;
+			_notify_mem_release(s, sizeof(*n_l));
+			_stats_dec(s, tracked);
+			return 1;
 		}
 	}
 
-	assert(!"reached if _notify_session_remove_notification() fails to find the notification");
+	return 0;
+}
+
+void _notify_session_defer_closed(NotifySession s, Notification n) {
+	Notification *np;
+
+	assert(!n->close_pending);
+	for (np = &s->closing; *np; np = &(*np)->close_next);
+	*np = n;
+	n->close_next = NULL;
+	n->close_pending = s;
+}
+
+void _notify_session_cancel_closed(Notification n) {
+	Notification *np;
+
+	if (!n->close_pending)
+		return;
+
+	for (np = &n->close_pending->closing; *np != n; np = &(*np)->close_next);
+	*np = n->close_next;
+	n->close_pending = NULL;
+}
+
+void _notify_session_emit_closed(NotifySession s) {
+	Notification n;
+
+	/* the callbacks may close more notifications */
+	while ((n = s->closing)) {
+		s->closing = n->close_next;
+		n->close_pending = NULL;
+		_emit_closed(s, n, NOTIFICATION_CLOSED_BY_CALLER);
+	}
 }
 
 NotifySession notify_session_new(const char* app_name, const char* app_icon) {
 	NotifySession s;
 
 	_mem_assert(s = malloc(sizeof(*s)));
-	s->conn = NULL;
+	s->transport = NOTIFY_TRANSPORT_DBUS;
+	s->transport_data = NULL;
+	s->peer_to_peer = 0;
 	s->app_name = NULL;
 	s->app_icon = NULL;
+	s->default_hints = NULL;
+	_notify_image_cache_init(&s->image_cache);
 	s->error_details = NULL;
 	s->notifications = NULL;
+	s->closing = NULL;
+	_notify_wheel_init(&s->tracking);
+	s->tracking_timeout = NOTIFY_SESSION_DEFAULT_SERVER_EXPIRE_TIMEOUT;
+	s->tracking_grace = NOTIFY_SESSION_NO_EXPIRY_TRACKING;
+	_notify_queue_init(&s->queue);
+	s->expiries = NULL;
+	_notify_ratelimit_init(&s->ratelimit);
+	_notify_aggregate_init(&s->aggregate);
+	_notify_dedup_init(&s->dedup);
+	_notify_registry_init(&s->registry);
+	_notify_state_init(&s->state);
+	_notify_spool_init(&s->spool);
+	memset(&s->timing, 0, sizeof(s->timing));
+	memset(&s->stats, 0, sizeof(s->stats));
+	memset(&s->mem, 0, sizeof(s->mem));
 
 	notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
 	notify_session_set_app_name(s, app_name);
@@ -97,12 +182,21 @@ NotifySession notify_session_new(const char* app_name, const char* app_icon) {
 
 void notify_session_free(NotifySession s) {
 	notify_session_disconnect(s);
+	_notify_registry_free(s);
+	_notify_state_free(s);
+	_notify_spool_free(s);
 	assert(!s->notifications);
+	_notify_stats_free(s);
+	_notify_ratelimit_free(s);
+	_notify_aggregate_free(s);
+	_notify_dedup_free(s);
 
 	if (s->error_details)
 		free(s->error_details);
 	free(s->app_name);
 	free(s->app_icon);
+	_notification_hints_free(&s->default_hints);
+	_notify_image_cache_clear(&s->image_cache);
 	free(s);
 }
 
@@ -111,6 +205,9 @@ NotifyError notify_session_get_error(NotifySession s) {
 }
 
 const char* notify_session_get_error_message(NotifySession s) {
+	/* formatting the message could have failed with recoverable OOM */
+	if (!s->error_details)
+		return s->error ? s->error->message : "No error";
 	return s->error_details;
 }
 
@@ -122,53 +219,57 @@ NotifyError notify_session_set_error(NotifySession s, NotifyError new_error, ...
 		free(s->error_details);
 	s->error = new_error;
 	if (!new_error)
-		_mem_assert(s->error_details = strdup("No error"));
+		s->error_details = strdup("No error");
 	else {
 		va_start(ap, new_error);
-		_mem_assert(vasprintf(&s->error_details, new_error->message, ap) != -1);
+		if (vasprintf(&s->error_details, new_error->message, ap) == -1)
+			s->error_details = NULL;
 		va_end(ap);
 	}
+	_mem_check(s->error_details || s->mem.recoverable);
 
 	return new_error;
 }
 
 NotifyError notify_session_connect(NotifySession s) {
-	if (s->conn && !dbus_connection_get_is_connected(s->conn))
+	if (s->transport_data && !s->transport->is_connected(s))
 		notify_session_disconnect(s);
 
-	if (!s->conn) {
-		DBusError err;
-
-		dbus_error_init(&err);
-		s->conn = dbus_bus_get_private(DBUS_BUS_SESSION, &err);
+	if (!s->transport_data) {
+		NotifyError ret = s->transport->connect(s);
 
-		assert(!s->conn == dbus_error_is_set(&err));
-		if (!s->conn) {
-			char *err_msg = strdup(err.message);
-			dbus_error_free(&err);
-			return notify_session_set_error(s, NOTIFY_ERROR_DBUS_CONNECT, err_msg);
-		} else
-			dbus_connection_set_exit_on_disconnect(s->conn, FALSE);
+		_probe(connect, s, !ret);
+		if (ret)
+			return ret;
+		_notify_state_connected(s);
 	}
 
 	return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
 }
 
 void notify_session_disconnect(NotifySession s) {
-	if (s->conn) {
+	if (s->transport_data) {
 		struct _notification_list *nl;
 		struct _notification_list *next;
 
+		/* the replies to the calls in flight are lost */
+		_notify_queue_clear(s);
+		_notify_expiry_clear(s);
+		_notify_session_emit_closed(s);
+
 		for (nl = s->notifications; nl; nl = next) {
 			next = nl->next;
-			_emit_closed(nl->n, NOTIFICATION_CLOSED_BY_DISCONNECT);
+			_emit_closed(s, nl->n, NOTIFICATION_CLOSED_BY_DISCONNECT);
 			free(nl);
+			_notify_mem_release(s, sizeof(*nl));
 		}
 		s->notifications = NULL;
+		_notify_wheel_init(&s->tracking);
+		s->stats.counters.tracked = 0;
+		_stats_publish(s);
+		s->state.valid = 0;
 
-		dbus_connection_close(s->conn);
-		dbus_connection_unref(s->conn);
-		s->conn = NULL;
+		s->transport->disconnect(s);
 	}
 
 	notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
@@ -176,6 +277,12 @@ void notify_session_disconnect(NotifySession s) {
 
 void notify_session_set_app_name(NotifySession s, const char* app_name) {
 	_property_assign_str(&s->app_name, app_name);
+	if (s->stats.shm) {
+		memset(s->stats.shm->app_name, 0, sizeof(s->stats.shm->app_name));
+		if (app_name)
+			strncpy(s->stats.shm->app_name, app_name,
+					sizeof(s->stats.shm->app_name) - 1);
+	}
 }
 
 void notify_session_set_app_icon(NotifySession s, const char* app_icon) {
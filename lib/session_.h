@@ -7,35 +7,91 @@
 #ifndef _TINYNOTIFY_SESSION__H
 #define _TINYNOTIFY_SESSION__H
 
-#include <dbus/dbus.h>
-
 #include "error.h"
 #include "session.h"
 #include "notification.h"
+#include "timing.h"
+#include "stats.h"
+#include "transport.h"
+
+#include "notification_.h"
+#include "image_.h"
+#include "timing_.h"
+#include "stats_.h"
+#include "memory_.h"
+#include "queue_.h"
+#include "expiry_.h"
+#include "ratelimit_.h"
+#include "aggregate_.h"
+#include "dedup_.h"
+#include "timerwheel_.h"
+#include "registry_.h"
+#include "state_.h"
+#include "spool_.h"
 
 /*<private_header>*/
 #pragma GCC visibility push(hidden)
 
 struct _notification_list {
+	/* the client-side expiry; must be the first member */
+	struct _notify_timer timer;
+
 	Notification n;
 	struct _notification_list* next;
 };
 
 struct _notify_session {
-	DBusConnection *conn;
+	NotifyTransport transport;
+	void* transport_data;
+	int peer_to_peer;
 
 	char* app_name;
 	char* app_icon;
+	struct _notification_hint* default_hints;
+	struct _notify_image_cache image_cache;
 
 	NotifyError error;
 	char* error_details;
 
 	/* notifications with event callbacks */
 	struct _notification_list* notifications;
+	/* the ones closed by notification_close(), with the close event
+	 * yet to be emitted */
+	Notification closing;
+	/* evicting them if the server doesn't report them closed;
+	 * disabled if grace is negative */
+	struct _notify_timer_wheel tracking;
+	int tracking_timeout;
+	int tracking_grace;
+	struct _notify_queue queue;
+	/* notifications to be closed, soonest first */
+	struct _notify_expiry* expiries;
+	struct _notify_ratelimit_state ratelimit;
+	struct _notify_aggregate_state aggregate;
+	struct _notify_dedup_state dedup;
+	/* notifications owned by the session, by the application keys */
+	struct _notify_registry registry;
+	/* their IDs, kept across restarts */
+	struct _notify_state state;
+	/* notifications kept while the server is unavailable */
+	struct _notify_spool spool;
+
+	struct _notify_timing_state timing;
+	struct _notify_stats_state stats;
+	struct _notify_mem_state mem;
 };
 
-void _notify_session_add_notification(NotifySession s, Notification n);
-void _notify_session_remove_notification(NotifySession s, Notification n);
+/* returns 1 if n was added, 0 if it doesn't need tracking or is tracked
+ * already, -1 (with the session error set) on failure */
+int _notify_session_add_notification(NotifySession s, Notification n);
+int _notify_session_remove_notification(NotifySession s, Notification n);
+
+/* emit the close event of n from the next notify_session_dispatch() */
+void _notify_session_defer_closed(NotifySession s, Notification n);
+/* drop the pending close event of n, if any */
+void _notify_session_cancel_closed(Notification n);
+/* emit the pending close events */
+void _notify_session_emit_closed(NotifySession s);
 
 #pragma GCC visibility pop
 #endif /*_TINYNOTIFY_SESSION__H*/
@@ -0,0 +1,42 @@
+/* libtinynotify -- shared memory statistics segment layout
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_SHMSTATS__H
+#define _TINYNOTIFY_SHMSTATS__H
+
+#include <stdint.h>
+
+/*<private_header>*/
+
+/* This header is shared between the library and tinynotify-top. Bump
+ * the version whenever the layout changes. */
+
+#define NOTIFY_SHM_PREFIX "tinynotify-"
+#define NOTIFY_SHM_MAGIC 0x54534e54U /* 'TNST' */
+#define NOTIFY_SHM_VERSION 1
+
+struct _notify_shm_stats {
+	uint32_t magic;
+	uint32_t version;
+	int32_t pid;
+	uint32_t reserved;
+	char app_name[64];
+
+	/* updated with atomic stores, read with atomic loads */
+	uint64_t sent;
+	uint64_t closed;
+	uint64_t failed;
+	uint64_t in_flight;
+	uint64_t tracked;
+	uint64_t latency_ns;
+};
+
+#define _shm_store(field, val) \
+	__atomic_store_n(&(field), (uint64_t) (val), __ATOMIC_RELAXED)
+#define _shm_load(field) \
+	__atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+#endif /*_TINYNOTIFY_SHMSTATS__H*/
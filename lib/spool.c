@@ -0,0 +1,439 @@
+/* libtinynotify -- disk spool for undeliverable notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "spool.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "timing_.h"
+#include "stats_.h"
+#include "queue_.h"
+#include "dedup_.h"
+#include "transport_.h"
+#include "spool_.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Bump the version whenever the layout changes. */
+#define SPOOL_MAGIC 0x50534e54U /* 'TNSP' */
+#define SPOOL_VERSION 1
+
+#define SPOOL_ALIGN(x) (((x) + 7) & ~(size_t) 7)
+
+const size_t NOTIFY_SESSION_DEFAULT_SPOOL_SIZE = 0;
+const int NOTIFY_SESSION_DEFAULT_SPOOL_TTL = -2;
+
+#define DEFAULT_SPOOL_SIZE (64 * 1024)
+/* 1 day */
+#define DEFAULT_SPOOL_TTL (24 * 60 * 60 * 1000)
+
+/* The records are appended at the tail, and replayed from the head.
+ * When the end of the file is reached, they are moved back to the start. */
+struct _notify_spool_file {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;
+	/* offsets of the oldest record, and past the newest one */
+	uint64_t head;
+	uint64_t tail;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct _notify_spool_record {
+	/* the whole record, aligned */
+	uint32_t size;
+	uint32_t summary_len;
+	uint32_t body_len;
+	uint16_t app_icon_len;
+	uint16_t category_len;
+	int32_t expire_timeout;
+	uint8_t urgency;
+	uint8_t reserved[3];
+	/* CLOCK_REALTIME [ms], to survive reboots */
+	int64_t spooled_at;
+	/* of the contents, to find repeats */
+	uint64_t hash;
+
+	/* followed by the NUL-terminated summary, body, app_icon
+	 * and category */
+};
+
+#define SPOOL_DATA_START SPOOL_ALIGN(sizeof(struct _notify_spool_file))
+
+#define _spool_record(f, offset) \
+	((struct _notify_spool_record*) ((char*) (f) + (offset)))
+
+void _notify_spool_init(struct _notify_spool* sp) {
+	sp->map = NULL;
+	sp->fd = -1;
+	sp->size = 0;
+	sp->ttl = DEFAULT_SPOOL_TTL;
+	sp->replaying = 0;
+}
+
+void _notify_spool_free(NotifySession s) {
+	if (s->spool.map)
+		munmap(s->spool.map, s->spool.size);
+	if (s->spool.fd != -1)
+		close(s->spool.fd);
+	_notify_spool_init(&s->spool);
+}
+
+static int64_t _spool_now(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void _spool_reset(struct _notify_spool_file* f, size_t size) {
+	f->version = SPOOL_VERSION;
+	f->size = size;
+	f->head = f->tail = SPOOL_DATA_START;
+	f->count = 0;
+	f->reserved = 0;
+	f->magic = SPOOL_MAGIC;
+}
+
+/* returns zero if the file can't be used as-is */
+static int _spool_check(struct _notify_spool_file* f, size_t size) {
+	uint64_t offset;
+	uint32_t count = 0;
+
+	if (f->magic != SPOOL_MAGIC || f->version != SPOOL_VERSION
+			|| f->size != size || f->head < SPOOL_DATA_START
+			|| f->head > f->tail || f->tail > size)
+		return 0;
+
+	for (offset = f->head; offset < f->tail; count++) {
+		struct _notify_spool_record *r = _spool_record(f, offset);
+		size_t min_size;
+
+		if (f->tail - offset < sizeof(*r) || r->size > f->tail - offset)
+			return 0;
+		min_size = sizeof(*r) + r->summary_len + r->body_len
+			+ r->app_icon_len + r->category_len + 4;
+		if (r->size < min_size || r->size != SPOOL_ALIGN(r->size))
+			return 0;
+		offset += r->size;
+	}
+
+	return count == f->count;
+}
+
+/* copy the newest records of the spool file of old_size which fit
+ * in a file of size; returns -1 on failure, and 0 leaving *data NULL
+ * if there are none (or the file is invalid) */
+static int _spool_save(int fd, size_t old_size, size_t size,
+		char** data, size_t* len, uint32_t* count) {
+	struct _notify_spool_file *f;
+	uint64_t offset;
+	uint32_t left;
+
+	f = mmap(NULL, old_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (f == MAP_FAILED)
+		return -1;
+
+	if (_spool_check(f, old_size)) {
+		offset = f->head;
+		left = f->count;
+		while (f->tail - offset > size - SPOOL_DATA_START) {
+			offset += _spool_record(f, offset)->size;
+			left--;
+		}
+
+		*len = f->tail - offset;
+		if (*len && !(*data = malloc(*len))) {
+			munmap(f, old_size);
+			errno = ENOMEM;
+			return -1;
+		}
+		if (*len)
+			memcpy(*data, _spool_record(f, offset), *len);
+		*count = left;
+	}
+
+	munmap(f, old_size);
+	return 0;
+}
+
+NotifyError notify_session_set_spool(NotifySession s, const char* path,
+		size_t size, int ttl) {
+	struct _notify_spool_file *f;
+	struct stat st;
+	char *saved = NULL;
+	size_t saved_len = 0;
+	uint32_t saved_count = 0, magic;
+	int fd, saved_errno;
+
+	_notify_spool_free(s);
+	if (!path)
+		return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+	if (size == NOTIFY_SESSION_DEFAULT_SPOOL_SIZE)
+		size = DEFAULT_SPOOL_SIZE;
+	if (size < SPOOL_DATA_START)
+		size = SPOOL_DATA_START;
+	if (ttl == NOTIFY_SESSION_DEFAULT_SPOOL_TTL)
+		ttl = DEFAULT_SPOOL_TTL;
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd == -1)
+		return notify_session_set_error(s, NOTIFY_ERROR_SPOOL_FILE,
+				strerror(errno));
+	/* the records would be replayed (and overwritten) twice */
+	if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+		saved_errno = errno;
+		close(fd);
+		return notify_session_set_error(s, NOTIFY_ERROR_SPOOL_FILE,
+				saved_errno == EWOULDBLOCK
+				? "the file is in use by another process"
+				: strerror(saved_errno));
+	}
+	if (fstat(fd, &st) == -1)
+		goto fail;
+	if (st.st_size && (pread(fd, &magic, sizeof(magic), 0)
+				!= (ssize_t) sizeof(magic) || magic != SPOOL_MAGIC)) {
+		close(fd);
+		return notify_session_set_error(s, NOTIFY_ERROR_SPOOL_FILE,
+				"not a spool file");
+	}
+	if (st.st_size != (off_t) size) {
+		/* keep the records when only the size changes */
+		if ((st.st_size && _spool_save(fd, st.st_size, size,
+						&saved, &saved_len, &saved_count))
+				|| ftruncate(fd, size) == -1)
+			goto fail;
+	}
+	if ((f = mmap(NULL, size, PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, 0)) == MAP_FAILED)
+		goto fail;
+
+	if (saved) {
+		_spool_reset(f, size);
+		memcpy(_spool_record(f, SPOOL_DATA_START), saved, saved_len);
+		f->tail += saved_len;
+		f->count = saved_count;
+		free(saved);
+	} else if (!_spool_check(f, size))
+		_spool_reset(f, size);
+
+	s->spool.map = f;
+	s->spool.fd = fd;
+	s->spool.size = size;
+	s->spool.ttl = ttl;
+	return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+
+fail:
+	saved_errno = errno;
+	free(saved);
+	close(fd);
+	return notify_session_set_error(s, NOTIFY_ERROR_SPOOL_FILE,
+			strerror(saved_errno));
+}
+
+static void _spool_drop_head(NotifySession s) {
+	struct _notify_spool_file *f = s->spool.map;
+
+	f->head += _spool_record(f, f->head)->size;
+	if (!--f->count)
+		f->head = f->tail = SPOOL_DATA_START;
+}
+
+/* find the space for a record of size (which fits in the file)
+ * at the tail, dropping the oldest records if necessary */
+static void _spool_make_room(NotifySession s, size_t size) {
+	struct _notify_spool_file *f = s->spool.map;
+
+	while (f->tail + size > s->spool.size) {
+		if (f->head > SPOOL_DATA_START) {
+			memmove(_spool_record(f, SPOOL_DATA_START),
+					_spool_record(f, f->head), f->tail - f->head);
+			f->tail -= f->head - SPOOL_DATA_START;
+			f->head = SPOOL_DATA_START;
+		} else {
+			_spool_drop_head(s);
+			_stats_inc(s, spool_dropped);
+		}
+	}
+}
+
+static char* _spool_append_str(char* p, const char* str, size_t len) {
+	memcpy(p, str, len);
+	p[len] = 0;
+	return p + len + 1;
+}
+
+NotifyError _notify_spool_failed(NotifySession s, Notification n,
+		const struct _notification_text* t, NotifyError err) {
+	struct _notify_spool_file *f = s->spool.map;
+	struct _notify_spool_record r, *rp;
+	const char *app_icon, *category;
+	uint64_t offset;
+	size_t size;
+	char *p;
+
+	/* only the notifications lost because the server is unavailable;
+	 * the ones it rejected would be rejected again */
+	if (!f || s->spool.replaying || n->message_id
+			|| (err != NOTIFY_ERROR_DBUS_CONNECT && err != NOTIFY_ERROR_NO_SERVER))
+		return err;
+
+	app_icon = n->app_icon ? n->app_icon : s->app_icon;
+	if (!app_icon)
+		app_icon = "";
+	category = _notification_hints_get_string(n->hints, "category",
+			_notification_hints_get_string(s->default_hints, "category", ""));
+
+	memset(&r, 0, sizeof(r));
+	r.summary_len = strlen(t->summary);
+	r.body_len = t->body_len;
+	r.app_icon_len = strlen(app_icon) < UINT16_MAX ? strlen(app_icon) : 0;
+	r.category_len = strlen(category) < UINT16_MAX ? strlen(category) : 0;
+	size = SPOOL_ALIGN(sizeof(r) + r.summary_len + t->body_len
+			+ r.app_icon_len + r.category_len + 4);
+	if (size > s->spool.size - SPOOL_DATA_START)
+		return err;
+	r.size = size;
+	r.expire_timeout = n->expire_timeout;
+	r.urgency = _notification_hints_get_byte(n->hints, "urgency",
+			_notification_hints_get_byte(s->default_hints, "urgency",
+				NOTIFICATION_URGENCY_NORMAL));
+	r.spooled_at = _spool_now();
+
+	r.hash = _notify_dedup_hash(_NOTIFY_DEDUP_HASH_INIT,
+			&r.expire_timeout, sizeof(r.expire_timeout));
+	r.hash = _notify_dedup_hash(r.hash, &r.urgency, 1);
+	r.hash = _notify_dedup_hash(r.hash, t->summary, r.summary_len);
+	r.hash = _notify_dedup_hash(r.hash, t->body, r.body_len);
+	r.hash = _notify_dedup_hash(r.hash, app_icon, r.app_icon_len);
+	r.hash = _notify_dedup_hash(r.hash, category, r.category_len);
+
+	/* a repeat is replayed once */
+	for (offset = f->head; offset < f->tail; offset += rp->size) {
+		rp = _spool_record(f, offset);
+		if (rp->hash == r.hash && rp->size == r.size
+				&& !memcmp(rp + 1, t->summary, r.summary_len))
+			return notify_session_set_error(s, NOTIFY_ERROR_SPOOLED);
+	}
+
+	_spool_make_room(s, r.size);
+	rp = _spool_record(f, f->tail);
+	*rp = r;
+	p = (char*) (rp + 1);
+	p = _spool_append_str(p, t->summary, r.summary_len);
+	p = _spool_append_str(p, t->body, r.body_len);
+	p = _spool_append_str(p, app_icon, r.app_icon_len);
+	_spool_append_str(p, category, r.category_len);
+
+	/* the record is complete before it becomes visible */
+	f->tail += r.size;
+	f->count++;
+	_stats_inc(s, spooled);
+	return notify_session_set_error(s, NOTIFY_ERROR_SPOOLED);
+}
+
+static NotifyError _spool_replay_record(NotifySession s,
+		const struct _notify_spool_record* r) {
+	struct _notification_text t;
+	const char *app_icon, *category;
+	Notification n;
+	NotifyError ret;
+
+	/* the text was formatted before spooling */
+	t.summary = (const char*) (r + 1);
+	t.body = t.summary + r->summary_len + 1;
+	t.body_len = r->body_len;
+	t.summary_buf = t.body_buf = NULL;
+	t.hash = 0;
+	app_icon = t.body + r->body_len + 1;
+	category = app_icon + r->app_icon_len + 1;
+
+	n = notification_new_unformatted(t.summary, NULL);
+	if (r->app_icon_len)
+		notification_set_app_icon(n, app_icon);
+	if (r->category_len)
+		notification_set_category(n, category);
+	notification_set_urgency(n, r->urgency);
+	notification_set_expire_timeout(n, r->expire_timeout);
+
+	/* sent directly, not to be queued, limited or aggregated again */
+	_timing_start(s);
+	ret = _notification_send_text(n, s, &t);
+	_timing_finish(s);
+	if (ret)
+		_stats_inc(s, failed);
+	notification_free(n);
+
+	return ret;
+}
+
+/* whether the record should be kept after failing with err, to be
+ * replayed once the server (or memory) is available again */
+static int _spool_should_retry(NotifySession s, NotifyError err) {
+	return err == NOTIFY_ERROR_DBUS_CONNECT || err == NOTIFY_ERROR_NO_SERVER
+		|| err == NOTIFY_ERROR_NO_MEMORY || err == NOTIFY_ERROR_MEMORY_BUDGET
+		|| !s->transport_data || !s->transport->is_connected(s);
+}
+
+int _notify_spool_pending(NotifySession s) {
+	return _notify_spool_enabled(s) && s->spool.map->count;
+}
+
+void _notify_spool_replay(NotifySession s) {
+	struct _notify_spool_file *f = s->spool.map;
+	int64_t now = _spool_now();
+
+	s->spool.replaying = 1;
+	while (f->count) {
+		struct _notify_spool_record *r = _spool_record(f, f->head);
+		NotifyError ret;
+
+		if (s->spool.ttl >= 0 && now - r->spooled_at > s->spool.ttl) {
+			_spool_drop_head(s);
+			_stats_inc(s, spool_dropped);
+			continue;
+		}
+
+		if ((ret = _spool_replay_record(s, r))) {
+			if (_spool_should_retry(s, ret))
+				break;
+			/* rejected by the server, it won't ever be accepted */
+			_spool_drop_head(s);
+			_stats_inc(s, spool_dropped);
+			continue;
+		}
+		_spool_drop_head(s);
+		_stats_inc(s, spool_replayed);
+	}
+	s->spool.replaying = 0;
+}
+
+size_t notify_session_replay_spool(NotifySession s) {
+	struct _notify_spool_file *f = s->spool.map;
+
+	if (!f)
+		return 0;
+	if (_notify_spool_pending(s) && !notify_session_connect(s))
+		_notify_spool_replay(s);
+
+	return f->count;
+}
@@ -0,0 +1,87 @@
+/* libtinynotify -- disk spool for undeliverable notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_SPOOL_H
+#define _TINYNOTIFY_SPOOL_H
+
+#include <stddef.h>
+
+/**
+ * SECTION: NotifySpool
+ * @short_description: API to keep notifications until the server is up
+ * @include: tinynotify.h
+ *
+ * If a spool file is set, new notifications which can't be sent because
+ * the session bus or the notification server is not available (see
+ * %NOTIFY_ERROR_NO_SERVER) are appended to it instead of being lost. They are replayed in order once
+ * a notification reaches the server, or when notify_session_replay_spool()
+ * is called.
+ *
+ * The spool keeps the formatted summary and body, the icon, the urgency,
+ * the category and the expiration timeout. Other hints, actions
+ * and callbacks are not kept. Repeats of a notification which is in
+ * the spool already are not appended again.
+ *
+ * The spool file is memory-mapped, and persists across restarts.
+ * It is not touched when the notifications are delivered successfully.
+ */
+
+/**
+ * NOTIFY_SESSION_DEFAULT_SPOOL_SIZE
+ *
+ * The default size of the spool file, in bytes.
+ */
+extern const size_t NOTIFY_SESSION_DEFAULT_SPOOL_SIZE;
+
+/**
+ * NOTIFY_SESSION_DEFAULT_SPOOL_TTL
+ *
+ * The default time-to-live of spooled notifications [ms].
+ */
+extern const int NOTIFY_SESSION_DEFAULT_SPOOL_TTL;
+
+/**
+ * notify_session_set_spool
+ * @session: session to operate on
+ * @path: path to the spool file, or NULL to stop spooling
+ * @size: the size of the spool file in bytes,
+ *	or %NOTIFY_SESSION_DEFAULT_SPOOL_SIZE
+ * @ttl: the time [ms] after which spooled notifications are discarded
+ *	instead of being replayed, or %NOTIFY_SESSION_DEFAULT_SPOOL_TTL
+ *
+ * Spool the undeliverable notifications to the file at @path, creating it
+ * if necessary. When the spool is full, the oldest notifications are
+ * dropped. The notifications spooled by the previous instances
+ * of the program are kept, and replayed; if @size changed, the oldest ones
+ * are dropped as necessary to fit.
+ *
+ * The spool file is locked while in use, and setting a file used by another
+ * process fails. A file which is not a spool file is refused; a damaged one
+ * is reset.
+ *
+ * When a notification is spooled, notification_send() returns
+ * %NOTIFY_ERROR_SPOOLED. Updates of notifications which were shown already
+ * are never spooled, and neither are the notifications which failed after
+ * being queued (see notify_session_set_queue()).
+ *
+ * Returns: a positive #NotifyError or %NOTIFY_ERROR_NO_ERROR
+ */
+NotifyError notify_session_set_spool(NotifySession session, const char* path,
+		size_t size, int ttl);
+
+/**
+ * notify_session_replay_spool
+ * @session: session to operate on
+ *
+ * Send the notifications from the spool, in order, stopping once
+ * the server turns out to be unavailable. The notifications rejected
+ * by the server, and the ones whose time-to-live has passed, are dropped.
+ *
+ * Returns: the number of notifications left in the spool
+ */
+size_t notify_session_replay_spool(NotifySession session);
+
+#endif /*_TINYNOTIFY_SPOOL_H*/
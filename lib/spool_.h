@@ -0,0 +1,50 @@
+/* libtinynotify -- disk spool for undeliverable notifications
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_SPOOL__H
+#define _TINYNOTIFY_SPOOL__H
+
+#include <stddef.h>
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notification_text;
+struct _notify_spool_file;
+
+struct _notify_spool {
+	/* NULL if no spool file is used */
+	struct _notify_spool_file* map;
+	/* kept open for the lock, -1 if none */
+	int fd;
+	size_t size;
+	int ttl;
+	/* set while replaying, not to spool the notifications again */
+	int replaying;
+};
+
+void _notify_spool_init(struct _notify_spool* sp);
+void _notify_spool_free(NotifySession s);
+
+/* whether the spooled notifications should be replayed now */
+#define _notify_spool_enabled(s) ((s)->spool.map && !(s)->spool.replaying)
+/* whether there are spooled notifications to be replayed now */
+int _notify_spool_pending(NotifySession s);
+/* replay the spooled notifications through the connected session,
+ * dropping the ones rejected by the server */
+void _notify_spool_replay(NotifySession s);
+
+/* spool new notification n with text t, if it failed with err because
+ * the server is unavailable; returns the error to report */
+NotifyError _notify_spool_failed(NotifySession s, Notification n,
+		const struct _notification_text* t, NotifyError err);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_SPOOL__H*/
@@ -0,0 +1,310 @@
+/* libtinynotify -- persistent notification state
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "state.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "transport_.h"
+#include "registry_.h"
+#include "state_.h"
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Bump the version whenever the layout changes. */
+#define STATE_MAGIC 0x46534e54U /* 'TNSF' */
+#define STATE_VERSION 1
+
+/* must be a power of two */
+#define STATE_SLOTS 1024
+#define STATE_KEY_SIZE 56
+#define STATE_SERVER_SIZE 128
+
+const int NOTIFY_STATE_MAX_KEY_LENGTH = STATE_KEY_SIZE - 1;
+/* keep the load factor below 3/4 */
+const int NOTIFY_STATE_MAX_ENTRIES = STATE_SLOTS / 4 * 3;
+
+/* a linear probing hash table; the slot is empty if id is zero */
+struct _notify_state_slot {
+	uint32_t hash;
+	uint32_t id;
+	char key[STATE_KEY_SIZE];
+};
+
+struct _notify_state_file {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t count;
+	/* the bus and unique name of the server which issued the IDs */
+	char server[STATE_SERVER_SIZE];
+
+	struct _notify_state_slot slots[STATE_SLOTS];
+};
+
+/* the part of the header describing the layout */
+struct _notify_state_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+};
+
+void _notify_state_init(struct _notify_state* st) {
+	st->map = NULL;
+	st->fd = -1;
+	st->valid = 0;
+}
+
+void _notify_state_free(NotifySession s) {
+	if (s->state.map)
+		munmap(s->state.map, sizeof(*s->state.map));
+	/* releases the lock */
+	if (s->state.fd != -1)
+		close(s->state.fd);
+	_notify_state_init(&s->state);
+}
+
+static void _state_reset(struct _notify_state_file* f) {
+	memset(f, 0, sizeof(*f));
+	f->version = STATE_VERSION;
+	f->slot_count = STATE_SLOTS;
+	f->magic = STATE_MAGIC;
+}
+
+/* returns zero if the file can't be used as-is */
+static int _state_check(struct _notify_state_file* f) {
+	uint32_t count = 0;
+	size_t i;
+
+	if (f->magic != STATE_MAGIC || f->version != STATE_VERSION
+			|| f->slot_count != STATE_SLOTS)
+		return 0;
+
+	/* the strings are never read past the slots */
+	f->server[sizeof(f->server) - 1] = 0;
+	for (i = 0; i < STATE_SLOTS; i++) {
+		f->slots[i].key[sizeof(f->slots[i].key) - 1] = 0;
+		if (f->slots[i].id)
+			count++;
+	}
+
+	/* the lookups rely on an empty slot being there */
+	return count == f->count && count <= (uint32_t) NOTIFY_STATE_MAX_ENTRIES;
+}
+
+/* check whether the file size matches the layout in the header;
+ * returns -1 if the file isn't a state file at all */
+static int _state_check_size(int fd, off_t size) {
+	struct _notify_state_header h;
+
+	/* a new file */
+	if (!size)
+		return 0;
+	if (size < (off_t) sizeof(h)
+			|| pread(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h)
+			|| h.magic != STATE_MAGIC)
+		return -1;
+
+	return h.version == STATE_VERSION && h.slot_count == STATE_SLOTS
+		&& size == (off_t) (offsetof(struct _notify_state_file, slots)
+				+ h.slot_count * sizeof(struct _notify_state_slot));
+}
+
+NotifyError notify_session_set_state_file(NotifySession s, const char* path) {
+	struct _notify_state_file *f;
+	struct stat st;
+	int fd, size_ok, saved_errno;
+
+	_notify_state_free(s);
+	if (!path)
+		return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd == -1)
+		return notify_session_set_error(s, NOTIFY_ERROR_STATE_FILE,
+				strerror(errno));
+	/* the IDs would be overwritten by the other process */
+	if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+		saved_errno = errno;
+		close(fd);
+		return notify_session_set_error(s, NOTIFY_ERROR_STATE_FILE,
+				saved_errno == EWOULDBLOCK
+				? "the file is in use by another process"
+				: strerror(saved_errno));
+	}
+	if (fstat(fd, &st) == -1)
+		goto fail;
+	if ((size_ok = _state_check_size(fd, st.st_size)) == -1) {
+		close(fd);
+		return notify_session_set_error(s, NOTIFY_ERROR_STATE_FILE,
+				"not a state file");
+	}
+	/* truncating first zero-fills a file of a different layout */
+	if ((!size_ok && (ftruncate(fd, 0) == -1
+					|| ftruncate(fd, sizeof(*f)) == -1))
+			|| (f = mmap(NULL, sizeof(*f), PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, 0)) == MAP_FAILED)
+		goto fail;
+
+	if (!_state_check(f))
+		_state_reset(f);
+
+	s->state.map = f;
+	s->state.fd = fd;
+	if (s->transport_data)
+		_notify_state_connected(s);
+	return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+
+fail:
+	saved_errno = errno;
+	close(fd);
+	return notify_session_set_error(s, NOTIFY_ERROR_STATE_FILE,
+			strerror(saved_errno));
+}
+
+void _notify_state_connected(NotifySession s) {
+	struct _notify_state_file *f = s->state.map;
+	char *name;
+
+	s->state.valid = 0;
+	if (!f)
+		return;
+
+	/* without the name, the IDs can't be trusted (nor stored) */
+	if (!(name = s->transport->get_server_name(s)))
+		return;
+	if (strlen(name) < sizeof(f->server)) {
+		if (strcmp(f->server, name)) {
+			/* the server was restarted, and the IDs are gone */
+			memset(f->slots, 0, sizeof(f->slots));
+			f->count = 0;
+			strcpy(f->server, name);
+		}
+		s->state.valid = 1;
+	}
+	free(name);
+}
+
+/* returns the index of the slot holding key, or of the empty slot
+ * where it would be inserted */
+static size_t _state_find(const struct _notify_state_file* f,
+		const char* key, uint32_t hash) {
+	size_t i;
+
+	/* the table is never full, so an empty slot will be found */
+	for (i = hash & (STATE_SLOTS - 1); f->slots[i].id;
+			i = (i + 1) & (STATE_SLOTS - 1)) {
+		if (f->slots[i].hash == hash && !strcmp(f->slots[i].key, key))
+			break;
+	}
+
+	return i;
+}
+
+/* remove slot i, shifting back the following entries of the cluster */
+static void _state_remove(struct _notify_state_file* f, size_t i) {
+	size_t j, k;
+
+	for (j = i;;) {
+		j = (j + 1) & (STATE_SLOTS - 1);
+		if (!f->slots[j].id)
+			break;
+
+		/* leave the entries which are reachable from their home slot */
+		k = f->slots[j].hash & (STATE_SLOTS - 1);
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+
+		f->slots[i] = f->slots[j];
+		i = j;
+	}
+
+	memset(&f->slots[i], 0, sizeof(f->slots[i]));
+	f->count--;
+}
+
+void _notify_state_resume(NotifySession s, Notification n) {
+	struct _notify_state_file *f = s->state.map;
+	const char *key = n->registry_key;
+	size_t i;
+
+	if (!f || !key || n->message_id)
+		return;
+	/* the IDs are valid only for the server which issued them */
+	if (notify_session_connect(s) || !s->state.valid)
+		return;
+
+	i = _state_find(f, key, _notify_registry_hash(key));
+	n->message_id = f->slots[i].id;
+}
+
+void _notify_state_sync(NotifySession s, Notification n) {
+	struct _notify_state_file *f = s->state.map;
+	const char *key = n->registry_key;
+	uint32_t hash;
+	size_t i;
+
+	if (!f || !key || !s->state.valid)
+		return;
+	if (!n->message_id) {
+		_notify_state_forget(s, key);
+		return;
+	}
+	if (strlen(key) > (size_t) NOTIFY_STATE_MAX_KEY_LENGTH)
+		return;
+
+	hash = _notify_registry_hash(key);
+	i = _state_find(f, key, hash);
+	if (!f->slots[i].id) {
+		if (f->count >= (uint32_t) NOTIFY_STATE_MAX_ENTRIES)
+			return;
+		f->slots[i].hash = hash;
+		strcpy(f->slots[i].key, key);
+		f->count++;
+	}
+	f->slots[i].id = n->message_id;
+}
+
+void _notify_state_forget(NotifySession s, const char* key) {
+	struct _notify_state_file *f = s->state.map;
+	size_t i;
+
+	if (!f)
+		return;
+
+	i = _state_find(f, key, _notify_registry_hash(key));
+	if (f->slots[i].id)
+		_state_remove(f, i);
+}
+
+void _notify_state_closed(NotifySession s, uint32_t id) {
+	struct _notify_state_file *f = s->state.map;
+	size_t i;
+
+	if (!f || !s->state.valid || !f->count)
+		return;
+
+	for (i = 0; i < STATE_SLOTS; i++) {
+		if (f->slots[i].id == id) {
+			_state_remove(f, i);
+			break;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+/* libtinynotify -- persistent notification state
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_STATE_H
+#define _TINYNOTIFY_STATE_H
+
+/**
+ * SECTION: NotifyState
+ * @short_description: API to keep the notification IDs across restarts
+ * @include: tinynotify.h
+ *
+ * The server IDs of the registered notifications (see
+ * notify_session_register()) can be kept in a state file. Then, when
+ * the program is restarted and registers a notification under the same
+ * key, it updates (or closes) the notification shown by the previous
+ * instance instead of showing a new one.
+ *
+ * The state file is memory-mapped, so keeping it up-to-date costs no
+ * system calls. It records the name of the server instance which issued
+ * the IDs, and the IDs are forgotten when the server is restarted.
+ */
+
+/**
+ * NOTIFY_STATE_MAX_KEY_LENGTH
+ *
+ * The maximal length of a key which can be kept in the state file.
+ * The notifications registered under longer keys are not kept.
+ */
+extern const int NOTIFY_STATE_MAX_KEY_LENGTH;
+
+/**
+ * NOTIFY_STATE_MAX_ENTRIES
+ *
+ * The maximal number of notifications kept in the state file. When it is
+ * full, the IDs of further notifications are not kept.
+ */
+extern const int NOTIFY_STATE_MAX_ENTRIES;
+
+/**
+ * notify_session_set_state_file
+ * @session: session to operate on
+ * @path: path to the state file, or NULL to stop using one
+ *
+ * Keep the IDs of the registered notifications in the file at @path,
+ * creating it if necessary. The IDs found in the file are used
+ * by notification_send(), notification_update() and notification_close()
+ * of registered notifications which weren't sent yet, as long as
+ * the server which issued them is still running.
+ *
+ * The file is locked while it is used. If another process holds the lock,
+ * or the file exists but isn't a state file, %NOTIFY_ERROR_STATE_FILE
+ * is returned. A state file of a different layout (or a damaged one)
+ * is reset.
+ *
+ * Returns: a positive #NotifyError or %NOTIFY_ERROR_NO_ERROR
+ */
+NotifyError notify_session_set_state_file(NotifySession session,
+		const char* path);
+
+#endif /*_TINYNOTIFY_STATE_H*/
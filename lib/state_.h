@@ -0,0 +1,45 @@
+/* libtinynotify -- persistent notification state
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_STATE__H
+#define _TINYNOTIFY_STATE__H
+
+#include <stdint.h>
+
+#include "session.h"
+#include "notification.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notify_state_file;
+
+struct _notify_state {
+	/* NULL if no state file is used */
+	struct _notify_state_file* map;
+	/* kept open (and locked) while mapped */
+	int fd;
+	/* whether the IDs in the file were issued by the connected server */
+	int valid;
+};
+
+void _notify_state_init(struct _notify_state* st);
+void _notify_state_free(NotifySession s);
+
+/* check the server the session connected to against the file */
+void _notify_state_connected(NotifySession s);
+
+/* take the ID of registered n from the file, if it has none */
+void _notify_state_resume(NotifySession s, Notification n);
+/* store the current ID of registered n in the file */
+void _notify_state_sync(NotifySession s, Notification n);
+/* drop key from the file */
+void _notify_state_forget(NotifySession s, const char* key);
+/* drop the entry for the closed notification id, if any */
+void _notify_state_closed(NotifySession s, uint32_t id);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_STATE__H*/
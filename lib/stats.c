@@ -0,0 +1,152 @@
+/* libtinynotify -- session statistics
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "stats.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "stats_.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef HAVE_LIBSTRL
+#	include <strl.h>
+#endif
+
+/* weight of the newest sample in the latency moving average: 1/8 */
+#define LATENCY_SHIFT 3
+
+void _notify_stats_call_begin(NotifySession s) {
+	clock_gettime(CLOCK_MONOTONIC, &s->stats.call_start);
+	_stats_inc(s, in_flight);
+}
+
+void _notify_stats_call_end(NotifySession s) {
+	_notify_stats_add_latency(s, &s->stats.call_start);
+	_stats_dec(s, in_flight);
+}
+
+/* add the time elapsed since start to the moving average */
+static void _stats_add_sample(unsigned long long* avg,
+		const struct timespec* start) {
+	struct timespec now;
+	unsigned long long sample;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	sample = (now.tv_sec - start->tv_sec) * 1000000000ULL
+		+ now.tv_nsec - start->tv_nsec;
+
+	if (*avg)
+		*avg += ((long long) sample - (long long) *avg) >> LATENCY_SHIFT;
+	else
+		*avg = sample;
+}
+
+void _notify_stats_add_latency(NotifySession s, const struct timespec* start) {
+	_stats_add_sample(&s->stats.counters.latency_ns, start);
+}
+
+void _notify_stats_add_queue_delay(NotifySession s, int urgency,
+		const struct timespec* start) {
+	_stats_add_sample(&s->stats.counters.queue_delay_ns[urgency], start);
+}
+
+void _notify_stats_publish(NotifySession s) {
+	struct _notify_shm_stats *shm = s->stats.shm;
+	NotifyStats *c = &s->stats.counters;
+
+	_shm_store(shm->sent, c->sent);
+	_shm_store(shm->closed, c->closed);
+	_shm_store(shm->failed, c->failed);
+	_shm_store(shm->in_flight, c->in_flight);
+	_shm_store(shm->tracked, c->tracked);
+	_shm_store(shm->latency_ns, c->latency_ns);
+}
+
+void _notify_stats_free(NotifySession s) {
+	if (s->stats.shm) {
+		munmap(s->stats.shm, sizeof(*s->stats.shm));
+#ifdef HAVE_SHM_OPEN
+		shm_unlink(s->stats.shm_name);
+#endif
+		free(s->stats.shm_name);
+		s->stats.shm = NULL;
+		s->stats.shm_name = NULL;
+	}
+}
+
+const NotifyStats* notify_session_get_stats(NotifySession s) {
+	return &s->stats.counters;
+}
+
+NotifyError notify_session_publish_stats(NotifySession s, int enabled) {
+#ifdef HAVE_SHM_OPEN
+	static unsigned int segment_no = 0;
+
+	struct _notify_shm_stats *shm;
+	char *name;
+	int fd;
+#endif
+
+	if (!enabled || s->stats.shm) {
+		if (!enabled)
+			_notify_stats_free(s);
+		return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+	}
+
+#ifndef HAVE_SHM_OPEN
+	return notify_session_set_error(s, NOTIFY_ERROR_STATS_SHM,
+			strerror(ENOSYS));
+#else
+
+	_mem_assert(asprintf(&name, "/" NOTIFY_SHM_PREFIX "%ld-%u",
+				(long int) getpid(),
+				__atomic_fetch_add(&segment_no, 1, __ATOMIC_RELAXED)) != -1);
+
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd == -1) {
+		free(name);
+		return notify_session_set_error(s, NOTIFY_ERROR_STATS_SHM,
+				strerror(errno));
+	}
+	if (ftruncate(fd, sizeof(*shm)) == -1
+			|| (shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		int saved_errno = errno;
+
+		close(fd);
+		shm_unlink(name);
+		free(name);
+		return notify_session_set_error(s, NOTIFY_ERROR_STATS_SHM,
+				strerror(saved_errno));
+	}
+	close(fd);
+
+	/* the segment is zero-filled by ftruncate() */
+	shm->pid = getpid();
+	if (s->app_name)
+		strncpy(shm->app_name, s->app_name, sizeof(shm->app_name) - 1);
+	shm->version = NOTIFY_SHM_VERSION;
+
+	s->stats.shm = shm;
+	s->stats.shm_name = name;
+	_notify_stats_publish(s);
+	/* readers check the magic last */
+	__atomic_store_n(&shm->magic, NOTIFY_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+#endif
+}
@@ -0,0 +1,123 @@
+/* libtinynotify -- session statistics
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_STATS_H
+#define _TINYNOTIFY_STATS_H
+
+/**
+ * SECTION: NotifyStats
+ * @short_description: API to access session traffic counters
+ * @include: tinynotify.h
+ *
+ * Each #NotifySession keeps a few counters describing the notification
+ * traffic going through it. They can be read in-process using
+ * notify_session_get_stats().
+ *
+ * Additionally, the counters can be published into a shared memory segment
+ * (in /dev/shm) using notify_session_publish_stats(). This way, they can be
+ * watched from outside the process, e.g. using the tinynotify-top tool.
+ * The segment is updated lock-free, and removed when publishing is disabled
+ * or the session is freed.
+ */
+
+/**
+ * NotifyStats
+ * @sent: the number of notifications sent (or updated) successfully
+ * @closed: the number of notifications closed successfully
+ * @failed: the number of calls which failed
+ * @in_flight: the number of calls awaiting the server reply
+ * @tracked: the number of notifications tracked for events
+ * @latency_ns: recent server round-trip latency (moving average),
+ *	in nanoseconds
+ * @image_cache_hits: the number of images found in the session image cache
+ * @image_cache_misses: the number of images which had to be encoded
+ * @signals_dropped: the number of server signals dropped because of
+ *	an allocation failure or the session memory budget
+ * @queued: the number of notifications waiting in the outgoing queue
+ * @queue_dropped: the number of notifications dropped because the outgoing
+ *	queue was full
+ * @queue_coalesced: the number of notifications which replaced a queued one
+ * @queue_delay_ns: recent time spent in the outgoing queue (moving average),
+ *	in nanoseconds, for each #NotificationUrgency level
+ * @queue_expired: the number of notifications dropped from the outgoing queue
+ *	because their time-to-live passed
+ * @ttl_closed: the number of notifications closed because their time-to-live
+ *	passed
+ * @rate_limited: the number of notifications rejected or folded because
+ *	of the rate limit
+ * @aggregated: the number of notifications aggregated into summaries
+ * @dedup_hits: the number of notifications recognized as repeats
+ * @dedup_misses: the number of notifications checked for repeats and sent
+ *	as new
+ * @evicted: the number of tracked notifications evicted by the client-side
+ *	expiry tracking
+ * @spooled: the number of notifications written to the spool
+ * @spool_replayed: the number of spooled notifications sent
+ * @spool_dropped: the number of spooled notifications dropped because
+ *	the spool was full, or their time-to-live passed
+ *
+ * Traffic counters of a session.
+ */
+
+typedef struct {
+	unsigned long sent;
+	unsigned long closed;
+	unsigned long failed;
+	unsigned long in_flight;
+	unsigned long tracked;
+	unsigned long long latency_ns;
+	unsigned long image_cache_hits;
+	unsigned long image_cache_misses;
+	unsigned long signals_dropped;
+	unsigned long queued;
+	unsigned long queue_dropped;
+	unsigned long queue_coalesced;
+	unsigned long long queue_delay_ns[3];
+	unsigned long queue_expired;
+	unsigned long ttl_closed;
+	unsigned long rate_limited;
+	unsigned long aggregated;
+	unsigned long dedup_hits;
+	unsigned long dedup_misses;
+	unsigned long evicted;
+	unsigned long spooled;
+	unsigned long spool_replayed;
+	unsigned long spool_dropped;
+} NotifyStats;
+
+/**
+ * notify_session_get_stats
+ * @session: session to operate on
+ *
+ * Get the traffic counters of @session.
+ *
+ * Returns: a pointer to the counters stored within @session (not to be freed,
+ * valid until the session is freed)
+ */
+const NotifyStats* notify_session_get_stats(NotifySession session);
+
+/**
+ * notify_session_publish_stats
+ * @session: session to operate on
+ * @enabled: zero (false) to disable, non-zero (true) to enable
+ *
+ * Enable or disable publishing the traffic counters of @session into
+ * a shared memory segment.
+ *
+ * The segment is named after the process ID, and can be found in /dev/shm
+ * as 'tinynotify-&lt;pid&gt;-&lt;n&gt;'. It is removed when publishing is
+ * disabled, or @session is freed. The segments left behind by the processes
+ * which died are removed by tinynotify-top.
+ *
+ * If the system has no shm_open(), this fails with
+ * %NOTIFY_ERROR_STATS_SHM.
+ *
+ * Returns: a #NotifyError or %NOTIFY_ERROR_NO_ERROR if the segment was set up
+ * (or removed) successfully
+ */
+NotifyError notify_session_publish_stats(NotifySession session, int enabled);
+
+#endif /*_TINYNOTIFY_STATS_H*/
@@ -0,0 +1,46 @@
+/* libtinynotify -- session statistics
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_STATS__H
+#define _TINYNOTIFY_STATS__H
+
+#include <time.h>
+
+#include "session.h"
+#include "stats.h"
+
+#include "shmstats_.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notify_stats_state {
+	NotifyStats counters;
+	struct timespec call_start;
+
+	struct _notify_shm_stats* shm;
+	char* shm_name;
+};
+
+void _notify_stats_call_begin(NotifySession s);
+void _notify_stats_call_end(NotifySession s);
+/* account the round-trip of a call sent at start */
+void _notify_stats_add_latency(NotifySession s, const struct timespec* start);
+/* account the time a notification with urgency spent in the queue */
+void _notify_stats_add_queue_delay(NotifySession s, int urgency,
+		const struct timespec* start);
+void _notify_stats_publish(NotifySession s);
+void _notify_stats_free(NotifySession s);
+
+#define _stats_publish(s) \
+	do { if ((s)->stats.shm) _notify_stats_publish(s); } while (0)
+#define _stats_inc(s, field) \
+	do { (s)->stats.counters.field++; _stats_publish(s); } while (0)
+#define _stats_dec(s, field) \
+	do { (s)->stats.counters.field--; _stats_publish(s); } while (0)
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_STATS__H*/
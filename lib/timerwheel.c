@@ -0,0 +1,168 @@
+/* libtinynotify -- hierarchical timer wheel
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "timerwheel_.h"
+
+#include <string.h>
+
+#define WHEEL_MASK (_NOTIFY_WHEEL_SLOTS - 1)
+#define WHEEL_SPAN(level) (1ULL << (_NOTIFY_WHEEL_BITS * (level)))
+#define WHEEL_INDEX(tick, level) \
+	(((tick) >> (_NOTIFY_WHEEL_BITS * (level))) & WHEEL_MASK)
+
+void _notify_wheel_init(struct _notify_timer_wheel* w) {
+	memset(w, 0, sizeof(*w));
+	clock_gettime(CLOCK_MONOTONIC, &w->epoch);
+}
+
+static uint64_t _wheel_current_tick(const struct _notify_timer_wheel* w) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((now.tv_sec - w->epoch.tv_sec) * 1000
+		+ (now.tv_nsec - w->epoch.tv_nsec) / 1000000)
+		/ _NOTIFY_WHEEL_TICK_MS;
+}
+
+static void _wheel_link(struct _notify_timer** head,
+		struct _notify_timer* t) {
+	t->next = *head;
+	if (t->next)
+		t->next->pprev = &t->next;
+	t->pprev = head;
+	*head = t;
+}
+
+static void _wheel_unlink(struct _notify_timer* t) {
+	*t->pprev = t->next;
+	if (t->next)
+		t->next->pprev = t->pprev;
+	t->pprev = NULL;
+}
+
+/* put t into the slot matching its expiry, relative to w->now */
+static void _wheel_place(struct _notify_timer_wheel* w,
+		struct _notify_timer* t) {
+	uint64_t delta;
+	int level;
+
+	if (t->expires < w->now)
+		t->expires = w->now;
+	delta = t->expires - w->now;
+	if (delta >= WHEEL_SPAN(_NOTIFY_WHEEL_LEVELS)) {
+		t->expires = w->now + WHEEL_SPAN(_NOTIFY_WHEEL_LEVELS) - 1;
+		delta = t->expires - w->now;
+	}
+
+	for (level = 0; delta >= WHEEL_SPAN(level + 1); level++);
+	_wheel_link(&w->slots[level][WHEEL_INDEX(t->expires, level)], t);
+}
+
+void _notify_wheel_add(struct _notify_timer_wheel* w,
+		struct _notify_timer* t, int timeout) {
+	if (_notify_timer_armed(t))
+		_wheel_unlink(t);
+	else
+		w->count++;
+
+	/* round up, so that it never expires early */
+	t->expires = _wheel_current_tick(w)
+		+ (timeout + _NOTIFY_WHEEL_TICK_MS - 1) / _NOTIFY_WHEEL_TICK_MS;
+	_wheel_place(w, t);
+}
+
+void _notify_wheel_remove(struct _notify_timer_wheel* w,
+		struct _notify_timer* t) {
+	if (_notify_timer_armed(t)) {
+		_wheel_unlink(t);
+		w->count--;
+	}
+}
+
+/* move the timers of a higher level slot down the wheel; returns
+ * the slot index */
+static int _wheel_cascade(struct _notify_timer_wheel* w, int level) {
+	int index = WHEEL_INDEX(w->now, level);
+	struct _notify_timer *t = w->slots[level][index];
+
+	w->slots[level][index] = NULL;
+	while (t) {
+		struct _notify_timer *next = t->next;
+
+		_wheel_place(w, t);
+		t = next;
+	}
+
+	return index;
+}
+
+void _notify_wheel_advance(struct _notify_timer_wheel* w) {
+	uint64_t target = _wheel_current_tick(w);
+
+	/* nothing to run, just catch up */
+	if (!w->count) {
+		if (w->now <= target)
+			w->now = target + 1;
+		return;
+	}
+
+	for (; w->now <= target; w->now++) {
+		int index = WHEEL_INDEX(w->now, 0);
+		int level;
+		struct _notify_timer *t;
+
+		/* at the start of each round, bring the next round down */
+		if (!index) {
+			for (level = 1; level < _NOTIFY_WHEEL_LEVELS
+					&& !_wheel_cascade(w, level); level++);
+		}
+
+		while ((t = w->slots[0][index])) {
+			_wheel_unlink(t);
+			_wheel_link(&w->due, t);
+		}
+	}
+}
+
+struct _notify_timer* _notify_wheel_pop_due(struct _notify_timer_wheel* w) {
+	struct _notify_timer *t = w->due;
+
+	if (t) {
+		_wheel_unlink(t);
+		w->count--;
+	}
+	return t;
+}
+
+int _notify_wheel_timeout(struct _notify_timer_wheel* w, int timeout) {
+	uint64_t current, next;
+	long remaining;
+	int i;
+
+	if (!w->count)
+		return timeout;
+	if (w->due)
+		return 0;
+
+	/* the level 0 timers expire within a single round; otherwise,
+	 * wake up for the next cascade */
+	next = w->now + _NOTIFY_WHEEL_SLOTS - WHEEL_INDEX(w->now, 0);
+	for (i = 0; i < _NOTIFY_WHEEL_SLOTS; i++) {
+		if (w->slots[0][WHEEL_INDEX(w->now + i, 0)]) {
+			next = w->now + i;
+			break;
+		}
+	}
+
+	current = _wheel_current_tick(w);
+	if (next <= current)
+		return 0;
+	remaining = (next - current) * _NOTIFY_WHEEL_TICK_MS;
+	if (timeout < 0 || remaining < timeout)
+		return remaining;
+	return timeout;
+}
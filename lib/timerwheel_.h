@@ -0,0 +1,66 @@
+/* libtinynotify -- hierarchical timer wheel
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_TIMERWHEEL__H
+#define _TINYNOTIFY_TIMERWHEEL__H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+#define _NOTIFY_WHEEL_BITS 6
+#define _NOTIFY_WHEEL_SLOTS (1 << _NOTIFY_WHEEL_BITS)
+/* 64^4 ticks of 10 ms is about 46 hours; later timers are clamped */
+#define _NOTIFY_WHEEL_LEVELS 4
+#define _NOTIFY_WHEEL_TICK_MS 10
+
+/* to be embedded in the timed structure */
+struct _notify_timer {
+	/* in ticks since the wheel epoch */
+	uint64_t expires;
+
+	struct _notify_timer* next;
+	/* NULL if the timer is not armed */
+	struct _notify_timer** pprev;
+};
+
+struct _notify_timer_wheel {
+	struct timespec epoch;
+	/* the next tick to be run */
+	uint64_t now;
+	size_t count;
+
+	struct _notify_timer* slots[_NOTIFY_WHEEL_LEVELS][_NOTIFY_WHEEL_SLOTS];
+	/* expired, not popped yet */
+	struct _notify_timer* due;
+};
+
+#define _notify_timer_init(t) ((t)->pprev = NULL)
+#define _notify_timer_armed(t) (!!(t)->pprev)
+
+void _notify_wheel_init(struct _notify_timer_wheel* w);
+
+/* (re)arm t to expire after timeout [ms] */
+void _notify_wheel_add(struct _notify_timer_wheel* w,
+		struct _notify_timer* t, int timeout);
+/* disarm t (no-op if not armed) */
+void _notify_wheel_remove(struct _notify_timer_wheel* w,
+		struct _notify_timer* t);
+
+/* run the wheel up to the current time, moving the expired timers
+ * to the due list */
+void _notify_wheel_advance(struct _notify_timer_wheel* w);
+/* disarm and return a due timer, or NULL if none */
+struct _notify_timer* _notify_wheel_pop_due(struct _notify_timer_wheel* w);
+
+/* shorten timeout [ms] to (no later than) the next expiry */
+int _notify_wheel_timeout(struct _notify_timer_wheel* w, int timeout);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_TIMERWHEEL__H*/
@@ -0,0 +1,81 @@
+/* libtinynotify -- send path instrumentation
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "timing.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "timing_.h"
+
+#include <string.h>
+#include <time.h>
+
+static unsigned long long _timespec_diff_ns(const struct timespec* from,
+		const struct timespec* to) {
+	return (to->tv_sec - from->tv_sec) * 1000000000ULL
+		+ to->tv_nsec - from->tv_nsec;
+}
+
+void _notify_timing_start(NotifySession s) {
+	struct _notify_timing_state *t = &s->timing;
+
+	if (t->depth++)
+		return;
+	memset(&t->current, 0, sizeof(t->current));
+	clock_gettime(CLOCK_MONOTONIC, &t->start);
+	t->mark = t->start;
+}
+
+void _notify_timing_mark(NotifySession s, NotifyTimingPhase phase) {
+	struct _notify_timing_state *t = &s->timing;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	t->current.phase_ns[phase] += _timespec_diff_ns(&t->mark, &now);
+	t->mark = now;
+}
+
+void _notify_timing_finish(NotifySession s) {
+	struct _notify_timing_state *t = &s->timing;
+	struct timespec now;
+	int i;
+
+	if (t->depth && --t->depth)
+		return;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	t->current.total_ns = _timespec_diff_ns(&t->start, &now);
+
+	t->stats.calls++;
+	for (i = 0; i < NOTIFY_TIMING_PHASES; i++) {
+		t->stats.phase_ns[i] += t->current.phase_ns[i];
+		if (t->current.phase_ns[i] > t->stats.phase_max_ns[i])
+			t->stats.phase_max_ns[i] = t->current.phase_ns[i];
+	}
+	t->stats.total_ns += t->current.total_ns;
+	if (t->current.total_ns > t->stats.total_max_ns)
+		t->stats.total_max_ns = t->current.total_ns;
+
+	t->last = t->current;
+}
+
+void notify_session_set_timing(NotifySession s, int enabled) {
+	s->timing.enabled = enabled;
+}
+
+const NotifyTiming* notify_session_get_last_timing(NotifySession s) {
+	return &s->timing.last;
+}
+
+const NotifyTimingStats* notify_session_get_timing_stats(NotifySession s) {
+	return &s->timing.stats;
+}
+
+void notify_session_reset_timing_stats(NotifySession s) {
+	memset(&s->timing.stats, 0, sizeof(s->timing.stats));
+}
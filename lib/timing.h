@@ -0,0 +1,131 @@
+/* libtinynotify -- send path instrumentation
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_TIMING_H
+#define _TINYNOTIFY_TIMING_H
+
+/**
+ * SECTION: NotifyTiming
+ * @short_description: API to measure time spent sending notifications
+ * @include: tinynotify.h
+ *
+ * libtinynotify can record how much time was spent in particular phases
+ * of notification_send(), notification_update() and notification_close().
+ * This is disabled by default, and needs to be enabled explicitly for
+ * a #NotifySession using notify_session_set_timing().
+ *
+ * When timing is enabled, a monotonic timestamp is taken at the boundary
+ * of each phase. The results of the most recent call are available through
+ * notify_session_get_last_timing(), and the results aggregated over all calls
+ * made through a session through notify_session_get_timing_stats().
+ *
+ * When timing is disabled, the cost of the instrumentation is limited to
+ * a single branch per phase.
+ */
+
+/**
+ * NotifyTimingPhase
+ * @NOTIFY_TIMING_CONNECT: establishing the connection (if necessary), and
+ *	the checks before sending (e.g. the rate limit)
+ * @NOTIFY_TIMING_FORMAT: formatting summary & body format strings
+ * @NOTIFY_TIMING_MARSHAL: building the D-Bus message
+ * @NOTIFY_TIMING_WRITE: writing the message to the socket
+ * @NOTIFY_TIMING_REPLY: waiting for the server reply
+ * @NOTIFY_TIMING_PHASES: the number of phases (not a real phase)
+ *
+ * Phases of a single call, used as indices to the #NotifyTiming
+ * and #NotifyTimingStats arrays.
+ */
+
+typedef enum {
+	NOTIFY_TIMING_CONNECT = 0,
+	NOTIFY_TIMING_FORMAT,
+	NOTIFY_TIMING_MARSHAL,
+	NOTIFY_TIMING_WRITE,
+	NOTIFY_TIMING_REPLY,
+
+	NOTIFY_TIMING_PHASES
+} NotifyTimingPhase;
+
+/**
+ * NotifyTiming
+ * @phase_ns: time spent in each of the phases, in nanoseconds
+ * @total_ns: time spent in the whole call, in nanoseconds
+ *
+ * Timing results of a single call.
+ *
+ * Phases which were not reached (e.g. because of an error, or because they
+ * don't apply to notification_close()) are set to zero.
+ */
+
+typedef struct {
+	unsigned long long phase_ns[NOTIFY_TIMING_PHASES];
+	unsigned long long total_ns;
+} NotifyTiming;
+
+/**
+ * NotifyTimingStats
+ * @calls: the number of timed calls
+ * @phase_ns: total time spent in each of the phases, in nanoseconds
+ * @phase_max_ns: the longest time spent in each of the phases,
+ *	in nanoseconds
+ * @total_ns: total time spent in all calls, in nanoseconds
+ * @total_max_ns: the longest single call, in nanoseconds
+ *
+ * Timing results aggregated over all timed calls made through a session.
+ */
+
+typedef struct {
+	unsigned long calls;
+	unsigned long long phase_ns[NOTIFY_TIMING_PHASES];
+	unsigned long long phase_max_ns[NOTIFY_TIMING_PHASES];
+	unsigned long long total_ns;
+	unsigned long long total_max_ns;
+} NotifyTimingStats;
+
+/**
+ * notify_session_set_timing
+ * @session: session to operate on
+ * @enabled: zero (false) to disable, non-zero (true) to enable
+ *
+ * Enable or disable timing of calls made through @session.
+ *
+ * Disabling timing doesn't reset the statistics collected so far.
+ */
+void notify_session_set_timing(NotifySession session, int enabled);
+
+/**
+ * notify_session_get_last_timing
+ * @session: session to operate on
+ *
+ * Get the timing results of the most recent timed call made through @session.
+ *
+ * Returns: a pointer to the results stored within @session (not to be freed,
+ * valid until the next call or until the session is freed)
+ */
+const NotifyTiming* notify_session_get_last_timing(NotifySession session);
+
+/**
+ * notify_session_get_timing_stats
+ * @session: session to operate on
+ *
+ * Get the timing results aggregated over all timed calls made through
+ * @session.
+ *
+ * Returns: a pointer to the results stored within @session (not to be freed,
+ * valid until the session is freed)
+ */
+const NotifyTimingStats* notify_session_get_timing_stats(NotifySession session);
+
+/**
+ * notify_session_reset_timing_stats
+ * @session: session to operate on
+ *
+ * Reset the aggregated timing results of @session.
+ */
+void notify_session_reset_timing_stats(NotifySession session);
+
+#endif /*_TINYNOTIFY_TIMING_H*/
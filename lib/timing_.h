@@ -0,0 +1,45 @@
+/* libtinynotify -- send path instrumentation
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_TIMING__H
+#define _TINYNOTIFY_TIMING__H
+
+#include <time.h>
+
+#include "session.h"
+#include "timing.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+struct _notify_timing_state {
+	int enabled;
+	/* the nested calls (e.g. replaying the spool from within
+	 * notification_send()) are timed as a part of the outer one */
+	int depth;
+
+	struct timespec start;
+	struct timespec mark;
+
+	NotifyTiming current;
+	NotifyTiming last;
+	NotifyTimingStats stats;
+};
+
+void _notify_timing_start(NotifySession s);
+void _notify_timing_mark(NotifySession s, NotifyTimingPhase phase);
+void _notify_timing_finish(NotifySession s);
+
+/* keep the disabled case down to a single branch */
+#define _timing_start(s) \
+	do { if ((s)->timing.enabled) _notify_timing_start(s); } while (0)
+#define _timing_mark(s, phase) \
+	do { if ((s)->timing.enabled) _notify_timing_mark(s, phase); } while (0)
+#define _timing_finish(s) \
+	do { if ((s)->timing.enabled) _notify_timing_finish(s); } while (0)
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_TIMING__H*/
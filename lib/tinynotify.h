@@ -12,5 +12,19 @@
 #include <tinynotify/session.h>
 #include <tinynotify/notification.h>
 #include <tinynotify/event.h>
+#include <tinynotify/timing.h>
+#include <tinynotify/stats.h>
+#include <tinynotify/transport.h>
+#include <tinynotify/hints.h>
+#include <tinynotify/image.h>
+#include <tinynotify/markup.h>
+#include <tinynotify/memory.h>
+#include <tinynotify/queue.h>
+#include <tinynotify/ratelimit.h>
+#include <tinynotify/aggregate.h>
+#include <tinynotify/dedup.h>
+#include <tinynotify/registry.h>
+#include <tinynotify/state.h>
+#include <tinynotify/spool.h>
 
 #endif /*_TINYNOTIFY_H*/
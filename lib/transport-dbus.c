@@ -0,0 +1,563 @@
+/* libtinynotify -- D-Bus transport
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+#include "timing.h"
+#include "transport.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "event_.h"
+#include "timing_.h"
+#include "transport_.h"
+#include "wire_.h"
+#include "memory_.h"
+#include "probes_.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <dbus/dbus.h>
+
+#ifndef DBUS_TIMEOUT_INFINITE /* dbus < 1.4.12 */
+#	define DBUS_TIMEOUT_INFINITE 0x7fffffff
+#	define DBUS_TIMEOUT_USE_DEFAULT -1
+#endif
+
+/* Serials used for the messages marshalled by wire.c. libdbus assigns its own
+ * serials counting from 1, so use the upper range to avoid clashing with
+ * them. */
+#define WIRE_FIRST_SERIAL 0x40000000U
+
+struct _dbus_transport_data {
+	DBusConnection *conn;
+	/* direct connection to the notification server, if any */
+	DBusConnection *peer;
+
+	struct _notify_wire_buf wire;
+	uint32_t wire_serial;
+
+	/* the last message returned by pop_signal() */
+	DBusMessage *last_signal;
+	char* last_error;
+
+	/* set when the add_match() calls were done */
+	int watching;
+};
+
+#define CONN(s) (((struct _dbus_transport_data*) (s)->transport_data)->conn)
+
+/* get the peer address from the environment, or the server capabilities */
+static char* _dbus_get_peer_address(DBusConnection* conn) {
+	const char *env = getenv(_NOTIFY_PEER_ADDRESS_ENV);
+	DBusMessage *msg, *reply;
+	DBusMessageIter iter, subiter;
+	char *ret = NULL;
+
+	if (env && *env)
+		return strdup(env);
+
+	/* the peer is optional, so don't bother about allocation failures */
+	msg = dbus_message_new_method_call(
+			"org.freedesktop.Notifications",
+			"/org/freedesktop/Notifications",
+			"org.freedesktop.Notifications",
+			"GetCapabilities");
+	if (!msg)
+		return NULL;
+	reply = dbus_connection_send_with_reply_and_block(conn, msg,
+			DBUS_TIMEOUT_USE_DEFAULT, NULL);
+	dbus_message_unref(msg);
+	if (!reply)
+		return NULL;
+
+	if (dbus_message_iter_init(reply, &iter)
+			&& dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_ARRAY
+			&& dbus_message_iter_get_element_type(&iter) == DBUS_TYPE_STRING) {
+		dbus_message_iter_recurse(&iter, &subiter);
+		for (; dbus_message_iter_get_arg_type(&subiter) == DBUS_TYPE_STRING;
+				dbus_message_iter_next(&subiter)) {
+			const char *cap;
+
+			dbus_message_iter_get_basic(&subiter, &cap);
+			if (!strncmp(cap, _NOTIFY_PEER_CAPABILITY,
+						strlen(_NOTIFY_PEER_CAPABILITY))) {
+				ret = strdup(cap + strlen(_NOTIFY_PEER_CAPABILITY));
+				break;
+			}
+		}
+	}
+
+	dbus_message_unref(reply);
+	return ret;
+}
+
+static DBusConnection* _dbus_open_peer(DBusConnection* conn) {
+	DBusConnection *peer;
+	char *address = _dbus_get_peer_address(conn);
+
+	if (!address)
+		return NULL;
+
+	/* failing is fine, we'll just use the bus */
+	peer = dbus_connection_open_private(address, NULL);
+	free(address);
+	if (peer)
+		dbus_connection_set_exit_on_disconnect(peer, FALSE);
+
+	return peer;
+}
+
+static void _dbus_close_peer(struct _dbus_transport_data* d) {
+	dbus_connection_close(d->peer);
+	dbus_connection_unref(d->peer);
+	d->peer = NULL;
+}
+
+static NotifyError _dbus_connect(NotifySession s) {
+	struct _dbus_transport_data *d;
+	DBusConnection *conn;
+	DBusError err;
+
+	dbus_error_init(&err);
+	conn = dbus_bus_get_private(DBUS_BUS_SESSION, &err);
+
+	assert(!conn == dbus_error_is_set(&err));
+	if (!conn) {
+		NotifyError ret = notify_session_set_error(s,
+				NOTIFY_ERROR_DBUS_CONNECT, err.message);
+
+		dbus_error_free(&err);
+		return ret;
+	}
+	dbus_connection_set_exit_on_disconnect(conn, FALSE);
+
+	if (!(d = malloc(sizeof(*d))) || _notify_wire_init(&d->wire)) {
+		free(d);
+		dbus_connection_close(conn);
+		dbus_connection_unref(conn);
+		return _notify_session_out_of_memory(s);
+	}
+	d->conn = conn;
+	d->peer = s->peer_to_peer ? _dbus_open_peer(conn) : NULL;
+	d->wire_serial = WIRE_FIRST_SERIAL;
+	d->last_signal = NULL;
+	d->last_error = NULL;
+	d->watching = 0;
+	s->transport_data = d;
+
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+static void _dbus_disconnect(NotifySession s) {
+	struct _dbus_transport_data *d = s->transport_data;
+
+	if (d->last_signal)
+		dbus_message_unref(d->last_signal);
+	free(d->last_error);
+
+	if (d->peer)
+		_dbus_close_peer(d);
+	dbus_connection_close(d->conn);
+	dbus_connection_unref(d->conn);
+	_notify_wire_free(&d->wire);
+	free(d);
+	s->transport_data = NULL;
+}
+
+static int _dbus_is_connected(NotifySession s) {
+	return dbus_connection_get_is_connected(CONN(s));
+}
+
+static int _dbus_is_peer_connected(NotifySession s) {
+	struct _dbus_transport_data *d = s->transport_data;
+
+	return d->peer && dbus_connection_get_is_connected(d->peer);
+}
+
+#define CLOSED_MATCH "type='signal'," \
+	"interface='org.freedesktop.Notifications'," \
+	"member='NotificationClosed'"
+#define ACTION_MATCH "type='signal'," \
+	"interface='org.freedesktop.Notifications'," \
+	"member='ActionInvoked'"
+
+static NotifyError _dbus_watch_signals(NotifySession s) {
+	struct _dbus_transport_data *d = s->transport_data;
+	DBusError err;
+
+	/* the bus limits the number of match rules per connection */
+	if (d->watching)
+		return NOTIFY_ERROR_NO_ERROR;
+
+	dbus_error_init(&err);
+	dbus_bus_add_match(CONN(s), CLOSED_MATCH, &err);
+	if (!dbus_error_is_set(&err)) {
+		dbus_bus_add_match(CONN(s), ACTION_MATCH, &err);
+		/* don't leave a duplicate behind for the next attempt */
+		if (dbus_error_is_set(&err))
+			dbus_bus_remove_match(CONN(s), CLOSED_MATCH, NULL);
+	}
+	if (dbus_error_is_set(&err)) {
+		NotifyError ret = notify_session_set_error(s,
+				NOTIFY_ERROR_DBUS_SEND, err.message);
+
+		dbus_error_free(&err);
+		return ret;
+	}
+	d->watching = 1;
+
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+/* Notify is marshalled by wire.c straight into a buffer, and handed
+ * to libdbus as a complete message. dbus_message_demarshal() copies
+ * and validates the buffer, yet this is still about four times cheaper
+ * than appending the same arguments through DBusMessageIter (which
+ * validates the strings as well), since the hints are pre-encoded
+ * and no containers need to be opened. */
+static DBusMessage* _dbus_build_notify(NotifySession s,
+		const struct _notify_call* c) {
+	struct _dbus_transport_data *d = s->transport_data;
+	DBusMessage *msg;
+	DBusError err;
+
+	if (_notify_wire_marshal_notify(&d->wire, c, d->wire_serial)) {
+		_notify_session_out_of_memory(s);
+		return NULL;
+	}
+	if (++d->wire_serial == 0)
+		d->wire_serial = WIRE_FIRST_SERIAL;
+
+	dbus_error_init(&err);
+	msg = dbus_message_demarshal((const char*) d->wire.data, d->wire.len, &err);
+	if (!msg) {
+		if (dbus_error_has_name(&err, DBUS_ERROR_NO_MEMORY))
+			_notify_session_out_of_memory(s);
+		else /* most likely invalid UTF-8 in one of the strings */
+			notify_session_set_error(s, NOTIFY_ERROR_DBUS_SEND, err.message);
+		dbus_error_free(&err);
+	}
+
+	return msg;
+}
+
+/* returns NULL (and sets the session error) on failure */
+static DBusMessage* _dbus_build_call(NotifySession s,
+		const struct _notify_call* c) {
+	DBusMessage *msg;
+	dbus_uint32_t id = c->id;
+
+	switch (c->method) {
+		case _NOTIFY_CALL_NOTIFY:
+			return _dbus_build_notify(s, c);
+		case _NOTIFY_CALL_CLOSE_NOTIFICATION:
+			msg = dbus_message_new_method_call(
+					"org.freedesktop.Notifications",
+					"/org/freedesktop/Notifications",
+					"org.freedesktop.Notifications",
+					"CloseNotification");
+
+			if (!msg || !dbus_message_append_args(msg,
+						DBUS_TYPE_UINT32, &id,
+						DBUS_TYPE_INVALID)) {
+				if (msg)
+					dbus_message_unref(msg);
+				_notify_session_out_of_memory(s);
+				return NULL;
+			}
+			return msg;
+	}
+
+	assert(!"reached with invalid method");
+	return NULL;
+}
+
+/* get the call result out of a reply message; returns zero on success,
+ * or non-zero with the error message (to be freed, NULL if out of memory)
+ * stored in err_msg */
+static int _dbus_parse_reply(DBusMessage* reply, int method, uint32_t* id,
+		char** err_msg) {
+	DBusError err;
+	dbus_uint32_t new_id;
+	int ret;
+
+	dbus_error_init(&err);
+	if (dbus_set_error_from_message(&err, reply))
+		ret = 0;
+	else if (method == _NOTIFY_CALL_NOTIFY) {
+		ret = dbus_message_get_args(reply, &err,
+				DBUS_TYPE_UINT32, &new_id,
+				DBUS_TYPE_INVALID);
+		if (ret && id)
+			*id = new_id;
+	} else
+		ret = dbus_message_get_args(reply, &err,
+				DBUS_TYPE_INVALID);
+
+	if (ret)
+		return 0;
+
+	*err_msg = strdup(err.message);
+	dbus_error_free(&err);
+	return -1;
+}
+
+static NotifyError _dbus_send(NotifySession s, const struct _notify_call* c,
+		uint32_t* serial) {
+	DBusMessage *msg;
+	dbus_uint32_t msg_serial;
+
+	msg = _dbus_build_call(s, c);
+	_timing_mark(s, NOTIFY_TIMING_MARSHAL);
+	if (!msg)
+		return notify_session_get_error(s);
+	_probe(message__built, s, c->id);
+
+	/* replies will be queued on the connection, and popped by
+	 * _dbus_pop_signal() using the serial; always use the bus since
+	 * that is the connection being read */
+	if (!dbus_connection_send(CONN(s), msg, &msg_serial)) {
+		dbus_message_unref(msg);
+		return _notify_session_out_of_memory(s);
+	}
+	dbus_message_unref(msg);
+	_probe(message__sent, s, c->id);
+
+	*serial = msg_serial;
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+/* send msg over conn and wait for the reply; stores NULL in reply if
+ * the connection is (or became) closed */
+static NotifyError _dbus_call_on(NotifySession s, DBusConnection* conn,
+		DBusMessage* msg, int timeout, uint32_t id, DBusMessage** reply) {
+	DBusPendingCall *pending;
+
+	*reply = NULL;
+	if (!dbus_connection_send_with_reply(conn, msg, &pending,
+				timeout < 0 ? DBUS_TIMEOUT_INFINITE : timeout))
+		return _notify_session_out_of_memory(s);
+	if (!pending)
+		return NOTIFY_ERROR_NO_ERROR;
+
+	/* split writing and waiting to be able to time them separately */
+	dbus_connection_flush(conn);
+	_timing_mark(s, NOTIFY_TIMING_WRITE);
+	_probe(message__sent, s, id);
+
+	dbus_pending_call_block(pending);
+	/* the pending call completes with a reply (or an error reply made up
+	 * by libdbus), unless that couldn't be allocated */
+	*reply = dbus_pending_call_steal_reply(pending);
+	dbus_pending_call_unref(pending);
+	if (!*reply)
+		return _notify_session_out_of_memory(s);
+	_timing_mark(s, NOTIFY_TIMING_REPLY);
+
+	if (dbus_message_get_type(*reply) == DBUS_MESSAGE_TYPE_ERROR
+			&& !dbus_connection_get_is_connected(conn)) {
+		dbus_message_unref(*reply);
+		*reply = NULL;
+	}
+
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+static NotifyError _dbus_send_with_reply(NotifySession s,
+		const struct _notify_call* c, int timeout, uint32_t* id) {
+	struct _dbus_transport_data *d = s->transport_data;
+	DBusMessage *msg, *reply = NULL;
+	NotifyError ret = NOTIFY_ERROR_NO_ERROR;
+	char *err_msg;
+
+	msg = _dbus_build_call(s, c);
+	_timing_mark(s, NOTIFY_TIMING_MARSHAL);
+	if (!msg)
+		return notify_session_get_error(s);
+	_probe(message__built, s, c->id);
+
+	if (d->peer) {
+		ret = _dbus_call_on(s, d->peer, msg, timeout, c->id, &reply);
+		/* the server went away; fall back to the bus (if it has handled
+		 * the call before dying, it will be repeated) */
+		if (!ret && !reply)
+			_dbus_close_peer(d);
+	}
+	if (!ret && !reply)
+		ret = _dbus_call_on(s, d->conn, msg, timeout, c->id, &reply);
+	dbus_message_unref(msg);
+	if (ret)
+		return ret;
+	if (!reply)
+		return notify_session_set_error(s, NOTIFY_ERROR_DBUS_SEND,
+				"Connection is closed");
+
+	if (_dbus_parse_reply(reply, c->method, id, &err_msg)) {
+		if (!err_msg)
+			ret = _notify_session_out_of_memory(s);
+		else if (dbus_message_get_type(reply) != DBUS_MESSAGE_TYPE_ERROR)
+			ret = NOTIFY_ERROR_INVALID_REPLY;
+		/* the bus replies for the server if there is none */
+		else if (dbus_message_is_error(reply, DBUS_ERROR_SERVICE_UNKNOWN)
+				|| dbus_message_is_error(reply, DBUS_ERROR_NAME_HAS_NO_OWNER))
+			ret = NOTIFY_ERROR_NO_SERVER;
+		else
+			ret = NOTIFY_ERROR_DBUS_SEND;
+		if (err_msg)
+			ret = notify_session_set_error(s, ret, err_msg);
+
+		free(err_msg);
+		dbus_message_unref(reply);
+		return ret;
+	}
+
+	dbus_message_unref(reply);
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+static void _dbus_read_write(NotifySession s, int timeout) {
+	dbus_connection_read_write(CONN(s), timeout);
+}
+
+static int _dbus_parse_signal(DBusMessage* msg, struct _notify_signal* sig) {
+	const char *member;
+	int is_notification_closed;
+	int ret;
+
+	/* the bus sends us a few signals on its own (e.g. NameAcquired) */
+	if (!dbus_message_has_interface(msg, "org.freedesktop.Notifications"))
+		return 0;
+
+	member = dbus_message_get_member(msg);
+	is_notification_closed = !strcmp(member, "NotificationClosed");
+	if (is_notification_closed) {
+		sig->type = _NOTIFY_SIGNAL_NOTIFICATION_CLOSED;
+		ret = dbus_message_get_args(msg, NULL,
+				DBUS_TYPE_UINT32, &sig->id,
+				DBUS_TYPE_UINT32, &sig->reason,
+				DBUS_TYPE_INVALID);
+	} else if (!strcmp(member, "ActionInvoked")) {
+		sig->type = _NOTIFY_SIGNAL_ACTION_INVOKED;
+		ret = dbus_message_get_args(msg, NULL,
+				DBUS_TYPE_UINT32, &sig->id,
+				DBUS_TYPE_STRING, &sig->action,
+				DBUS_TYPE_INVALID);
+	} else
+		ret = 0;
+
+	/* XXX: error handling? */
+	return ret;
+}
+
+static int _dbus_pop_signal(NotifySession s, struct _notify_signal* sig) {
+	struct _dbus_transport_data *d = s->transport_data;
+	DBusMessage *msg;
+
+	if (d->last_signal) {
+		dbus_message_unref(d->last_signal);
+		d->last_signal = NULL;
+	}
+	free(d->last_error);
+	d->last_error = NULL;
+
+	while ((msg = dbus_connection_pop_message(d->conn))) {
+		int type = dbus_message_get_type(msg);
+
+		if (type == DBUS_MESSAGE_TYPE_SIGNAL) {
+			if (_dbus_parse_signal(msg, sig)) {
+				d->last_signal = msg;
+				return 1;
+			}
+		} else if (type == DBUS_MESSAGE_TYPE_METHOD_RETURN
+				|| type == DBUS_MESSAGE_TYPE_ERROR) {
+			sig->type = _NOTIFY_SIGNAL_REPLY;
+			sig->serial = dbus_message_get_reply_serial(msg);
+			/* we don't know the method but only Notify returns a value */
+			if (_dbus_parse_reply(msg, dbus_message_get_signature(msg)[0]
+						? _NOTIFY_CALL_NOTIFY : _NOTIFY_CALL_CLOSE_NOTIFICATION,
+						&sig->id, &d->last_error))
+				sig->error_message = d->last_error
+					? d->last_error : "Out of memory";
+			else
+				sig->error_message = NULL;
+			dbus_message_unref(msg);
+			return 1;
+		}
+
+		dbus_message_unref(msg);
+	}
+
+	return 0;
+}
+
+static char* _dbus_get_server_name(NotifySession s) {
+	DBusMessage *msg, *reply;
+	const char *name = "org.freedesktop.Notifications";
+	char *bus_id, *ret = NULL;
+
+	/* the unique name changes whenever the server is restarted, but it is
+	 * reused by the next bus instance */
+	if (!(bus_id = dbus_bus_get_id(CONN(s), NULL)))
+		return NULL;
+
+	msg = dbus_message_new_method_call(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+			DBUS_INTERFACE_DBUS, "GetNameOwner");
+	if (!msg || !dbus_message_append_args(msg, DBUS_TYPE_STRING, &name,
+				DBUS_TYPE_INVALID))
+		reply = NULL;
+	else
+		reply = dbus_connection_send_with_reply_and_block(CONN(s), msg,
+				DBUS_TIMEOUT_USE_DEFAULT, NULL);
+	if (msg)
+		dbus_message_unref(msg);
+
+	if (reply && dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &name,
+				DBUS_TYPE_INVALID)
+			&& asprintf(&ret, "%s/%s", bus_id, name) == -1)
+		ret = NULL;
+	if (reply)
+		dbus_message_unref(reply);
+	dbus_free(bus_id);
+	return ret;
+}
+
+static int _dbus_get_fd(NotifySession s) {
+	int fd;
+
+	if (!dbus_connection_get_unix_fd(CONN(s), &fd))
+		return -1;
+	return fd;
+}
+
+static const struct notify_transport _transport_dbus = {
+	"dbus",
+
+	_dbus_connect,
+	_dbus_disconnect,
+	_dbus_is_connected,
+
+	_dbus_watch_signals,
+
+	_dbus_send,
+	_dbus_send_with_reply,
+
+	_dbus_read_write,
+	_dbus_pop_signal,
+	_dbus_get_fd,
+
+	_dbus_is_peer_connected,
+	_dbus_get_server_name
+};
+
+const NotifyTransport NOTIFY_TRANSPORT_DBUS = &_transport_dbus;
@@ -0,0 +1,214 @@
+/* libtinynotify -- in-process loopback transport
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+#include "timing.h"
+#include "transport.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "event_.h"
+#include "timing_.h"
+#include "transport_.h"
+#include "memory_.h"
+#include "probes_.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+struct _loopback_transport_data {
+	uint32_t last_id;
+	uint32_t last_serial;
+
+	struct _notify_signal_queue queue;
+	/* created on first get_fd() call; readable iff signals are queued */
+	int pipe_fds[2];
+};
+
+#define DATA(s) ((struct _loopback_transport_data*) (s)->transport_data)
+
+static void _loopback_wake(struct _loopback_transport_data* d) {
+	const char c = 0;
+
+	while (write(d->pipe_fds[1], &c, 1) == -1 && errno == EINTR);
+}
+
+static void _loopback_queue_signal(NotifySession s,
+		const struct _notify_signal* sig, const char* action) {
+	struct _loopback_transport_data *d = DATA(s);
+
+	if (_notify_signal_queue_push(&d->queue, sig, action)
+			&& d->pipe_fds[1] != -1)
+		_loopback_wake(d);
+}
+
+static NotifyError _loopback_connect(NotifySession s) {
+	struct _loopback_transport_data *d;
+
+	if (!(d = malloc(sizeof(*d))))
+		return _notify_session_out_of_memory(s);
+	d->last_id = 0;
+	d->last_serial = 0;
+	_notify_signal_queue_init(&d->queue, s);
+	d->pipe_fds[0] = d->pipe_fds[1] = -1;
+	s->transport_data = d;
+
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+static void _loopback_disconnect(NotifySession s) {
+	struct _loopback_transport_data *d = DATA(s);
+
+	_notify_signal_queue_clear(&d->queue);
+	if (d->pipe_fds[0] != -1) {
+		close(d->pipe_fds[0]);
+		close(d->pipe_fds[1]);
+	}
+
+	free(d);
+	s->transport_data = NULL;
+}
+
+static int _loopback_is_connected(NotifySession s) {
+	return 1;
+}
+
+static NotifyError _loopback_watch_signals(NotifySession s) {
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+/* emulate the server side of the call */
+static uint32_t _loopback_handle_call(NotifySession s,
+		const struct _notify_call* c) {
+	struct _loopback_transport_data *d = DATA(s);
+	struct _notify_signal sig;
+
+	memset(&sig, 0, sizeof(sig));
+	_probe(message__built, s, c->id);
+	_timing_mark(s, NOTIFY_TIMING_MARSHAL);
+	_probe(message__sent, s, c->id);
+
+	switch (c->method) {
+		case _NOTIFY_CALL_NOTIFY:
+			sig.id = c->id ? c->id : ++d->last_id;
+			if (c->actions) {
+				sig.type = _NOTIFY_SIGNAL_ACTION_INVOKED;
+				_loopback_queue_signal(s, &sig, c->actions->key);
+			}
+			break;
+		case _NOTIFY_CALL_CLOSE_NOTIFICATION:
+			sig.type = _NOTIFY_SIGNAL_NOTIFICATION_CLOSED;
+			sig.id = c->id;
+			sig.reason = 3;
+			_loopback_queue_signal(s, &sig, NULL);
+			break;
+	}
+
+	return sig.id;
+}
+
+static NotifyError _loopback_send(NotifySession s,
+		const struct _notify_call* c, uint32_t* serial) {
+	struct _notify_signal reply;
+
+	memset(&reply, 0, sizeof(reply));
+	reply.type = _NOTIFY_SIGNAL_REPLY;
+	reply.id = _loopback_handle_call(s, c);
+	reply.serial = *serial = ++DATA(s)->last_serial;
+	_loopback_queue_signal(s, &reply, NULL);
+
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+static NotifyError _loopback_send_with_reply(NotifySession s,
+		const struct _notify_call* c, int timeout, uint32_t* id) {
+	uint32_t new_id = _loopback_handle_call(s, c);
+
+	if (id)
+		*id = new_id;
+	_timing_mark(s, NOTIFY_TIMING_REPLY);
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+static void _loopback_read_write(NotifySession s, int timeout) {
+	struct _loopback_transport_data *d = DATA(s);
+
+	/* nothing will ever arrive, so just honour a finite timeout
+	 * (waiting forever would never return) */
+	if (_notify_signal_queue_empty(&d->queue) && timeout > 0)
+		poll(NULL, 0, timeout);
+}
+
+static int _loopback_pop_signal(NotifySession s, struct _notify_signal* sig) {
+	struct _loopback_transport_data *d = DATA(s);
+
+	if (!_notify_signal_queue_pop(&d->queue, sig))
+		return 0;
+
+	if (_notify_signal_queue_empty(&d->queue) && d->pipe_fds[0] != -1) {
+		char c;
+
+		while (read(d->pipe_fds[0], &c, 1) == -1 && errno == EINTR);
+	}
+	return 1;
+}
+
+static int _loopback_get_fd(NotifySession s) {
+	struct _loopback_transport_data *d = DATA(s);
+
+	if (d->pipe_fds[0] == -1) {
+		if (pipe(d->pipe_fds))
+			return -1;
+		fcntl(d->pipe_fds[0], F_SETFD, FD_CLOEXEC);
+		fcntl(d->pipe_fds[1], F_SETFD, FD_CLOEXEC);
+
+		if (!_notify_signal_queue_empty(&d->queue))
+			_loopback_wake(d);
+	}
+
+	return d->pipe_fds[0];
+}
+
+static int _loopback_is_peer_connected(NotifySession s) {
+	return 0;
+}
+
+static char* _loopback_get_server_name(NotifySession s) {
+	/* the IDs start over with every connection */
+	return NULL;
+}
+
+static const struct notify_transport _transport_loopback = {
+	"loopback",
+
+	_loopback_connect,
+	_loopback_disconnect,
+	_loopback_is_connected,
+
+	_loopback_watch_signals,
+
+	_loopback_send,
+	_loopback_send_with_reply,
+
+	_loopback_read_write,
+	_loopback_pop_signal,
+	_loopback_get_fd,
+
+	_loopback_is_peer_connected,
+	_loopback_get_server_name
+};
+
+const NotifyTransport NOTIFY_TRANSPORT_LOOPBACK = &_transport_loopback;
@@ -0,0 +1,503 @@
+/* libtinynotify -- D-Bus transport using sd-bus
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+#include "timing.h"
+#include "transport.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "event_.h"
+#include "timing_.h"
+#include "transport_.h"
+#include "memory_.h"
+#include "probes_.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <systemd/sd-bus.h>
+
+/* This is an alternative implementation of NOTIFY_TRANSPORT_DBUS, used
+ * instead of transport-dbus.c when configured --with-dbus-backend=sd-bus.
+ * sd-bus appends the arguments straight into the message buffer and doesn't
+ * do any locking, which makes the send path considerably cheaper.
+ *
+ * sd-bus dispatches signals to match callbacks; these only parse
+ * the signal and queue it for pop_signal(). */
+
+#define NOTIFY_DEST "org.freedesktop.Notifications"
+#define NOTIFY_PATH "/org/freedesktop/Notifications"
+#define NOTIFY_IFACE "org.freedesktop.Notifications"
+
+struct _sdbus_transport_data {
+	sd_bus *bus;
+	/* direct connection to the notification server, if any */
+	sd_bus *peer;
+
+	struct _notify_signal_queue queue;
+	/* set when the add_match() calls were done */
+	int watching;
+};
+
+#define DATA(s) ((struct _sdbus_transport_data*) (s)->transport_data)
+
+/* get the peer address from the environment, or the server capabilities */
+static char* _sdbus_get_peer_address(sd_bus* bus) {
+	const char *env = getenv(_NOTIFY_PEER_ADDRESS_ENV);
+	sd_bus_message *reply;
+	const char *cap;
+	char *ret = NULL;
+
+	if (env && *env)
+		return strdup(env);
+
+	if (sd_bus_call_method(bus, NOTIFY_DEST, NOTIFY_PATH, NOTIFY_IFACE,
+				"GetCapabilities", NULL, &reply, "") < 0)
+		return NULL;
+
+	if (sd_bus_message_enter_container(reply, 'a', "s") > 0) {
+		while (sd_bus_message_read_basic(reply, 's', &cap) > 0) {
+			if (!strncmp(cap, _NOTIFY_PEER_CAPABILITY,
+						strlen(_NOTIFY_PEER_CAPABILITY))) {
+				/* the peer is optional, so NULL on failure is fine */
+				ret = strdup(cap + strlen(_NOTIFY_PEER_CAPABILITY));
+				break;
+			}
+		}
+	}
+
+	sd_bus_message_unref(reply);
+	return ret;
+}
+
+static sd_bus* _sdbus_open_peer(sd_bus* bus) {
+	sd_bus *peer;
+	char *address = _sdbus_get_peer_address(bus);
+
+	if (!address)
+		return NULL;
+
+	/* failing is fine, we'll just use the bus */
+	if (sd_bus_new(&peer) < 0)
+		peer = NULL;
+	else if (sd_bus_set_address(peer, address) < 0
+			|| sd_bus_start(peer) < 0)
+		peer = sd_bus_flush_close_unref(peer);
+	free(address);
+
+	return peer;
+}
+
+static NotifyError _sdbus_connect(NotifySession s) {
+	struct _sdbus_transport_data *d;
+	sd_bus *bus;
+	int r;
+
+	r = sd_bus_open_user(&bus);
+	if (r < 0)
+		return notify_session_set_error(s, NOTIFY_ERROR_DBUS_CONNECT,
+				strerror(-r));
+
+	if (!(d = malloc(sizeof(*d)))) {
+		sd_bus_flush_close_unref(bus);
+		return _notify_session_out_of_memory(s);
+	}
+	d->bus = bus;
+	d->peer = s->peer_to_peer ? _sdbus_open_peer(bus) : NULL;
+	_notify_signal_queue_init(&d->queue, s);
+	d->watching = 0;
+	s->transport_data = d;
+
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+static void _sdbus_disconnect(NotifySession s) {
+	struct _sdbus_transport_data *d = DATA(s);
+
+	/* drops the floating match and reply slots as well */
+	sd_bus_flush_close_unref(d->bus);
+	sd_bus_flush_close_unref(d->peer);
+	_notify_signal_queue_clear(&d->queue);
+
+	free(d);
+	s->transport_data = NULL;
+}
+
+static int _sdbus_is_connected(NotifySession s) {
+	return sd_bus_is_open(DATA(s)->bus) > 0;
+}
+
+static int _sdbus_is_peer_connected(NotifySession s) {
+	struct _sdbus_transport_data *d = DATA(s);
+
+	return d->peer && sd_bus_is_open(d->peer) > 0;
+}
+
+static int _sdbus_on_closed(sd_bus_message* m, void* userdata,
+		sd_bus_error* ret_error) {
+	NotifySession s = userdata;
+	struct _notify_signal sig;
+
+	memset(&sig, 0, sizeof(sig));
+	sig.type = _NOTIFY_SIGNAL_NOTIFICATION_CLOSED;
+	/* XXX: error handling? */
+	if (sd_bus_message_read(m, "uu", &sig.id, &sig.reason) > 0)
+		_notify_signal_queue_push(&DATA(s)->queue, &sig, NULL);
+	return 0;
+}
+
+static int _sdbus_on_action(sd_bus_message* m, void* userdata,
+		sd_bus_error* ret_error) {
+	NotifySession s = userdata;
+	struct _notify_signal sig;
+	const char *action;
+
+	memset(&sig, 0, sizeof(sig));
+	sig.type = _NOTIFY_SIGNAL_ACTION_INVOKED;
+	if (sd_bus_message_read(m, "us", &sig.id, &action) > 0)
+		_notify_signal_queue_push(&DATA(s)->queue, &sig, action);
+	return 0;
+}
+
+static NotifyError _sdbus_watch_signals(NotifySession s) {
+	struct _sdbus_transport_data *d = DATA(s);
+	sd_bus_slot *closed_slot;
+	int r;
+
+	if (d->watching)
+		return NOTIFY_ERROR_NO_ERROR;
+
+	r = sd_bus_add_match(d->bus, &closed_slot, "type='signal',"
+			"interface='" NOTIFY_IFACE "',"
+			"member='NotificationClosed'", _sdbus_on_closed, s);
+	if (r >= 0) {
+		r = sd_bus_add_match(d->bus, NULL, "type='signal',"
+				"interface='" NOTIFY_IFACE "',"
+				"member='ActionInvoked'", _sdbus_on_action, s);
+		/* don't leave a duplicate behind for the next attempt */
+		if (r < 0)
+			sd_bus_slot_unref(closed_slot);
+		else
+			sd_bus_slot_set_floating(closed_slot, 1);
+	}
+	if (r < 0)
+		return notify_session_set_error(s, NOTIFY_ERROR_DBUS_SEND,
+				strerror(-r));
+	d->watching = 1;
+
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+/* bail out of a builder on the first failure */
+#define SDBUS_TRY(x) \
+	do { int _r = (x); if (_r < 0) return _r; } while (0)
+
+/* sd-bus can't take the pre-encoded entries, so append the values */
+static int _sdbus_append_hint(sd_bus_message* m,
+		const struct _notification_hint* h) {
+	const void *value = h->blob + h->value_offset;
+	const char sig[3] = { h->type, h->type == 'a' ? 'y' : 0, 0 };
+
+	SDBUS_TRY(sd_bus_message_open_container(m, 'e', "sv"));
+	SDBUS_TRY(sd_bus_message_append_basic(m, 's',
+				_notification_hint_key(h)));
+	SDBUS_TRY(sd_bus_message_open_container(m, 'v', sig));
+	if (h->type == 'a')
+		SDBUS_TRY(sd_bus_message_append_array(m, 'y',
+					value, h->value_len));
+	else if (h->type == 's')
+		SDBUS_TRY(sd_bus_message_append_basic(m, 's', value));
+	else
+		SDBUS_TRY(sd_bus_message_append_basic(m, h->type, value));
+	SDBUS_TRY(sd_bus_message_close_container(m));
+	return sd_bus_message_close_container(m);
+}
+
+/* the values are read back from the encoded (iiibiiay) struct */
+static int _sdbus_append_image_hint(sd_bus_message* m,
+		const struct _notification_hint* h) {
+	const unsigned char *value = h->blob + h->value_offset;
+	int32_t ints[6];
+	uint32_t len;
+
+	memcpy(ints, value, sizeof(ints));
+	memcpy(&len, value + sizeof(ints), sizeof(len));
+
+	SDBUS_TRY(sd_bus_message_open_container(m, 'e', "sv"));
+	SDBUS_TRY(sd_bus_message_append_basic(m, 's',
+				_notification_hint_key(h)));
+	SDBUS_TRY(sd_bus_message_open_container(m, 'v', "(iiibiiay)"));
+	SDBUS_TRY(sd_bus_message_open_container(m, 'r', "iiibiiay"));
+	SDBUS_TRY(sd_bus_message_append(m, "iiibii", ints[0], ints[1],
+				ints[2], ints[3], ints[4], ints[5]));
+	SDBUS_TRY(sd_bus_message_append_array(m, 'y',
+				value + sizeof(ints) + sizeof(len), len));
+	SDBUS_TRY(sd_bus_message_close_container(m));
+	SDBUS_TRY(sd_bus_message_close_container(m));
+	return sd_bus_message_close_container(m);
+}
+
+static int _sdbus_append_notify(sd_bus_message* m,
+		const struct _notify_call* c) {
+	const struct _notification_action_list *al;
+	const struct _notification_hint *h;
+	char *body;
+
+	SDBUS_TRY(sd_bus_message_append(m, "suss", c->app_name, c->id,
+				c->app_icon, c->summary));
+	/* the body doesn't have to be NUL-terminated */
+	SDBUS_TRY(sd_bus_message_append_string_space(m, c->body_len, &body));
+	memcpy(body, c->body, c->body_len);
+
+	SDBUS_TRY(sd_bus_message_open_container(m, 'a', "s"));
+	for (al = c->actions; al; al = al->next)
+		SDBUS_TRY(sd_bus_message_append(m, "ss", al->key, al->desc));
+	SDBUS_TRY(sd_bus_message_close_container(m));
+
+	SDBUS_TRY(sd_bus_message_open_container(m, 'a', "{sv}"));
+	for (h = c->default_hints; h; h = h->next) {
+		if (!_notification_hints_contain(c->hints,
+					_notification_hint_key(h)))
+			SDBUS_TRY(_sdbus_append_hint(m, h));
+	}
+	for (h = c->hints; h; h = h->next)
+		SDBUS_TRY(_sdbus_append_hint(m, h));
+	if (c->image)
+		SDBUS_TRY(_sdbus_append_image_hint(m, c->image));
+	SDBUS_TRY(sd_bus_message_close_container(m));
+
+	return sd_bus_message_append_basic(m, 'i', &c->expire_timeout);
+}
+
+/* returns a negative errno on failure */
+static int _sdbus_build_call(sd_bus* bus, const struct _notify_call* c,
+		sd_bus_message** ret) {
+	sd_bus_message *m;
+	int r;
+
+	r = sd_bus_message_new_method_call(bus, &m, NOTIFY_DEST, NOTIFY_PATH,
+			NOTIFY_IFACE, c->method == _NOTIFY_CALL_NOTIFY
+				? "Notify" : "CloseNotification");
+	if (r < 0)
+		return r;
+
+	if (c->method == _NOTIFY_CALL_NOTIFY)
+		r = _sdbus_append_notify(m, c);
+	else
+		r = sd_bus_message_append_basic(m, 'u', &c->id);
+
+	if (r < 0) {
+		sd_bus_message_unref(m);
+		return r;
+	}
+	*ret = m;
+	return 0;
+}
+
+/* set the session error for a failed call */
+static NotifyError _sdbus_set_error(NotifySession s, int r,
+		const sd_bus_error* err) {
+	if (r == -ENOMEM)
+		return _notify_session_out_of_memory(s);
+	/* the bus replies for the server if there is none */
+	if (err && (sd_bus_error_has_name(err, SD_BUS_ERROR_SERVICE_UNKNOWN)
+				|| sd_bus_error_has_name(err, SD_BUS_ERROR_NAME_HAS_NO_OWNER)))
+		return notify_session_set_error(s, NOTIFY_ERROR_NO_SERVER,
+				err->message);
+	return notify_session_set_error(s, NOTIFY_ERROR_DBUS_SEND,
+			err && sd_bus_error_is_set(err) ? err->message : strerror(-r));
+}
+
+static uint64_t _sdbus_timeout_usec(int timeout) {
+	/* zero means the sd-bus default (25 s) */
+	return timeout < 0 ? UINT64_MAX : (uint64_t) timeout * 1000;
+}
+
+static int _sdbus_on_reply(sd_bus_message* m, void* userdata,
+		sd_bus_error* ret_error) {
+	NotifySession s = userdata;
+	struct _notify_signal sig;
+	const sd_bus_error *err;
+	uint64_t cookie;
+
+	memset(&sig, 0, sizeof(sig));
+	sig.type = _NOTIFY_SIGNAL_REPLY;
+	if (sd_bus_message_get_reply_cookie(m, &cookie) >= 0)
+		sig.serial = cookie;
+
+	err = sd_bus_message_get_error(m);
+	/* only Notify returns a value */
+	if (!err && !strcmp(sd_bus_message_get_signature(m, 1), "u"))
+		sd_bus_message_read_basic(m, 'u', &sig.id);
+
+	_notify_signal_queue_push(&DATA(s)->queue, &sig,
+			err ? err->message : NULL);
+	return 0;
+}
+
+static NotifyError _sdbus_send(NotifySession s, const struct _notify_call* c,
+		uint32_t* serial) {
+	sd_bus_message *m;
+	uint64_t cookie;
+	int r;
+
+	/* replies are dispatched from the bus connection only */
+	r = _sdbus_build_call(DATA(s)->bus, c, &m);
+	_timing_mark(s, NOTIFY_TIMING_MARSHAL);
+	if (r < 0)
+		return _sdbus_set_error(s, r, NULL);
+	_probe(message__built, s, c->id);
+
+	r = sd_bus_call_async(DATA(s)->bus, NULL, m, _sdbus_on_reply, s,
+			_sdbus_timeout_usec(_NOTIFY_TRANSPORT_NO_TIMEOUT));
+	if (r >= 0)
+		r = sd_bus_message_get_cookie(m, &cookie);
+	sd_bus_message_unref(m);
+	if (r < 0)
+		return _sdbus_set_error(s, r, NULL);
+	_probe(message__sent, s, c->id);
+
+	*serial = cookie;
+	return NOTIFY_ERROR_NO_ERROR;
+}
+
+/* sd_bus_call() writes and waits in one go; signals arriving meanwhile
+ * are queued and dispatched by pop_signal() */
+static int _sdbus_call_on(NotifySession s, sd_bus* bus,
+		const struct _notify_call* c, int timeout, sd_bus_error* err,
+		sd_bus_message** reply) {
+	sd_bus_message *m;
+	int r;
+
+	r = _sdbus_build_call(bus, c, &m);
+	_timing_mark(s, NOTIFY_TIMING_MARSHAL);
+	if (r < 0)
+		return r;
+	_probe(message__built, s, c->id);
+
+	r = sd_bus_call(bus, m, _sdbus_timeout_usec(timeout), err, reply);
+	sd_bus_message_unref(m);
+	_probe(message__sent, s, c->id);
+	_timing_mark(s, NOTIFY_TIMING_REPLY);
+
+	return r;
+}
+
+static NotifyError _sdbus_send_with_reply(NotifySession s,
+		const struct _notify_call* c, int timeout, uint32_t* id) {
+	struct _sdbus_transport_data *d = DATA(s);
+	sd_bus_message *reply = NULL;
+	sd_bus_error err = SD_BUS_ERROR_NULL;
+	NotifyError ret = NOTIFY_ERROR_NO_ERROR;
+	int r = -ENOTCONN;
+
+	if (d->peer) {
+		r = _sdbus_call_on(s, d->peer, c, timeout, &err, &reply);
+		/* the server went away; fall back to the bus (if it has handled
+		 * the call before dying, it will be repeated) */
+		if (r < 0 && sd_bus_is_open(d->peer) <= 0) {
+			d->peer = sd_bus_flush_close_unref(d->peer);
+			sd_bus_error_free(&err);
+		}
+	}
+	if (!d->peer)
+		r = _sdbus_call_on(s, d->bus, c, timeout, &err, &reply);
+
+	if (r < 0)
+		ret = _sdbus_set_error(s, r, &err);
+	else if (c->method == _NOTIFY_CALL_NOTIFY) {
+		uint32_t new_id;
+
+		r = sd_bus_message_read_basic(reply, 'u', &new_id);
+		if (r <= 0)
+			ret = notify_session_set_error(s, NOTIFY_ERROR_INVALID_REPLY,
+					r < 0 ? strerror(-r) : "Missing notification ID");
+		else if (id)
+			*id = new_id;
+	}
+
+	sd_bus_error_free(&err);
+	sd_bus_message_unref(reply);
+	return ret;
+}
+
+static char* _sdbus_get_server_name(NotifySession s) {
+	sd_bus_message *id_reply, *reply;
+	const char *bus_id, *name;
+	char *ret = NULL;
+
+	/* the unique name changes whenever the server is restarted, but it is
+	 * reused by the next bus instance */
+	if (sd_bus_call_method(DATA(s)->bus, "org.freedesktop.DBus",
+				"/org/freedesktop/DBus", "org.freedesktop.DBus",
+				"GetId", NULL, &id_reply, "") < 0)
+		return NULL;
+	if (sd_bus_call_method(DATA(s)->bus, "org.freedesktop.DBus",
+				"/org/freedesktop/DBus", "org.freedesktop.DBus",
+				"GetNameOwner", NULL, &reply, "s", NOTIFY_DEST) < 0) {
+		sd_bus_message_unref(id_reply);
+		return NULL;
+	}
+
+	if (sd_bus_message_read(id_reply, "s", &bus_id) > 0
+			&& sd_bus_message_read(reply, "s", &name) > 0
+			&& asprintf(&ret, "%s/%s", bus_id, name) == -1)
+		ret = NULL;
+	sd_bus_message_unref(reply);
+	sd_bus_message_unref(id_reply);
+	return ret;
+}
+
+static void _sdbus_read_write(NotifySession s, int timeout) {
+	sd_bus_wait(DATA(s)->bus, _sdbus_timeout_usec(timeout));
+}
+
+static int _sdbus_pop_signal(NotifySession s, struct _notify_signal* sig) {
+	struct _sdbus_transport_data *d = DATA(s);
+
+	/* dispatch everything read so far into the queue */
+	while (_notify_signal_queue_empty(&d->queue)
+			&& sd_bus_process(d->bus, NULL) > 0);
+
+	return _notify_signal_queue_pop(&d->queue, sig);
+}
+
+static int _sdbus_get_fd(NotifySession s) {
+	int fd = sd_bus_get_fd(DATA(s)->bus);
+
+	return fd < 0 ? -1 : fd;
+}
+
+static const struct notify_transport _transport_dbus = {
+	"sd-bus",
+
+	_sdbus_connect,
+	_sdbus_disconnect,
+	_sdbus_is_connected,
+
+	_sdbus_watch_signals,
+
+	_sdbus_send,
+	_sdbus_send_with_reply,
+
+	_sdbus_read_write,
+	_sdbus_pop_signal,
+	_sdbus_get_fd,
+
+	_sdbus_is_peer_connected,
+	_sdbus_get_server_name
+};
+
+const NotifyTransport NOTIFY_TRANSPORT_DBUS = &_transport_dbus;
@@ -0,0 +1,169 @@
+/* libtinynotify -- message transports
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "transport.h"
+
+#include "common_.h"
+#include "session_.h"
+#include "notification_.h"
+#include "event_.h"
+#include "transport_.h"
+#include "stats_.h"
+#include "memory_.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+NotifyError _notify_transport_call(NotifySession s,
+		const struct _notify_call* c, int timeout, uint32_t* id) {
+	NotifyError ret;
+
+	_notify_stats_call_begin(s);
+	ret = s->transport->send_with_reply(s, c, timeout, id);
+	_notify_stats_call_end(s);
+
+	if (ret)
+		return ret;
+	return notify_session_set_error(s, NOTIFY_ERROR_NO_ERROR);
+}
+
+size_t _notify_call_size(const struct _notify_call* c) {
+	const struct _notification_action_list *al;
+	const struct _notification_hint *h;
+	/* the header and the padding */
+	size_t ret = 256;
+
+	if (c->method != _NOTIFY_CALL_NOTIFY)
+		return ret;
+
+	ret += strlen(c->app_name) + strlen(c->app_icon)
+		+ strlen(c->summary) + c->body_len;
+	for (al = c->actions; al; al = al->next)
+		ret += strlen(al->key) + strlen(al->desc) + 16;
+	for (h = c->default_hints; h; h = h->next)
+		ret += h->len + 8;
+	for (h = c->hints; h; h = h->next)
+		ret += h->len + 8;
+	if (c->image)
+		ret += c->image->len + 8;
+
+	return ret;
+}
+
+void _notify_signal_queue_init(struct _notify_signal_queue* q,
+		NotifySession s) {
+	q->first = NULL;
+	q->last = &q->first;
+	q->popped = NULL;
+	q->session = s;
+}
+
+/* the memory charged against the session budget */
+static size_t _notify_queued_signal_size(const struct _notify_queued_signal* qs) {
+	return sizeof(*qs) + (qs->str ? strlen(qs->str) + 1 : 0);
+}
+
+static void _notify_queued_signal_free(struct _notify_signal_queue* q,
+		struct _notify_queued_signal* qs) {
+	_notify_mem_release(q->session, _notify_queued_signal_size(qs));
+	free(qs->str);
+	free(qs);
+}
+
+void _notify_signal_queue_clear(struct _notify_signal_queue* q) {
+	struct _notify_queued_signal *qs, *next;
+
+	for (qs = q->first; qs; qs = next) {
+		next = qs->next;
+		_notify_queued_signal_free(q, qs);
+	}
+	if (q->popped)
+		_notify_queued_signal_free(q, q->popped);
+
+	_notify_signal_queue_init(q, q->session);
+}
+
+int _notify_signal_queue_push(struct _notify_signal_queue* q,
+		const struct _notify_signal* sig, const char* str) {
+	struct _notify_queued_signal *qs;
+	int was_empty = _notify_signal_queue_empty(q);
+
+	if (!(qs = malloc(sizeof(*qs))))
+		goto oom;
+	qs->sig = *sig;
+	if (!str)
+		qs->str = NULL;
+	else if (!(qs->str = strdup(str))) {
+		free(qs);
+		goto oom;
+	}
+	if (_notify_mem_charge(q->session, _notify_queued_signal_size(qs))) {
+		free(qs->str);
+		free(qs);
+		goto drop;
+	}
+	if (sig->type == _NOTIFY_SIGNAL_REPLY)
+		qs->sig.error_message = qs->str;
+	else
+		qs->sig.action = qs->str;
+	qs->next = NULL;
+
+	*q->last = qs;
+	q->last = &qs->next;
+	return was_empty;
+
+oom:
+	_mem_check(q->session->mem.recoverable);
+drop:
+	_stats_inc(q->session, signals_dropped);
+	return 0;
+}
+
+int _notify_signal_queue_pop(struct _notify_signal_queue* q,
+		struct _notify_signal* sig) {
+	struct _notify_queued_signal *qs = q->first;
+
+	if (q->popped) {
+		_notify_queued_signal_free(q, q->popped);
+		q->popped = NULL;
+	}
+	if (!qs)
+		return 0;
+
+	q->first = qs->next;
+	if (!q->first)
+		q->last = &q->first;
+
+	q->popped = qs;
+	*sig = qs->sig;
+	return 1;
+}
+
+void notify_session_set_transport(NotifySession s, NotifyTransport transport) {
+	if (transport != s->transport) {
+		notify_session_disconnect(s);
+		s->transport = transport;
+	}
+}
+
+void notify_session_set_peer_to_peer(NotifySession s, int enabled) {
+	s->peer_to_peer = enabled;
+}
+
+int notify_session_is_peer_connected(NotifySession s) {
+	if (!s->transport_data)
+		return 0;
+	return s->transport->is_peer_connected(s);
+}
+
+int notify_session_get_fd(NotifySession s) {
+	if (!s->transport_data)
+		return -1;
+	return s->transport->get_fd(s);
+}
@@ -0,0 +1,113 @@
+/* libtinynotify -- message transports
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_TRANSPORT_H
+#define _TINYNOTIFY_TRANSPORT_H
+
+/**
+ * SECTION: NotifyTransport
+ * @short_description: API to choose how notifications are delivered
+ * @include: tinynotify.h
+ *
+ * A #NotifySession delivers notifications to the server through
+ * a transport. By default, %NOTIFY_TRANSPORT_DBUS is used which talks to
+ * the notification daemon over the D-Bus session bus.
+ *
+ * %NOTIFY_TRANSPORT_LOOPBACK emulates a notification server within
+ * the process instead. It is mostly useful for testing and benchmarking
+ * applications (and libtinynotify itself) without a message bus.
+ */
+
+/**
+ * NotifyTransport
+ *
+ * A type describing a transport. One of the predefined %NOTIFY_TRANSPORT_*
+ * constants has to be used.
+ */
+
+typedef const struct notify_transport* NotifyTransport;
+
+/**
+ * NOTIFY_TRANSPORT_DBUS
+ *
+ * The default transport, delivering notifications over the D-Bus session
+ * bus.
+ */
+extern const NotifyTransport NOTIFY_TRANSPORT_DBUS;
+
+/**
+ * NOTIFY_TRANSPORT_LOOPBACK
+ *
+ * An in-process transport emulating a notification server.
+ *
+ * The emulated server assigns consecutive IDs to new notifications,
+ * emits the NotificationClosed signal when notification_close() is used,
+ * and invokes the first action of each notification immediately (as if
+ * the user clicked it). The signals are delivered through
+ * notify_session_dispatch() as usual.
+ */
+extern const NotifyTransport NOTIFY_TRANSPORT_LOOPBACK;
+
+/**
+ * notify_session_set_transport
+ * @session: session to operate on
+ * @transport: the new transport
+ *
+ * Set the transport used by @session. If @session is connected using
+ * another transport, it is disconnected first.
+ */
+void notify_session_set_transport(NotifySession session,
+		NotifyTransport transport);
+
+/**
+ * notify_session_set_peer_to_peer
+ * @session: session to operate on
+ * @enabled: zero (false) to disable, non-zero (true) to enable
+ *
+ * Enable or disable connecting directly to the notification server.
+ *
+ * When enabled, notify_session_connect() tries to open a private connection
+ * to the notification server in addition to the bus connection. Notify and
+ * CloseNotification calls then go straight to the server, without passing
+ * through the bus daemon. Signals are still received over the bus.
+ *
+ * The server address is taken from the TINYNOTIFY_PEER_ADDRESS environment
+ * variable. If it is unset, the server is asked for its capabilities, and
+ * a 'x-tinynotify-peer:&lt;address&gt;' capability is looked up.
+ *
+ * If no address is known, or the connection fails (or breaks later), the bus
+ * is used transparently. The setting takes effect on the next connect.
+ * Only %NOTIFY_TRANSPORT_DBUS supports direct connections.
+ */
+void notify_session_set_peer_to_peer(NotifySession session, int enabled);
+
+/**
+ * notify_session_is_peer_connected
+ * @session: session to operate on
+ *
+ * Check whether @session has a working direct connection to the notification
+ * server (see notify_session_set_peer_to_peer()).
+ *
+ * Returns: non-zero if calls are sent directly to the server
+ */
+int notify_session_is_peer_connected(NotifySession session);
+
+/**
+ * notify_session_get_fd
+ * @session: session to operate on
+ *
+ * Get the file descriptor which becomes readable when there are new events
+ * to be processed by notify_session_dispatch(). It can be used to integrate
+ * libtinynotify with an external main loop.
+ *
+ * The file descriptor is valid as long as the session stays connected.
+ *
+ * Returns: a file descriptor, or -1 if not connected (or the transport
+ * doesn't provide one)
+ */
+int notify_session_get_fd(NotifySession session);
+
+#endif /*_TINYNOTIFY_TRANSPORT_H*/
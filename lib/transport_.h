@@ -0,0 +1,146 @@
+/* libtinynotify -- message transports
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_TRANSPORT__H
+#define _TINYNOTIFY_TRANSPORT__H
+
+#include <stdint.h>
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "transport.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+/* wait for the reply as long as necessary */
+#define _NOTIFY_TRANSPORT_NO_TIMEOUT -1
+
+/* direct connections to the notification server */
+#define _NOTIFY_PEER_ADDRESS_ENV "TINYNOTIFY_PEER_ADDRESS"
+#define _NOTIFY_PEER_CAPABILITY "x-tinynotify-peer:"
+
+/* a method call to the notification server */
+struct _notify_call {
+	enum {
+		_NOTIFY_CALL_NOTIFY,
+		_NOTIFY_CALL_CLOSE_NOTIFICATION
+	} method;
+
+	/* replaces_id for Notify, id for CloseNotification */
+	uint32_t id;
+
+	/* Notify only */
+	const char* app_name;
+	const char* app_icon;
+	const char* summary;
+	/* not necessarily NUL-terminated */
+	const char* body;
+	size_t body_len;
+	const struct _notification_action_list* actions;
+	const struct _notification_hint* hints;
+	/* session defaults, skipped where overridden by hints */
+	const struct _notification_hint* default_hints;
+	/* the encoded 'image-data' hint, or NULL */
+	const struct _notification_hint* image;
+	int32_t expire_timeout;
+};
+
+/* a signal from the notification server, or a reply to send() */
+struct _notify_signal {
+	enum {
+		_NOTIFY_SIGNAL_NOTIFICATION_CLOSED,
+		_NOTIFY_SIGNAL_ACTION_INVOKED,
+		_NOTIFY_SIGNAL_REPLY
+	} type;
+
+	uint32_t id;
+	/* NotificationClosed: the protocol close reason */
+	uint32_t reason;
+	/* ActionInvoked: the action key (valid until the next pop_signal()) */
+	const char* action;
+
+	/* reply: the serial returned by send(), and the error message if
+	 * the call failed (valid until the next pop_signal()) */
+	uint32_t serial;
+	const char* error_message;
+};
+
+/* a FIFO of signals, for transports which don't queue them on their own */
+struct _notify_queued_signal {
+	struct _notify_signal sig;
+	/* backs sig.action, or sig.error_message for replies */
+	char* str;
+
+	struct _notify_queued_signal* next;
+};
+
+struct _notify_signal_queue {
+	struct _notify_queued_signal* first;
+	struct _notify_queued_signal** last;
+	/* the signal returned by the last pop, kept to back its strings */
+	struct _notify_queued_signal* popped;
+
+	/* the queued signals are charged against its memory budget */
+	NotifySession session;
+};
+
+void _notify_signal_queue_init(struct _notify_signal_queue* q,
+		NotifySession s);
+void _notify_signal_queue_clear(struct _notify_signal_queue* q);
+/* copies sig, and str into sig.action (or sig.error_message for replies);
+ * returns non-zero if the queue was empty. If the signal can't be queued
+ * (out of memory or budget), it is dropped and zero is returned. */
+int _notify_signal_queue_push(struct _notify_signal_queue* q,
+		const struct _notify_signal* sig, const char* str);
+/* returns zero if the queue is empty */
+int _notify_signal_queue_pop(struct _notify_signal_queue* q,
+		struct _notify_signal* sig);
+
+#define _notify_signal_queue_empty(q) (!(q)->first)
+
+/* All functions returning NotifyError set the session error on failure.
+ * The connection-specific data is kept in s->transport_data; it is NULL
+ * when disconnected. */
+struct notify_transport {
+	const char* name;
+
+	NotifyError (*connect)(NotifySession s);
+	void (*disconnect)(NotifySession s);
+	int (*is_connected)(NotifySession s);
+
+	/* subscribe to server signals */
+	NotifyError (*watch_signals)(NotifySession s);
+
+	/* send a call without waiting; the reply is returned by pop_signal() */
+	NotifyError (*send)(NotifySession s, const struct _notify_call* c,
+			uint32_t* serial);
+	/* send a call and wait for the reply (Notify returns the new ID) */
+	NotifyError (*send_with_reply)(NotifySession s,
+			const struct _notify_call* c, int timeout, uint32_t* id);
+
+	/* wait for I/O up to timeout [ms], or forever if negative */
+	void (*read_write)(NotifySession s, int timeout);
+	/* returns zero if no signals are queued */
+	int (*pop_signal)(NotifySession s, struct _notify_signal* sig);
+	int (*get_fd)(NotifySession s);
+
+	/* whether the calls go over a direct connection to the server */
+	int (*is_peer_connected)(NotifySession s);
+	/* a name identifying the running server instance (malloc()-ed),
+	 * or NULL if it can't be determined */
+	char* (*get_server_name)(NotifySession s);
+};
+
+NotifyError _notify_transport_call(NotifySession s,
+		const struct _notify_call* c, int timeout, uint32_t* id);
+
+/* estimate the size of the message for c */
+size_t _notify_call_size(const struct _notify_call* c);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_TRANSPORT__H*/
@@ -0,0 +1,180 @@
+/* libtinynotify -- UTF-8 validation
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "common_.h"
+#include "utf8_.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#	include <emmintrin.h>
+#endif
+
+/* U+FFFD REPLACEMENT CHARACTER */
+#define UTF8_REPLACEMENT "\xef\xbf\xbd"
+#define UTF8_REPLACEMENT_LEN 3
+
+/* skip the leading ASCII characters; most of the notification text is
+ * ASCII, so this is where the time is spent */
+static size_t _utf8_skip_ascii(const unsigned char* s, size_t len) {
+	size_t i = 0;
+
+#ifdef __SSE2__
+	for (; len - i >= 16; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (s + i));
+
+		if (_mm_movemask_epi8(v))
+			break;
+	}
+#else
+	for (; len - i >= 8; i += 8) {
+		uint64_t v;
+
+		memcpy(&v, s + i, 8);
+		if (v & 0x8080808080808080ULL)
+			break;
+	}
+#endif
+
+	while (i < len && s[i] < 0x80)
+		i++;
+	return i;
+}
+
+/* get the length of the valid multibyte sequence at s, or 0 if it's invalid;
+ * in the latter case, bad_len is set to the length of its maximal valid
+ * prefix (at least 1), which is to be replaced with a single U+FFFD */
+static size_t _utf8_sequence(const unsigned char* s, size_t len,
+		size_t* bad_len) {
+	unsigned char lo = 0x80, hi = 0xbf;
+	size_t seq_len, i;
+
+	if (s[0] >= 0xc2 && s[0] <= 0xdf)
+		seq_len = 2;
+	else if (s[0] >= 0xe0 && s[0] <= 0xef) {
+		seq_len = 3;
+		if (s[0] == 0xe0) /* overlong */
+			lo = 0xa0;
+		else if (s[0] == 0xed) /* surrogates */
+			hi = 0x9f;
+	} else if (s[0] >= 0xf0 && s[0] <= 0xf4) {
+		seq_len = 4;
+		if (s[0] == 0xf0) /* overlong */
+			lo = 0x90;
+		else if (s[0] == 0xf4) /* above U+10FFFF */
+			hi = 0x8f;
+	} else {
+		*bad_len = 1;
+		return 0;
+	}
+
+	for (i = 1; i < seq_len; i++) {
+		if (i >= len || s[i] < lo || s[i] > hi) {
+			*bad_len = i;
+			return 0;
+		}
+		lo = 0x80;
+		hi = 0xbf;
+	}
+
+	return seq_len;
+}
+
+size_t _notify_utf8_valid_len(const char* s, size_t len) {
+	const unsigned char *us = (const unsigned char*) s;
+	size_t i = 0, seq_len, bad_len;
+
+	while (i < len) {
+		i += _utf8_skip_ascii(us + i, len - i);
+		if (i == len)
+			break;
+		if (!(seq_len = _utf8_sequence(us + i, len - i, &bad_len)))
+			break;
+		i += seq_len;
+	}
+
+	return i;
+}
+
+char* _notify_utf8_sanitize(const char* s, size_t len, size_t valid_len,
+		size_t* out_len) {
+	const unsigned char *us = (const unsigned char*) s;
+	char *ret, *shrunk;
+	size_t i = valid_len, o = valid_len;
+
+	/* the worst case: every remaining byte gets replaced */
+	if (!(ret = malloc(valid_len + (len - valid_len)
+				* UTF8_REPLACEMENT_LEN + 1)))
+		return NULL;
+	memcpy(ret, s, valid_len);
+
+	while (i < len) {
+		size_t seq_len, bad_len;
+
+		if (us[i] < 0x80)
+			seq_len = _utf8_skip_ascii(us + i, len - i);
+		else if (!(seq_len = _utf8_sequence(us + i, len - i, &bad_len))) {
+			memcpy(ret + o, UTF8_REPLACEMENT, UTF8_REPLACEMENT_LEN);
+			o += UTF8_REPLACEMENT_LEN;
+			i += bad_len;
+			continue;
+		}
+
+		memcpy(ret + o, s + i, seq_len);
+		o += seq_len;
+		i += seq_len;
+	}
+
+	ret[o] = 0;
+	/* shrinking, so the old block is fine if it fails */
+	if ((shrunk = realloc(ret, o + 1)))
+		ret = shrunk;
+	if (out_len)
+		*out_len = o;
+	return ret;
+}
+
+char* _notify_utf8_strdup(const char* s) {
+	size_t len = strlen(s);
+	size_t valid_len = _notify_utf8_valid_len(s, len);
+	char *ret;
+
+	if (valid_len != len) {
+		_mem_assert(ret = _notify_utf8_sanitize(s, len, valid_len, NULL));
+		return ret;
+	}
+
+	_mem_assert(ret = malloc(len + 1));
+	memcpy(ret, s, len + 1);
+	return ret;
+}
+
+const char* _notify_utf8_check(const char* s, size_t* len, char** fixed) {
+	size_t valid_len = _notify_utf8_valid_len(s, *len);
+
+	if (valid_len == *len)
+		return s;
+
+	*fixed = _notify_utf8_sanitize(s, *len, valid_len, len);
+	return *fixed;
+}
+
+int _notify_utf8_format_is_safe(const char* fmt) {
+	const char *p;
+
+	for (p = fmt; (p = strchr(p, '%')); p++) {
+		/* flags, field width, precision and length modifiers; the ' flag
+		 * (locale-dependent thousands' grouping) is not allowed */
+		p += strspn(p + 1, "#0- +$*.0123456789hlLqjzt") + 1;
+		if (!*p || !strchr("diouxXpn%", *p))
+			return 0;
+	}
+
+	return 1;
+}
@@ -0,0 +1,43 @@
+/* libtinynotify -- UTF-8 validation
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_UTF8__H
+#define _TINYNOTIFY_UTF8__H
+
+#include <stddef.h>
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+/* D-Bus refuses strings which are not valid UTF-8, so all the strings are
+ * validated when they are set (or formatted), and the invalid sequences
+ * replaced with U+FFFD. This way, the validation is done once per value
+ * rather than on every send. */
+
+/* get the length of the valid UTF-8 prefix of s (len if it's all valid) */
+size_t _notify_utf8_valid_len(const char* s, size_t len);
+
+/* get a newly-allocated, NUL-terminated copy of s with the invalid
+ * sequences replaced; valid_len is the result of _notify_utf8_valid_len().
+ * The length of the result is stored in out_len, if not NULL. Returns NULL
+ * if out of memory. */
+char* _notify_utf8_sanitize(const char* s, size_t len, size_t valid_len,
+		size_t* out_len);
+
+/* strdup() replacing the invalid sequences */
+char* _notify_utf8_strdup(const char* s);
+
+/* if s is not valid, store its sanitized copy in *fixed and return it;
+ * otherwise, return s. The length is updated accordingly. Returns NULL
+ * if out of memory. */
+const char* _notify_utf8_check(const char* s, size_t* len, char** fixed);
+
+/* check whether the result of formatting fmt (which is valid) is always
+ * valid UTF-8, i.e. it only has conversions producing ASCII output */
+int _notify_utf8_format_is_safe(const char* fmt);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_UTF8__H*/
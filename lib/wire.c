@@ -0,0 +1,295 @@
+/* libtinynotify -- D-Bus wire format marshalling
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "error.h"
+#include "session.h"
+#include "notification.h"
+#include "event.h"
+
+#include "common_.h"
+#include "notification_.h"
+#include "image_.h"
+#include "event_.h"
+#include "transport_.h"
+#include "wire_.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WORDS_BIGENDIAN
+#	define WIRE_BYTE_ORDER 'B'
+#else
+#	define WIRE_BYTE_ORDER 'l'
+#endif
+
+/* fixed header: byte order, type, flags, version, body length, serial */
+#define WIRE_BODY_LEN_OFFSET 4
+#define WIRE_SERIAL_OFFSET 8
+#define WIRE_FIELDS_LEN_OFFSET 12
+
+#define WIRE_METHOD_CALL 1
+#define WIRE_PROTOCOL_VERSION 1
+
+#define WIRE_FIELD_PATH 1
+#define WIRE_FIELD_INTERFACE 2
+#define WIRE_FIELD_MEMBER 3
+#define WIRE_FIELD_DESTINATION 6
+#define WIRE_FIELD_SIGNATURE 8
+
+#define NOTIFY_SIGNATURE "susssasa{sv}i"
+
+static int _wire_reserve(struct _notify_wire_buf* w, size_t len) {
+	if (w->failed)
+		return -1;
+	if (w->len + len > w->alloc) {
+		size_t new_alloc = w->alloc ? w->alloc : 256;
+		unsigned char *new_data;
+
+		while (new_alloc < w->len + len)
+			new_alloc *= 2;
+		if (!(new_data = realloc(w->data, new_alloc))) {
+			w->failed = 1;
+			return -1;
+		}
+		w->data = new_data;
+		w->alloc = new_alloc;
+	}
+
+	return 0;
+}
+
+static void _wire_align(struct _notify_wire_buf* w, size_t alignment) {
+	size_t pad = (alignment - (w->len & (alignment - 1))) & (alignment - 1);
+
+	if (_wire_reserve(w, pad))
+		return;
+	memset(w->data + w->len, 0, pad);
+	w->len += pad;
+}
+
+static void _wire_put(struct _notify_wire_buf* w, const void* data, size_t len) {
+	if (_wire_reserve(w, len))
+		return;
+	memcpy(w->data + w->len, data, len);
+	w->len += len;
+}
+
+static void _wire_put_byte(struct _notify_wire_buf* w, unsigned char val) {
+	_wire_put(w, &val, 1);
+}
+
+static void _wire_put_uint32(struct _notify_wire_buf* w, uint32_t val) {
+	_wire_align(w, 4);
+	_wire_put(w, &val, 4);
+}
+
+static void _wire_set_uint32(struct _notify_wire_buf* w, size_t offset,
+		uint32_t val) {
+	if (w->failed)
+		return;
+	memcpy(w->data + offset, &val, 4);
+}
+
+/* 's' and 'o' */
+static void _wire_put_string(struct _notify_wire_buf* w, const char* s) {
+	size_t len = strlen(s);
+
+	_wire_put_uint32(w, len);
+	_wire_put(w, s, len + 1);
+}
+
+/* 's' with a known length, not necessarily NUL-terminated */
+static void _wire_put_string_len(struct _notify_wire_buf* w, const char* s,
+		size_t len) {
+	_wire_put_uint32(w, len);
+	_wire_put(w, s, len);
+	_wire_put_byte(w, 0);
+}
+
+/* 'g' */
+static void _wire_put_signature(struct _notify_wire_buf* w, const char* s) {
+	size_t len = strlen(s);
+
+	_wire_put_byte(w, len);
+	_wire_put(w, s, len + 1);
+}
+
+static void _wire_put_header_field(struct _notify_wire_buf* w,
+		unsigned char code, char type, const char* val) {
+	const char sig[2] = { type, 0 };
+
+	_wire_align(w, 8);
+	_wire_put_byte(w, code);
+	_wire_put_signature(w, sig);
+	if (type == 'g')
+		_wire_put_signature(w, val);
+	else
+		_wire_put_string(w, val);
+}
+
+/* open an array; returns the offset of its length, to be passed
+ * to _wire_close_array() */
+static size_t _wire_open_array(struct _notify_wire_buf* w,
+		size_t elem_alignment, size_t* start) {
+	size_t len_offset;
+
+	_wire_put_uint32(w, 0);
+	len_offset = w->len - 4;
+	/* the padding to the first element doesn't count to the length */
+	_wire_align(w, elem_alignment);
+	*start = w->len;
+	return len_offset;
+}
+
+static void _wire_close_array(struct _notify_wire_buf* w,
+		size_t len_offset, size_t start) {
+	_wire_set_uint32(w, len_offset, w->len - start);
+}
+
+int _notify_wire_init(struct _notify_wire_buf* w) {
+	size_t fields_start;
+
+	w->data = NULL;
+	w->len = w->alloc = 0;
+	w->failed = 0;
+
+	_wire_put_byte(w, WIRE_BYTE_ORDER);
+	_wire_put_byte(w, WIRE_METHOD_CALL);
+	_wire_put_byte(w, 0);
+	_wire_put_byte(w, WIRE_PROTOCOL_VERSION);
+	_wire_put_uint32(w, 0); /* body length */
+	_wire_put_uint32(w, 0); /* serial */
+
+	_wire_put_uint32(w, 0); /* header field array length */
+	fields_start = w->len;
+	_wire_put_header_field(w, WIRE_FIELD_PATH, 'o',
+			"/org/freedesktop/Notifications");
+	_wire_put_header_field(w, WIRE_FIELD_INTERFACE, 's',
+			"org.freedesktop.Notifications");
+	_wire_put_header_field(w, WIRE_FIELD_MEMBER, 's', "Notify");
+	_wire_put_header_field(w, WIRE_FIELD_DESTINATION, 's',
+			"org.freedesktop.Notifications");
+	_wire_put_header_field(w, WIRE_FIELD_SIGNATURE, 'g', NOTIFY_SIGNATURE);
+	_wire_set_uint32(w, WIRE_FIELDS_LEN_OFFSET, w->len - fields_start);
+
+	/* the body starts 8-aligned */
+	_wire_align(w, 8);
+	w->header_len = w->len;
+
+	if (w->failed) {
+		_notify_wire_free(w);
+		return -1;
+	}
+	return 0;
+}
+
+void _notify_wire_free(struct _notify_wire_buf* w) {
+	free(w->data);
+}
+
+int _notify_wire_marshal_notify(struct _notify_wire_buf* w,
+		const struct _notify_call* c, uint32_t serial) {
+	const struct _notification_action_list *al;
+	const struct _notification_hint *h;
+	size_t len_offset, start;
+
+	/* reuse the header from the previous call (it is kept even if growing
+	 * the buffer failed) */
+	w->len = w->header_len;
+	w->failed = 0;
+
+	_wire_put_string(w, c->app_name);
+	_wire_put_uint32(w, c->id);
+	_wire_put_string(w, c->app_icon);
+	_wire_put_string(w, c->summary);
+	_wire_put_string_len(w, c->body, c->body_len);
+
+	/* actions */
+	len_offset = _wire_open_array(w, 4, &start);
+	for (al = c->actions; al; al = al->next) {
+		_wire_put_string(w, al->key);
+		_wire_put_string(w, al->desc);
+	}
+	_wire_close_array(w, len_offset, start);
+
+	/* hints (pre-encoded) */
+	len_offset = _wire_open_array(w, 8, &start);
+	for (h = c->default_hints; h; h = h->next) {
+		if (_notification_hints_contain(c->hints,
+					_notification_hint_key(h)))
+			continue;
+		_wire_align(w, 8);
+		_wire_put(w, h->blob, h->len);
+	}
+	for (h = c->hints; h; h = h->next) {
+		_wire_align(w, 8);
+		_wire_put(w, h->blob, h->len);
+	}
+	if (c->image) {
+		_wire_align(w, 8);
+		_wire_put(w, c->image->blob, c->image->len);
+	}
+	_wire_close_array(w, len_offset, start);
+
+	_wire_put_uint32(w, c->expire_timeout);
+
+	_wire_set_uint32(w, WIRE_BODY_LEN_OFFSET, w->len - w->header_len);
+	_wire_set_uint32(w, WIRE_SERIAL_OFFSET, serial);
+	return w->failed ? -1 : 0;
+}
+
+size_t _notify_wire_encode_hint(struct _notify_wire_buf* w, const char* key,
+		char type, const void* value, size_t value_len) {
+	const char sig[3] = { type, type == 'a' ? 'y' : 0, 0 };
+	size_t value_offset;
+
+	_wire_put_string(w, key);
+	_wire_put_signature(w, sig);
+	switch (type) {
+		case 'y':
+			value_offset = w->len;
+			_wire_put_byte(w, *(const uint8_t*) value);
+			break;
+		case 'b':
+		case 'i':
+			_wire_put_uint32(w, *(const uint32_t*) value);
+			value_offset = w->len - 4;
+			break;
+		case 's':
+		case 'a':
+			_wire_put_uint32(w, value_len);
+			value_offset = w->len;
+			_wire_put(w, value, value_len);
+			if (type == 's')
+				_wire_put_byte(w, 0);
+			break;
+		default:
+			abort();
+	}
+
+	return value_offset;
+}
+
+size_t _notify_wire_encode_image_hint(struct _notify_wire_buf* w,
+		const char* key, const struct _notification_image* img) {
+	size_t value_offset;
+
+	_wire_put_string(w, key);
+	_wire_put_signature(w, "(iiibiiay)");
+	_wire_align(w, 8);
+	value_offset = w->len;
+	_wire_put_uint32(w, img->width);
+	_wire_put_uint32(w, img->height);
+	_wire_put_uint32(w, img->rowstride);
+	_wire_put_uint32(w, img->has_alpha);
+	_wire_put_uint32(w, img->bits_per_sample);
+	_wire_put_uint32(w, img->channels);
+	_wire_put_uint32(w, img->len);
+	_wire_put(w, img->data, img->len);
+
+	return value_offset;
+}
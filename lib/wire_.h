@@ -0,0 +1,59 @@
+/* libtinynotify -- D-Bus wire format marshalling
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#pragma once
+#ifndef _TINYNOTIFY_WIRE__H
+#define _TINYNOTIFY_WIRE__H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "transport_.h"
+#include "image_.h"
+
+/*<private_header>*/
+#pragma GCC visibility push(hidden)
+
+/* A serialized method call. The header for the Notify call is constant except
+ * for the body length and the serial, so it is written once when the buffer
+ * is initialized; marshalling a call only patches these two and writes
+ * the body after it. The buffer is kept around to avoid reallocating it.
+ * The same structure (without a header) holds the pre-encoded hints.
+ * If growing the buffer fails, failed is set and the further writes
+ * are ignored. */
+struct _notify_wire_buf {
+	unsigned char* data;
+	size_t len;
+	size_t alloc;
+
+	size_t header_len;
+	int failed;
+};
+
+/* returns non-zero if out of memory */
+int _notify_wire_init(struct _notify_wire_buf* w);
+void _notify_wire_free(struct _notify_wire_buf* w);
+
+/* serialize the Notify call (using native byte order); the result is
+ * in w->data, w->len. Returns non-zero if out of memory. */
+int _notify_wire_marshal_notify(struct _notify_wire_buf* w,
+		const struct _notify_call* c, uint32_t serial);
+
+/* encode a single a{sv} dict entry into w (which has to be zero-filled);
+ * the entry is to be placed at an 8-aligned offset. value points to
+ * the uint8_t, uint32_t or int32_t value for 'y', 'b' and 'i', or
+ * to the value_len bytes for 's' and 'a' (meaning 'ay'). Returns
+ * the offset of the value within w->data. */
+size_t _notify_wire_encode_hint(struct _notify_wire_buf* w, const char* key,
+		char type, const void* value, size_t value_len);
+
+/* encode the 'image-data' a{sv} dict entry, in the same manner as
+ * _notify_wire_encode_hint(). The value is (iiibiiay), starting with
+ * the six integers in the order of struct _notification_image. */
+size_t _notify_wire_encode_image_hint(struct _notify_wire_buf* w,
+		const char* key, const struct _notification_image* img);
+
+#pragma GCC visibility pop
+#endif /*_TINYNOTIFY_WIRE__H*/
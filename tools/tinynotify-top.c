@@ -0,0 +1,220 @@
+/* libtinynotify -- live view of published session statistics
+ * (c) 2011 Michał Górny
+ * 2-clause BSD-licensed
+ */
+
+#include "config.h"
+
+#include "lib/shmstats_.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHM_DIR "/dev/shm"
+#define MAX_SEGMENTS 256
+
+struct segment {
+	char name[NAME_MAX + 1];
+	const struct _notify_shm_stats* shm;
+
+	uint64_t prev_sent;
+	uint64_t prev_closed;
+	uint64_t prev_failed;
+	int seen;
+};
+
+static struct segment segments[MAX_SEGMENTS];
+static int segment_count = 0;
+
+static struct segment* find_segment(const char* name) {
+	int i;
+
+	for (i = 0; i < segment_count; i++) {
+		if (!strcmp(segments[i].name, name))
+			return &segments[i];
+	}
+	return NULL;
+}
+
+static void drop_segment(int i) {
+	munmap((void*) segments[i].shm, sizeof(*segments[i].shm));
+	segments[i] = segments[--segment_count];
+}
+
+static void attach_segment(const char* name) {
+	struct segment *seg;
+	struct _notify_shm_stats *shm;
+	char path[NAME_MAX + 2];
+	struct stat st;
+	int fd;
+
+	if (segment_count == MAX_SEGMENTS)
+		return;
+
+	snprintf(path, sizeof(path), "/%s", name);
+	fd = shm_open(path, O_RDONLY, 0);
+	if (fd == -1)
+		return;
+	/* the segment is created before it is resized; touching the pages
+	 * past its end would raise SIGBUS */
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t) sizeof(*shm)) {
+		close(fd);
+		return;
+	}
+	shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED)
+		return;
+
+	if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != NOTIFY_SHM_MAGIC
+			|| shm->version != NOTIFY_SHM_VERSION) {
+		munmap(shm, sizeof(*shm));
+		return;
+	}
+
+	seg = &segments[segment_count++];
+	strcpy(seg->name, name);
+	seg->shm = shm;
+	seg->prev_sent = _shm_load(shm->sent);
+	seg->prev_closed = _shm_load(shm->closed);
+	seg->prev_failed = _shm_load(shm->failed);
+}
+
+/* attach new segments, and drop the ones which were removed or whose
+ * process died (without cleaning up) */
+static void scan_segments(void) {
+	DIR *d;
+	struct dirent *de;
+	int i;
+
+	for (i = 0; i < segment_count; i++)
+		segments[i].seen = 0;
+
+	d = opendir(SHM_DIR);
+	if (!d) {
+		perror("opendir(" SHM_DIR ")");
+		exit(1);
+	}
+
+	while ((de = readdir(d))) {
+		struct segment *seg;
+
+		if (strncmp(de->d_name, NOTIFY_SHM_PREFIX, strlen(NOTIFY_SHM_PREFIX)))
+			continue;
+
+		seg = find_segment(de->d_name);
+		if (!seg) {
+			attach_segment(de->d_name);
+			seg = find_segment(de->d_name);
+		}
+		if (seg)
+			seg->seen = 1;
+	}
+	closedir(d);
+
+	for (i = segment_count - 1; i >= 0; i--) {
+		if (!segments[i].seen)
+			drop_segment(i);
+		else if (kill(segments[i].shm->pid, 0) == -1 && errno == ESRCH) {
+			char path[NAME_MAX + 2];
+
+			/* nobody else would remove it; this fails for the segments
+			 * of the other users, which is fine */
+			snprintf(path, sizeof(path), "/%s", segments[i].name);
+			shm_unlink(path);
+			drop_segment(i);
+		}
+	}
+}
+
+static void print_segments(double interval, int clear) {
+	int i;
+
+	if (clear)
+		fputs("\033[H\033[2J", stdout);
+	printf("%8s %-24s %9s %9s %9s %8s %8s %10s\n", "PID", "APP",
+			"SENT/s", "CLOSED/s", "FAILED/s", "INFLIGHT", "TRACKED",
+			"LAT[us]");
+
+	for (i = 0; i < segment_count; i++) {
+		struct segment *seg = &segments[i];
+		const struct _notify_shm_stats *shm = seg->shm;
+		uint64_t sent = _shm_load(shm->sent);
+		uint64_t closed = _shm_load(shm->closed);
+		uint64_t failed = _shm_load(shm->failed);
+
+		printf("%8ld %-24.24s %9.1f %9.1f %9.1f %8lu %8lu %10.1f\n",
+				(long int) shm->pid,
+				shm->app_name[0] ? shm->app_name : "-",
+				(sent - seg->prev_sent) / interval,
+				(closed - seg->prev_closed) / interval,
+				(failed - seg->prev_failed) / interval,
+				(unsigned long) _shm_load(shm->in_flight),
+				(unsigned long) _shm_load(shm->tracked),
+				_shm_load(shm->latency_ns) / 1000.);
+
+		seg->prev_sent = sent;
+		seg->prev_closed = closed;
+		seg->prev_failed = failed;
+	}
+	fflush(stdout);
+}
+
+static void usage(const char* argv0) {
+	fprintf(stderr, "Usage: %s [-b] [-d seconds] [-n iterations]\n"
+			"\n"
+			"  -b  batch mode (do not clear the screen)\n"
+			"  -d  delay between updates (default: 1)\n"
+			"  -n  number of updates before exiting (default: infinite)\n",
+			argv0);
+}
+
+int main(int argc, char* argv[]) {
+	double interval = 1;
+	int iterations = -1;
+	int batch = !isatty(STDOUT_FILENO);
+	int opt;
+
+	while ((opt = getopt(argc, argv, "bd:n:h")) != -1) {
+		switch (opt) {
+			case 'b':
+				batch = 1;
+				break;
+			case 'd':
+				interval = atof(optarg);
+				if (interval <= 0) {
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'n':
+				iterations = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return opt != 'h';
+		}
+	}
+
+	scan_segments();
+	while (iterations) {
+		usleep(interval * 1000000);
+		print_segments(interval, !batch);
+		scan_segments();
+
+		if (iterations > 0)
+			iterations--;
+	}
+
+	return 0;
+}